@@ -0,0 +1,334 @@
+#include <utoolkit/logging/binary_log.h>
+#include <utoolkit/logging/logger.h>
+#include <utoolkit/logging/timestamp_formatter.h>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+#ifdef HAVE_BENCHMARK
+#include <benchmark/benchmark.h>
+#endif
+
+using namespace utoolkit::logging;
+
+#ifdef HAVE_BENCHMARK
+namespace {
+
+const char* kLogFile = "benchmark_logger.log";
+const char* kBinaryLogFile = "benchmark_logger.blog";
+const char* kMappedLogFile = "benchmark_logger_mapped.log";
+
+void setup_logger() {
+    static std::once_flag ocf;
+    std::call_once(ocf, []() {
+        std::remove(kLogFile);
+        Logger& logger = Logger::instance();
+        logger.enable_console_output(false);
+        logger.set_log_level(LogLevel::INFO);
+        logger.set_log_file(kLogFile);
+    });
+}
+
+const std::string kMessage = "benchmark message with a typical payload length of about sixty bytes";
+
+}
+
+// 基准：同步日志（加锁 + 每行 flush）
+// 单次耗时即调用方延迟，items_per_second 为吞吐
+static void BM_SyncLog(benchmark::State& state) {
+    setup_logger();
+    for (auto _ : state) {
+        UT_INFO(kMessage);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// 基准：只挂NullSink的同步日志，即格式化与分发本身的开销
+static void BM_NullSinkLog(benchmark::State& state) {
+    setup_logger();
+    Logger& logger = Logger::instance();
+    if (state.thread_index() == 0) {
+        logger.clear_sinks();
+        logger.add_sink(std::make_shared<NullSink>());
+    }
+    for (auto _ : state) {
+        UT_INFO(kMessage);
+    }
+    if (state.thread_index() == 0) {
+        logger.clear_sinks();
+        logger.add_sink(logger.file_sink());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// 基准：文件sink的刷新策略
+// Arg 0：每条刷新（默认）；Arg 1：缓冲64KB，WARN及以上立即刷新
+static void BM_FileSinkFlushPolicy(benchmark::State& state) {
+    setup_logger();
+    Logger& logger = Logger::instance();
+    if (state.thread_index() == 0) {
+        FlushPolicy policy;
+        if (state.range(0) == 1) {
+            policy.buffer_size = 64 * 1024;
+        }
+        logger.file_sink()->set_flush_policy(policy);
+    }
+    for (auto _ : state) {
+        UT_INFO(kMessage);
+    }
+    if (state.thread_index() == 0) {
+        logger.file_sink()->set_flush_policy(FlushPolicy());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// 基准：内存映射文件sink，写入即memcpy，每个区段一次fallocate+mmap
+// 与BM_FileSinkFlushPolicy中std::ofstream的两种刷新策略对比
+static void BM_MappedFileSink(benchmark::State& state) {
+    setup_logger();
+    Logger& logger = Logger::instance();
+    static std::shared_ptr<MappedFileSink> sink;
+    if (state.thread_index() == 0) {
+        std::remove(kMappedLogFile);
+        sink = std::make_shared<MappedFileSink>(kMappedLogFile);
+        logger.clear_sinks();
+        logger.add_sink(sink);
+    }
+    for (auto _ : state) {
+        UT_INFO(kMessage);
+    }
+    if (state.thread_index() == 0) {
+        logger.clear_sinks();
+        logger.add_sink(logger.file_sink());
+        sink.reset();
+        std::remove(kMappedLogFile);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// 基准：被级别过滤的日志，消息不会被构造
+static void BM_FilteredLog(benchmark::State& state) {
+    setup_logger();
+    int value = 42;
+    for (auto _ : state) {
+        UT_DEBUG("filtered message " + std::to_string(value));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// 基准：分类日志，调用点缓存分类指针后按分类级别过滤
+// Arg 0：被分类级别过滤；Arg 1：分类为DEBUG、全局为INFO时写入空输出
+static void BM_CategoryLog(benchmark::State& state) {
+    setup_logger();
+    Logger& logger = Logger::instance();
+    const bool enabled = state.range(0) != 0;
+    if (state.thread_index() == 0) {
+        logger.set_category_level("bench", enabled ? LogLevel::DEBUG : LogLevel::WARN);
+        logger.clear_sinks();
+        logger.add_sink(std::make_shared<NullSink>());
+    }
+    for (auto _ : state) {
+        UT_LOG_CAT(bench, DEBUG, kMessage);
+    }
+    if (state.thread_index() == 0) {
+        logger.clear_sinks();
+        logger.add_sink(logger.file_sink());
+        logger.reset_category_level("bench");
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// 基准：限频日志中被抑制的调用，即每个调用点静态原子状态的开销
+// Arg 0：UT_LOG_EVERY_N；Arg 1：UT_LOG_EVERY_MS；Arg 2：UT_LOG_RATE_LIMITED（令牌桶）
+static void BM_RateLimitedLog(benchmark::State& state) {
+    setup_logger();
+    const int64_t mode = state.range(0);
+    for (auto _ : state) {
+        if (mode == 0) {
+            UT_LOG_EVERY_N(LogLevel::INFO, 1000000000, kMessage);
+        } else if (mode == 1) {
+            UT_LOG_EVERY_MS(LogLevel::INFO, 3600000, kMessage);
+        } else {
+            UT_LOG_RATE_LIMITED(LogLevel::INFO, 0.001, 1, kMessage);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// 基准：结构化日志，只挂NullSink
+// Arg 0：手工拼接JSON字符串后UT_INFO；Arg 1：UT_INFO_KV，JSON行格式；Arg 2：UT_INFO_KV，logfmt格式
+static void BM_StructuredLog(benchmark::State& state) {
+    setup_logger();
+    Logger& logger = Logger::instance();
+    const int64_t mode = state.range(0);
+    if (state.thread_index() == 0) {
+        logger.clear_sinks();
+        logger.add_sink(std::make_shared<NullSink>());
+        logger.set_line_format(mode == 1 ? LineFormat::JSON : mode == 2 ? LineFormat::LOGFMT : LineFormat::TEXT);
+    }
+    uint64_t user = 123456;
+    double latency = 87.5;
+    const std::string path = "/api/v1/orders";
+    for (auto _ : state) {
+        if (mode == 0) {
+            UT_INFO("{\"msg\":\"request done\",\"user\":" + std::to_string(user) + ",\"path\":\"" + path +
+                    "\",\"lat_us\":" + std::to_string(latency) + "}");
+        } else {
+            UT_INFO_KV("request done", kv("user", user), kv("path", path), kv("lat_us", latency));
+        }
+        ++user;
+    }
+    if (state.thread_index() == 0) {
+        logger.set_line_format(LineFormat::TEXT);
+        logger.clear_sinks();
+        logger.add_sink(logger.file_sink());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// 基准：飞行记录器捕获被级别过滤的日志（只写入本线程内存环，不做I/O）
+static void BM_FlightRecorderCapture(benchmark::State& state) {
+    setup_logger();
+    Logger& logger = Logger::instance();
+    if (state.thread_index() == 0) {
+        FlightRecorderOptions options;
+        options.dump_on_crash = false;
+        logger.enable_flight_recorder(options);
+    }
+    for (auto _ : state) {
+        UT_DEBUG(kMessage);
+    }
+    if (state.thread_index() == 0) {
+        logger.disable_flight_recorder();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// 基准：异步日志（无锁入队 + 后台线程批量写入）
+static void BM_AsyncLog(benchmark::State& state) {
+    setup_logger();
+    Logger& logger = Logger::instance();
+    if (state.thread_index() == 0) {
+        AsyncOptions options;
+        options.overflow_policy = static_cast<OverflowPolicy>(state.range(0));
+        logger.enable_async(options);
+    }
+    for (auto _ : state) {
+        UT_INFO(kMessage);
+    }
+    if (state.thread_index() == 0) {
+        logger.disable_async();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// 基准：异步模式下调用方的消息构造开销
+// Arg 0：std::to_string 拼接；Arg 1：UT_INFOF（数值参数延迟到写线程格式化）
+static void BM_AsyncMessageBuild(benchmark::State& state) {
+    setup_logger();
+    Logger& logger = Logger::instance();
+    if (state.thread_index() == 0) {
+        AsyncOptions options;
+        options.overflow_policy = OverflowPolicy::DROP;
+        logger.enable_async(options);
+    }
+    int id = 7;
+    double value = 3.25;
+    for (auto _ : state) {
+        if (state.range(0) == 0) {
+            UT_INFO("request " + std::to_string(id) + " took " + std::to_string(value) + " ms");
+        } else {
+#if defined(UT_LOG_HAVE_FMT) && UT_LOG_HAVE_FMT
+            UT_INFOF("request {} took {} ms", id, value);
+#endif
+        }
+    }
+    if (state.thread_index() == 0) {
+        logger.disable_async();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// 基准：二进制日志，只写站点id、时间戳和参数字节，离线解码
+// 与 BM_AsyncMessageBuild 的同一条消息对比；bytes_per_record 为每条记录的文件大小
+static void BM_BinaryLog(benchmark::State& state) {
+    setup_logger();
+    BinaryLogger& binary = BinaryLogger::instance();
+    if (state.thread_index() == 0) {
+        binary.open(kBinaryLogFile);
+    }
+    int id = 7;
+    double value = 3.25;
+    for (auto _ : state) {
+        UT_INFOB("request {} took {} ms", id, value);
+    }
+    if (state.thread_index() == 0) {
+        binary.close();
+        std::ifstream file(kBinaryLogFile, std::ios::binary | std::ios::ate);
+        state.counters["bytes_per_record"] = static_cast<double>(file.tellg()) /
+                                             static_cast<double>(state.iterations() * state.threads());
+        std::remove(kBinaryLogFile);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// 旧实现的参照：localtime + stringstream + put_time
+static std::string legacy_timestamp(std::chrono::system_clock::time_point now) {
+    auto time_t = std::chrono::system_clock::to_time_t(now);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
+    std::stringstream ss;
+    ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
+    ss << "." << std::setfill('0') << std::setw(3) << ms.count();
+    return ss.str();
+}
+
+// 基准：时间戳格式化（旧实现参照）
+static void BM_TimestampLegacy(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(legacy_timestamp(std::chrono::system_clock::now()));
+    }
+}
+
+// 基准：按秒缓存前缀的时间戳格式化
+// Arg 0/1：本地时间/UTC；Arg 2：微秒精度
+static void BM_TimestampCached(benchmark::State& state) {
+    static TimestampFormatter formatters[] = {
+        TimestampFormatter(TimestampFormatter::Zone::LOCAL),
+        TimestampFormatter(TimestampFormatter::Zone::UTC),
+        TimestampFormatter(TimestampFormatter::Zone::LOCAL, TimestampFormatter::Precision::MICROSECONDS),
+    };
+    TimestampFormatter& formatter = formatters[state.range(0)];
+    char buffer[TimestampFormatter::kMaxLength];
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(formatter.format(std::chrono::system_clock::now(), buffer));
+    }
+}
+
+BENCHMARK(BM_TimestampLegacy)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_TimestampCached)->DenseRange(0, 2)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_AsyncMessageBuild)->Arg(0)->Arg(1)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_BinaryLog)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_FilteredLog)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_CategoryLog)->Arg(0)->Arg(1)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_StructuredLog)->DenseRange(0, 2)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_FlightRecorderCapture)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_RateLimitedLog)->DenseRange(0, 2)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_SyncLog)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_NullSinkLog)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_FileSinkFlushPolicy)->Arg(0)->Arg(1)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_MappedFileSink)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_AsyncLog)->Arg(static_cast<int>(OverflowPolicy::BLOCK))->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_AsyncLog)->Arg(static_cast<int>(OverflowPolicy::DROP_AND_COUNT))->ThreadRange(1, 8)->UseRealTime();
+
+BENCHMARK_MAIN();
+#else
+int main() {
+    std::cout << "Google Benchmark library not available" << std::endl;
+    return 0;
+}
+#endif
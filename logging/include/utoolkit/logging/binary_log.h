@@ -0,0 +1,398 @@
+#pragma once
+
+#include <utoolkit/logging/logger.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define UT_BINARY_LOG_HAVE_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define UT_BINARY_LOG_HAVE_TSC 1
+#endif
+
+namespace utoolkit {
+namespace logging {
+
+// Binary log files, written by BinaryLogger and read by BinaryLogReader.
+// All integers are in native byte order.
+//
+//   header: kBinaryLogMagic, u64 ticks per second, u64 ticks, i64 wall clock
+//           nanoseconds since the epoch at those ticks
+//   entry:  u32 site id, then
+//     id != 0  a record: u64 ticks, then the arguments as listed in the
+//              site's descriptor; strings are a u16 length and the bytes
+//     id == 0  u8 BinaryEntry, then
+//       DESCRIPTOR  u32 id, u8 level, u32 line, and the file, the format and
+//                   the argument types, each as a u16 length and the bytes
+//       CLOCK_SYNC  u64 ticks, i64 wall clock nanoseconds
+//
+// A descriptor is written before the first record of its site.
+constexpr char kBinaryLogMagic[8] = {'U', 'T', 'B', 'L', 'O', 'G', '0', '1'};
+
+enum class BinaryEntry : uint8_t {
+    DESCRIPTOR = 1,
+    CLOCK_SYNC = 2
+};
+
+// String arguments are truncated to this many bytes.
+constexpr size_t kMaxBinaryStringBytes = 1024;
+
+// Per-thread buffer size. Records are gathered here and written in chunks.
+constexpr size_t kBinaryThreadBufferBytes = 64 * 1024;
+
+constexpr size_t kBinaryRecordHeaderBytes = sizeof(uint32_t) + sizeof(uint64_t);
+
+// A UT_LOGB call site. Constant-initialized; the id is assigned and the
+// descriptor written on the first call.
+struct BinaryLogSite {
+    LogLevel level;
+    const char* format;
+    const char* file;
+    int line;
+    std::atomic<uint32_t> id {0};
+};
+
+namespace detail {
+
+// Buffer of one logging thread. |busy| is held by the owning thread while it
+// appends and by flush() while it writes the buffer out.
+struct BinaryThreadBuffer {
+    std::atomic<bool> busy {false};
+    size_t size = 0;
+    std::unique_ptr<char[]> data;
+};
+
+inline thread_local BinaryThreadBuffer* t_binary_buffer = nullptr;
+
+} // namespace detail
+
+// Writes log records as a site id, a timestamp and the raw argument bytes;
+// formatting happens offline, see BinaryLogReader and utoolkit_log_decode.
+//
+// Each thread appends to its own buffer, so logging threads do not contend.
+// Buffers are written to the file when full, on flush(), on close() and when
+// their thread exits. Records of different threads are therefore grouped in
+// chunks; the decoder can sort them by time.
+//
+// Timestamps are TSC ticks on x86 and steady_clock nanoseconds elsewhere.
+// The file maps them to wall clock time through the header and through clock
+// sync entries written with every chunk.
+class BinaryLogger {
+public:
+    static BinaryLogger& instance();
+
+    // Truncates |filename| and starts logging to it. Returns false if it
+    // cannot be opened. Open and close while no other thread is logging.
+    bool open(const std::string& filename);
+    void close();
+    bool is_open() const { return open_.load(std::memory_order_relaxed); }
+
+    // Writes the buffers of all threads to the file.
+    void flush();
+
+    // Assigns the id of |site| and writes its descriptor. Called once per
+    // site by UT_LOGB. |arg_types| must be a string literal.
+    uint32_t register_site(BinaryLogSite& site, const char* arg_types);
+
+    // Locks the calling thread's buffer with room for |size| bytes; the
+    // caller appends at data + size, advances size and releases |busy|.
+    detail::BinaryThreadBuffer* begin_record(size_t size) {
+        detail::BinaryThreadBuffer* buffer = detail::t_binary_buffer;
+        if (buffer == nullptr) {
+            buffer = attach_thread();
+        }
+        while (buffer->busy.exchange(true, std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        if (buffer->size + size > kBinaryThreadBufferBytes) {
+            drain(*buffer);
+        }
+        return buffer;
+    }
+
+    static uint64_t ticks() {
+#if defined(UT_BINARY_LOG_HAVE_TSC)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+private:
+    BinaryLogger() = default;
+    ~BinaryLogger();
+
+    BinaryLogger(const BinaryLogger&) = delete;
+    BinaryLogger& operator=(const BinaryLogger&) = delete;
+
+    struct Descriptor {
+        BinaryLogSite* site;
+        const char* arg_types;
+    };
+
+    detail::BinaryThreadBuffer* attach_thread();
+    void detach_thread(detail::BinaryThreadBuffer* buffer);
+    friend struct BinaryThreadHolder;
+
+    // Writes |buffer| to the file and empties it. |busy| must be held.
+    void drain(detail::BinaryThreadBuffer& buffer);
+    void write_descriptor(uint32_t id, const Descriptor& descriptor);
+    void write_clock_sync();
+
+    std::atomic<bool> open_ {false};
+
+    // Lock order: sites_mutex_ or buffers_mutex_, then a buffer's |busy|,
+    // then file_mutex_.
+    std::mutex sites_mutex_;
+    std::vector<Descriptor> sites_;
+
+    std::mutex buffers_mutex_;
+    std::vector<std::unique_ptr<detail::BinaryThreadBuffer>> buffers_;
+    std::vector<detail::BinaryThreadBuffer*> free_buffers_;
+
+    std::mutex file_mutex_;
+    std::ofstream file_;
+    uint64_t ticks_per_second_ = 0;
+};
+
+namespace detail {
+
+// Type codes of the descriptor, after Python's struct module.
+template <typename T>
+constexpr char integer_type_code() {
+    constexpr bool is_signed = std::is_signed_v<T>;
+    switch (sizeof(T)) {
+        case 1: return is_signed ? 'b' : 'B';
+        case 2: return is_signed ? 'h' : 'H';
+        case 4: return is_signed ? 'i' : 'I';
+        default: return is_signed ? 'q' : 'Q';
+    }
+}
+
+template <typename T>
+char* write_raw(char* out, const T& value) {
+    std::memcpy(out, &value, sizeof(T));
+    return out + sizeof(T);
+}
+
+inline char* write_string(char* out, std::string_view value) {
+    const uint16_t size = static_cast<uint16_t>(std::min(value.size(), kMaxBinaryStringBytes));
+    out = write_raw(out, size);
+    std::memcpy(out, value.data(), size);
+    return out + size;
+}
+
+// How an argument is stored. Only the types below are supported; anything
+// else fails to compile.
+template <typename T, typename Enable = void>
+struct BinaryArg {
+    static_assert(sizeof(T) == 0, "unsupported UT_LOGB argument type");
+};
+
+template <>
+struct BinaryArg<bool> {
+    static constexpr char kType = '?';
+    static constexpr size_t kMaxSize = 1;
+    static size_t size(bool) { return 1; }
+    static char* write(char* out, bool value) { return write_raw(out, static_cast<uint8_t>(value)); }
+};
+
+template <>
+struct BinaryArg<char> {
+    static constexpr char kType = 'c';
+    static constexpr size_t kMaxSize = 1;
+    static size_t size(char) { return 1; }
+    static char* write(char* out, char value) { return write_raw(out, value); }
+};
+
+template <typename T>
+struct BinaryArg<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+                                     !std::is_same_v<T, char>>> {
+    static constexpr char kType = integer_type_code<T>();
+    static constexpr size_t kMaxSize = sizeof(T);
+    static size_t size(T) { return sizeof(T); }
+    static char* write(char* out, T value) { return write_raw(out, value); }
+};
+
+template <typename T>
+struct BinaryArg<T, std::enable_if_t<std::is_enum_v<T>>> : BinaryArg<std::underlying_type_t<T>> {
+    static size_t size(T) { return sizeof(T); }
+    static char* write(char* out, T value) {
+        return BinaryArg<std::underlying_type_t<T>>::write(out, static_cast<std::underlying_type_t<T>>(value));
+    }
+};
+
+template <>
+struct BinaryArg<float> {
+    static constexpr char kType = 'f';
+    static constexpr size_t kMaxSize = sizeof(float);
+    static size_t size(float) { return sizeof(float); }
+    static char* write(char* out, float value) { return write_raw(out, value); }
+};
+
+template <typename T>
+struct BinaryArg<T, std::enable_if_t<std::is_same_v<T, double> || std::is_same_v<T, long double>>> {
+    static constexpr char kType = 'd';
+    static constexpr size_t kMaxSize = sizeof(double);
+    static size_t size(T) { return sizeof(double); }
+    static char* write(char* out, T value) { return write_raw(out, static_cast<double>(value)); }
+};
+
+template <typename T>
+struct BinaryArg<T, std::enable_if_t<std::is_same_v<T, std::string_view> || std::is_same_v<T, std::string>>> {
+    static constexpr char kType = 's';
+    static constexpr size_t kMaxSize = sizeof(uint16_t) + kMaxBinaryStringBytes;
+    static size_t size(std::string_view value) {
+        return sizeof(uint16_t) + std::min(value.size(), kMaxBinaryStringBytes);
+    }
+    static char* write(char* out, std::string_view value) { return write_string(out, value); }
+};
+
+template <typename T>
+struct BinaryArg<T, std::enable_if_t<std::is_same_v<T, const char*> || std::is_same_v<T, char*>>> {
+    static constexpr char kType = 's';
+    static constexpr size_t kMaxSize = sizeof(uint16_t) + kMaxBinaryStringBytes;
+    static std::string_view view(const char* value) { return value != nullptr ? value : "(null)"; }
+    static size_t size(const char* value) {
+        return sizeof(uint16_t) + std::min(view(value).size(), kMaxBinaryStringBytes);
+    }
+    static char* write(char* out, const char* value) { return write_string(out, view(value)); }
+};
+
+template <typename T>
+struct BinaryArg<T*, std::enable_if_t<!std::is_same_v<std::remove_cv_t<T>, char>>> {
+    static constexpr char kType = 'P';
+    static constexpr size_t kMaxSize = sizeof(uint64_t);
+    static size_t size(const T*) { return sizeof(uint64_t); }
+    static char* write(char* out, const T* value) {
+        return write_raw(out, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value)));
+    }
+};
+
+template <typename... Args>
+struct BinaryArgs {
+    static constexpr char kTypes[] = {BinaryArg<Args>::kType..., '\0'};
+    static constexpr size_t kMaxSize = (BinaryArg<Args>::kMaxSize + ... + 0);
+};
+
+// Number of {} replacement fields in |format|; {{ and }} are literal braces.
+constexpr size_t count_placeholders(std::string_view format) {
+    size_t count = 0;
+    for (size_t i = 0; i < format.size(); ++i) {
+        if (format[i] == '{') {
+            if (i + 1 < format.size() && format[i + 1] == '{') {
+                ++i;
+                continue;
+            }
+            ++count;
+            while (i < format.size() && format[i] != '}') {
+                ++i;
+            }
+        } else if (format[i] == '}' && i + 1 < format.size() && format[i + 1] == '}') {
+            ++i;
+        }
+    }
+    return count;
+}
+
+template <size_t Placeholders, typename... Args>
+void write_binary(BinaryLogSite& site, const Args&... args) {
+    static_assert(Placeholders == sizeof...(Args), "UT_LOGB: the number of {} does not match the arguments");
+    static_assert(kBinaryRecordHeaderBytes + BinaryArgs<std::decay_t<Args>...>::kMaxSize <= kBinaryThreadBufferBytes,
+                  "UT_LOGB: too many arguments");
+
+    BinaryLogger& logger = BinaryLogger::instance();
+    uint32_t id = site.id.load(std::memory_order_acquire);
+    if (id == 0) {
+        id = logger.register_site(site, BinaryArgs<std::decay_t<Args>...>::kTypes);
+    }
+
+    const size_t size = kBinaryRecordHeaderBytes + (BinaryArg<std::decay_t<Args>>::size(args) + ... + 0);
+    BinaryThreadBuffer* buffer = logger.begin_record(size);
+    char* out = buffer->data.get() + buffer->size;
+    out = write_raw(out, id);
+    out = write_raw(out, BinaryLogger::ticks());
+    ((out = BinaryArg<std::decay_t<Args>>::write(out, args)), ...);
+    buffer->size += size;
+    buffer->busy.store(false, std::memory_order_release);
+
+    if (site.level == LogLevel::FATAL) {
+        logger.flush();
+    }
+}
+
+} // namespace detail
+
+} // namespace logging
+} // namespace utoolkit
+
+// Binary logging, e.g. UT_INFOB("request {} took {} us", id, elapsed). Writes
+// only the site id, a timestamp and the argument bytes to the BinaryLogger;
+// nothing happens unless it is open and the Logger level allows |level|.
+// |format| must be a literal with one {} per argument, which is checked at
+// compile time. Arguments may be integers, floating point numbers, bool,
+// enums, strings and pointers; format specs such as {:.2f} are applied by the
+// decoder.
+#define UT_LOGB(level, format, ...) \
+    do { \
+        if (utoolkit::logging::Logger::instance().should_log(level) && \
+            utoolkit::logging::BinaryLogger::instance().is_open()) { \
+            static utoolkit::logging::BinaryLogSite ut_binary_site_ {level, format, __FILE__, __LINE__}; \
+            utoolkit::logging::detail::write_binary<utoolkit::logging::detail::count_placeholders(format)>( \
+                ut_binary_site_, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define UT_LOGB_STRIPPED(format, ...) \
+    do { \
+        if (false) { \
+            UT_LOGB(utoolkit::logging::LogLevel::TRACE, format, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#if UT_LOG_ACTIVE_LEVEL <= UT_LOG_LEVEL_TRACE
+#define UT_TRACEB(format, ...) UT_LOGB(utoolkit::logging::LogLevel::TRACE, format, ##__VA_ARGS__)
+#else
+#define UT_TRACEB(format, ...) UT_LOGB_STRIPPED(format, ##__VA_ARGS__)
+#endif
+
+#if UT_LOG_ACTIVE_LEVEL <= UT_LOG_LEVEL_DEBUG
+#define UT_DEBUGB(format, ...) UT_LOGB(utoolkit::logging::LogLevel::DEBUG, format, ##__VA_ARGS__)
+#else
+#define UT_DEBUGB(format, ...) UT_LOGB_STRIPPED(format, ##__VA_ARGS__)
+#endif
+
+#if UT_LOG_ACTIVE_LEVEL <= UT_LOG_LEVEL_INFO
+#define UT_INFOB(format, ...) UT_LOGB(utoolkit::logging::LogLevel::INFO, format, ##__VA_ARGS__)
+#else
+#define UT_INFOB(format, ...) UT_LOGB_STRIPPED(format, ##__VA_ARGS__)
+#endif
+
+#if UT_LOG_ACTIVE_LEVEL <= UT_LOG_LEVEL_WARN
+#define UT_WARNB(format, ...) UT_LOGB(utoolkit::logging::LogLevel::WARN, format, ##__VA_ARGS__)
+#else
+#define UT_WARNB(format, ...) UT_LOGB_STRIPPED(format, ##__VA_ARGS__)
+#endif
+
+#if UT_LOG_ACTIVE_LEVEL <= UT_LOG_LEVEL_ERROR
+#define UT_ERRORB(format, ...) UT_LOGB(utoolkit::logging::LogLevel::ERROR, format, ##__VA_ARGS__)
+#else
+#define UT_ERRORB(format, ...) UT_LOGB_STRIPPED(format, ##__VA_ARGS__)
+#endif
+
+#define UT_FATALB(format, ...) UT_LOGB(utoolkit::logging::LogLevel::FATAL, format, ##__VA_ARGS__)
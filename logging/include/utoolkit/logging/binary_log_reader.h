@@ -0,0 +1,80 @@
+#pragma once
+
+#include <utoolkit/logging/logger.h>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace utoolkit {
+namespace logging {
+
+struct BinaryLogRecord {
+    LogLevel level = LogLevel::INFO;
+    std::chrono::system_clock::time_point time;
+    std::string message;
+    std::string file;
+    int line = 0;
+};
+
+// Reads files written by BinaryLogger and formats their records. Format specs
+// such as {:.2f} are applied when built with fmt and ignored otherwise.
+class BinaryLogReader {
+public:
+    // Returns false if |filename| cannot be opened or is not a binary log.
+    bool open(const std::string& filename);
+
+    // Reads the next record in file order. Returns false at the end of the
+    // file; error() then tells whether the file was cut short or corrupt.
+    bool next(BinaryLogRecord& record);
+
+    const std::string& error() const { return error_; }
+
+private:
+    struct Site {
+        bool known = false;
+        LogLevel level = LogLevel::INFO;
+        int line = 0;
+        std::string file;
+        std::string format;
+        std::string arg_types;
+    };
+
+    struct Arg {
+        char type;
+        union {
+            int64_t i;
+            uint64_t u;
+            double d;
+            float f;
+        };
+        std::string s;
+    };
+
+    bool read_bytes(void* out, size_t size);
+    bool read_string(std::string& out);
+    bool read_descriptor();
+    bool read_clock_sync();
+    bool read_record(uint32_t id, BinaryLogRecord& record);
+    bool fail(const std::string& error);
+
+    std::chrono::system_clock::time_point to_wall_clock(uint64_t ticks) const;
+    static void format_message(const std::string& format, const std::vector<Arg>& args, std::string& out);
+
+    std::ifstream file_;
+    std::string error_;
+    std::vector<Site> sites_;
+    std::vector<Arg> args_;
+
+    // The header calibration and the latest clock sync entry; the rate is
+    // refined from the two once they are far enough apart.
+    double ticks_per_ns_ = 1.0;
+    uint64_t start_ticks_ = 0;
+    int64_t start_wall_ns_ = 0;
+    uint64_t sync_ticks_ = 0;
+    int64_t sync_wall_ns_ = 0;
+};
+
+} // namespace logging
+} // namespace utoolkit
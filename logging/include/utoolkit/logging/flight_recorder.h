@@ -0,0 +1,109 @@
+#pragma once
+
+#include <utoolkit/logging/log_level.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace utoolkit {
+namespace logging {
+
+struct FlightRecorderOptions {
+    // Records kept per thread, rounded up to a power of two. Applies to
+    // threads that record for the first time after the change.
+    size_t records_per_thread = 1024;
+
+    // Captured from this level up, whatever the Logger's level is.
+    LogLevel level = LogLevel::TRACE;
+
+    // Written by dump(), on FATAL messages and on crashes.
+    std::string dump_file = "flight_recorder.log";
+
+    // Dump on SIGSEGV, SIGABRT, SIGBUS, SIGFPE and SIGILL, then hand the
+    // signal to the previous handler or its default action.
+    bool dump_on_crash = true;
+};
+
+// Keeps the most recent log records of every thread in memory, including
+// those below the Logger's level, to be written out when the process dies.
+//
+// Each thread records into its own ring of fixed size slots: no lock, no
+// allocation after the thread's first record and no formatting beyond a copy
+// of the message. Rings are never freed; a ring whose thread has exited is
+// taken over by the next new thread, so memory is bounded by the number of
+// threads alive at the same time.
+//
+// Enabled through Logger::enable_flight_recorder(), which makes the UT_*
+// macros pass the captured levels on to Logger::log().
+class FlightRecorder {
+public:
+    // Longer messages and file names are truncated.
+    static constexpr size_t kMaxMessageBytes = 200;
+    static constexpr size_t kMaxFileBytes = 40;
+
+    static FlightRecorder& instance();
+
+    // Not to be called concurrently with each other or with a dump.
+    void enable(const FlightRecorderOptions& options);
+    void disable();
+
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+    LogLevel level() const { return level_.load(std::memory_order_relaxed); }
+    bool captures(LogLevel level) const {
+        return enabled() && level >= level_.load(std::memory_order_relaxed);
+    }
+
+    // Called by Logger::log() for every captured message. |fields| of
+    // structured messages are kept after the message.
+    void record(LogLevel level, std::string_view message, std::string_view fields,
+                std::string_view file, int line);
+
+    // Writes the records of all threads merged by time, one line each with
+    // a UTC timestamp and the thread id, replacing the dump file.
+    //
+    // Async-signal-safe: no allocation, no locks, no stdio. Records being
+    // written while the dump runs are skipped. Returns false if the file
+    // cannot be opened or another dump is in progress.
+    bool dump();
+    bool dump(const char* path);
+    bool dump_to_fd(int fd);
+
+    // Forgets what has been recorded so far.
+    void clear();
+
+private:
+    FlightRecorder() = default;
+
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    struct Slot;
+    struct Ring;
+    // Returns a thread's ring when the thread exits.
+    struct RingOwner;
+
+    Ring* acquire_ring();
+    bool dump_file(const char* path, const char* reason);
+    bool write_dump(int fd, const char* reason);
+    void install_handlers();
+    void restore_handlers();
+    static void on_crash(int signal);
+
+    std::atomic<bool> enabled_ {false};
+    std::atomic<LogLevel> level_ {LogLevel::TRACE};
+    std::atomic<size_t> records_per_thread_ {1024};
+
+    // Fixed storage, so that a signal handler can read it.
+    char dump_path_[4096] = "flight_recorder.log";
+
+    // Every ring ever created, newest first. Only ever grows.
+    std::atomic<Ring*> rings_ {nullptr};
+
+    std::atomic_flag dumping_ = ATOMIC_FLAG_INIT;
+    bool handlers_installed_ = false;
+};
+
+} // namespace logging
+} // namespace utoolkit
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <utoolkit/logging/log_level.h>
+#include <atomic>
+#include <string>
+
+namespace utoolkit {
+namespace logging {
+
+// A named group of log call sites, e.g. "net", with a level of its own that
+// may be changed at runtime; see Logger::category() and UT_LOG_CAT().
+//
+// Categories are created by the Logger and live as long as the process, so
+// call sites keep a plain pointer. Until a level is set, a category follows
+// the Logger's level.
+class LogCategory {
+public:
+    const std::string& name() const { return name_; }
+
+    // One relaxed load each, like Logger::should_log().
+    bool should_log(LogLevel level) const {
+        return level >= level_.load(std::memory_order_relaxed);
+    }
+    bool should_capture(LogLevel level) const {
+        return level >= capture_level_.load(std::memory_order_relaxed);
+    }
+
+    LogLevel level() const { return level_.load(std::memory_order_relaxed); }
+    bool has_own_level() const { return own_level_.load(std::memory_order_relaxed); }
+
+    LogCategory(const LogCategory&) = delete;
+    LogCategory& operator=(const LogCategory&) = delete;
+
+private:
+    friend class Logger;
+
+    explicit LogCategory(std::string name) : name_(std::move(name)) {}
+
+    const std::string name_;
+    // Kept up to date by the Logger: the category's level, or the Logger's
+    // while it has none, and the lower of that and the flight recorder's.
+    std::atomic<LogLevel> level_ {LogLevel::INFO};
+    std::atomic<LogLevel> capture_level_ {LogLevel::INFO};
+    std::atomic<bool> own_level_ {false};
+    LogLevel own_level_value_ = LogLevel::INFO;
+};
+
+} // namespace logging
+} // namespace utoolkit
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <utoolkit/logging/logger.h>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+#include <fmt/format.h>
+
+namespace utoolkit {
+namespace logging {
+namespace detail {
+
+// Arguments that may be formatted later on the writer thread: plain values
+// that do not refer to memory the caller may free once the call returns.
+// Pointers, string views and strings are formatted at the call site.
+template <typename T>
+constexpr bool is_deferrable_v = std::is_arithmetic_v<T> || std::is_enum_v<T>;
+
+// Copies deferrable arguments into a byte array and formats them from there.
+template <typename... Args>
+struct DeferredArgs {
+    static constexpr size_t kSize = (sizeof(Args) + ... + 0);
+
+    static void pack(unsigned char* out, const Args&... args) {
+        size_t offset = 0;
+        ((std::memcpy(out + offset, &args, sizeof(Args)), offset += sizeof(Args)), ...);
+    }
+
+    static void format(const unsigned char* in, std::string_view format, std::string& out) {
+        std::tuple<Args...> values;
+        std::apply([in](Args&... args) {
+            size_t offset = 0;
+            ((std::memcpy(&args, in + offset, sizeof(Args)), offset += sizeof(Args)), ...);
+        }, values);
+        std::apply([&](const Args&... args) {
+            fmt::vformat_to(std::back_inserter(out), fmt::string_view(format.data(), format.size()),
+                            fmt::make_format_args(args...));
+        }, values);
+    }
+};
+
+// Reused by every formatted log call of the thread. Argument formatters must
+// not log themselves.
+inline fmt::memory_buffer& format_buffer() {
+    thread_local fmt::memory_buffer buffer;
+    return buffer;
+}
+
+template <typename Format, typename... Args>
+void log_format(LogLevel level, const char* file, int line, const Format& format, const Args&... args) {
+    Logger& logger = Logger::instance();
+
+    if constexpr ((is_deferrable_v<Args> && ...) &&
+                  DeferredArgs<Args...>::kSize <= Logger::kMaxDeferredArgBytes) {
+        unsigned char packed[DeferredArgs<Args...>::kSize + 1];
+        DeferredArgs<Args...>::pack(packed, args...);
+        const fmt::string_view view = format;
+        if (logger.log_deferred(level, &DeferredArgs<Args...>::format, std::string_view(view.data(), view.size()),
+                                packed, DeferredArgs<Args...>::kSize, file, line)) {
+            return;
+        }
+    }
+
+    // Instantiated for every call site, so the format string is checked at
+    // compile time against the arguments even when formatting is deferred.
+    fmt::memory_buffer& buffer = format_buffer();
+    buffer.clear();
+    fmt::format_to(std::back_inserter(buffer), format, args...);
+    logger.log(level, std::string_view(buffer.data(), buffer.size()), file, line);
+}
+
+} // namespace detail
+} // namespace logging
+} // namespace utoolkit
+
+// fmt-style formatted logging, e.g. UT_INFOF("x={} y={:.2f}", x, y). The format
+// string must be a literal and is checked at compile time. Nothing is
+// evaluated if the level is filtered; in async mode messages whose arguments
+// are all numbers or enums are formatted by the writer thread.
+#define UT_LOGF(level, format, ...) \
+    do { \
+        if (utoolkit::logging::Logger::instance().should_capture(level)) { \
+            utoolkit::logging::detail::log_format(level, __FILE__, __LINE__, FMT_STRING(format), ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define UT_LOGF_STRIPPED(format, ...) \
+    do { \
+        if (false) { \
+            (void)fmt::format(FMT_STRING(format), ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#if UT_LOG_ACTIVE_LEVEL <= UT_LOG_LEVEL_TRACE
+#define UT_TRACEF(format, ...) UT_LOGF(utoolkit::logging::LogLevel::TRACE, format, ##__VA_ARGS__)
+#else
+#define UT_TRACEF(format, ...) UT_LOGF_STRIPPED(format, ##__VA_ARGS__)
+#endif
+
+#if UT_LOG_ACTIVE_LEVEL <= UT_LOG_LEVEL_DEBUG
+#define UT_DEBUGF(format, ...) UT_LOGF(utoolkit::logging::LogLevel::DEBUG, format, ##__VA_ARGS__)
+#else
+#define UT_DEBUGF(format, ...) UT_LOGF_STRIPPED(format, ##__VA_ARGS__)
+#endif
+
+#if UT_LOG_ACTIVE_LEVEL <= UT_LOG_LEVEL_INFO
+#define UT_INFOF(format, ...) UT_LOGF(utoolkit::logging::LogLevel::INFO, format, ##__VA_ARGS__)
+#else
+#define UT_INFOF(format, ...) UT_LOGF_STRIPPED(format, ##__VA_ARGS__)
+#endif
+
+#if UT_LOG_ACTIVE_LEVEL <= UT_LOG_LEVEL_WARN
+#define UT_WARNF(format, ...) UT_LOGF(utoolkit::logging::LogLevel::WARN, format, ##__VA_ARGS__)
+#else
+#define UT_WARNF(format, ...) UT_LOGF_STRIPPED(format, ##__VA_ARGS__)
+#endif
+
+#if UT_LOG_ACTIVE_LEVEL <= UT_LOG_LEVEL_ERROR
+#define UT_ERRORF(format, ...) UT_LOGF(utoolkit::logging::LogLevel::ERROR, format, ##__VA_ARGS__)
+#else
+#define UT_ERRORF(format, ...) UT_LOGF_STRIPPED(format, ##__VA_ARGS__)
+#endif
+
+#define UT_FATALF(format, ...) UT_LOGF(utoolkit::logging::LogLevel::FATAL, format, ##__VA_ARGS__)
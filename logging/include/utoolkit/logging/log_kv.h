@@ -0,0 +1,259 @@
+#pragma once
+
+#include <utoolkit/logging/logger.h>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace utoolkit {
+namespace logging {
+
+// A field of a structured message, see kv() and UT_LOG_KV().
+template <typename T>
+struct KeyValue {
+    std::string_view key;
+    T value;
+};
+
+namespace detail {
+
+// Fields keep numbers, bools and enums by value and refer to strings, which
+// only need to live until the log call returns.
+template <typename T>
+using kv_value_t = std::conditional_t<
+    std::is_same_v<std::decay_t<T>, char*> || std::is_same_v<std::decay_t<T>, const char*>,
+    const char*,
+    std::conditional_t<std::is_arithmetic_v<T> || std::is_enum_v<T>, T, std::string_view>>;
+
+// Appends |text| as a quoted JSON string. Bytes from 0x80 up are passed
+// through, valid UTF-8 stays valid.
+inline void append_json_string(std::string& out, std::string_view text) {
+    static const char kHex[] = "0123456789abcdef";
+    out += '"';
+    size_t start = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        const auto c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        out.append(text.data() + start, i - start);
+        start = i + 1;
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            default: {
+                const char escaped[] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xf]};
+                out.append(escaped, sizeof(escaped));
+                break;
+            }
+        }
+    }
+    out.append(text.data() + start, text.size() - start);
+    out += '"';
+}
+
+// Appends |text| as a logfmt value, quoted only if it has to be.
+inline void append_logfmt_value(std::string& out, std::string_view text) {
+    bool plain = !text.empty();
+    for (const char c : text) {
+        if (static_cast<unsigned char>(c) <= ' ' || c == '=' || c == '"' || c == '\\' || c == 0x7f) {
+            plain = false;
+            break;
+        }
+    }
+    if (plain) {
+        out += text;
+    } else {
+        append_json_string(out, text);
+    }
+}
+
+template <typename T>
+void append_number(std::string& out, T value) {
+    char buffer[64];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, static_cast<size_t>(result.ptr - buffer));
+}
+
+template <typename T>
+void append_value(std::string& out, LineFormat format, const T& value) {
+    if constexpr (std::is_same_v<T, bool>) {
+        out += value ? "true" : "false";
+    } else if constexpr (std::is_same_v<T, char>) {
+        append_value(out, format, std::string_view(&value, 1));
+    } else if constexpr (std::is_enum_v<T>) {
+        append_number(out, static_cast<std::underlying_type_t<T>>(value));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        if (std::isfinite(value)) {
+            append_number(out, value);
+        } else if (format == LineFormat::JSON) {
+            out += "null";
+        } else {
+            out += std::isnan(value) ? "NaN" : (value > 0 ? "+Inf" : "-Inf");
+        }
+    } else if constexpr (std::is_integral_v<T>) {
+        append_number(out, value);
+    } else if constexpr (std::is_same_v<T, const char*>) {
+        if (value == nullptr) {
+            out += format == LineFormat::JSON ? "null" : "";
+        } else {
+            append_value(out, format, std::string_view(value));
+        }
+    } else {
+        static_assert(std::is_same_v<T, std::string_view>,
+                      "kv() takes numbers, bools, enums and strings");
+        if (format == LineFormat::JSON) {
+            append_json_string(out, value);
+        } else {
+            append_logfmt_value(out, value);
+        }
+    }
+}
+
+// The encoded keys of a call site, e.g. ,"user": and  user= , built by its
+// first call. Keys must therefore be the same on every call, e.g. literals.
+class KvKeys {
+public:
+    template <typename... Values>
+    void prepare(const KeyValue<Values>&... fields) {
+        if (ready_.load(std::memory_order_acquire)) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!ready_.load(std::memory_order_relaxed)) {
+            (add(fields.key), ...);
+            ready_.store(true, std::memory_order_release);
+        }
+    }
+
+    // What precedes the value of field |index|.
+    std::string_view prefix(LineFormat format, size_t index) const {
+        const std::string& keys = format == LineFormat::JSON ? json_ : text_;
+        const std::vector<size_t>& ends = format == LineFormat::JSON ? json_ends_ : text_ends_;
+        const size_t begin = index == 0 ? 0 : ends[index - 1];
+        return std::string_view(keys).substr(begin, ends[index] - begin);
+    }
+
+private:
+    void add(std::string_view key) {
+        json_ += ',';
+        append_json_string(json_, key);
+        json_ += ':';
+        json_ends_.push_back(json_.size());
+
+        // logfmt keys cannot be quoted, unfit characters become '_'.
+        text_ += ' ';
+        for (const char c : key) {
+            const bool fit = static_cast<unsigned char>(c) > ' ' && c != '=' && c != '"' && c != 0x7f;
+            text_ += fit ? c : '_';
+        }
+        if (key.empty()) {
+            text_ += '_';
+        }
+        text_ += '=';
+        text_ends_.push_back(text_.size());
+    }
+
+    std::atomic<bool> ready_ {false};
+    std::mutex mutex_;
+    std::string json_;
+    std::string text_;
+    std::vector<size_t> json_ends_;
+    std::vector<size_t> text_ends_;
+};
+
+// Reused by every structured log call of the thread.
+inline std::string& kv_buffer() {
+    thread_local std::string buffer;
+    return buffer;
+}
+
+template <typename... Values>
+void log_kv(LogLevel level, KvKeys& keys, std::string_view message, const char* file, int line,
+            const KeyValue<Values>&... fields) {
+    keys.prepare(fields...);
+
+    Logger& logger = Logger::instance();
+    const LineFormat format = logger.line_format();
+    std::string& buffer = kv_buffer();
+    buffer.clear();
+    size_t index = 0;
+    ((buffer += keys.prefix(format, index++), append_value(buffer, format, fields.value)), ...);
+    logger.log_fields(level, message, buffer, format, file, line);
+}
+
+} // namespace detail
+
+// A field for UT_LOG_KV(). |key| should be a literal.
+template <typename T>
+KeyValue<detail::kv_value_t<T>> kv(std::string_view key, const T& value) {
+    return {key, value};
+}
+
+} // namespace logging
+} // namespace utoolkit
+
+// Structured logging, e.g.
+//   UT_INFO_KV("request done", kv("user", id), kv("lat_us", elapsed));
+// Fields are encoded in the Logger's line format straight into a buffer
+// reused by the thread, in the order given; see Logger::set_line_format().
+// Nothing is evaluated if the level is filtered.
+#define UT_LOG_KV(level, msg, ...) \
+    do { \
+        if (utoolkit::logging::Logger::instance().should_capture(level)) { \
+            static utoolkit::logging::detail::KvKeys ut_kv_keys_; \
+            utoolkit::logging::detail::log_kv(level, ut_kv_keys_, msg, __FILE__, __LINE__, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define UT_LOG_KV_STRIPPED(msg, ...) \
+    do { \
+        if (false) { \
+            utoolkit::logging::detail::KvKeys* ut_kv_keys_ = nullptr; \
+            utoolkit::logging::detail::log_kv(utoolkit::logging::LogLevel::TRACE, *ut_kv_keys_, msg, \
+                                              __FILE__, __LINE__, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#if UT_LOG_ACTIVE_LEVEL <= UT_LOG_LEVEL_TRACE
+#define UT_TRACE_KV(msg, ...) UT_LOG_KV(utoolkit::logging::LogLevel::TRACE, msg, ##__VA_ARGS__)
+#else
+#define UT_TRACE_KV(msg, ...) UT_LOG_KV_STRIPPED(msg, ##__VA_ARGS__)
+#endif
+
+#if UT_LOG_ACTIVE_LEVEL <= UT_LOG_LEVEL_DEBUG
+#define UT_DEBUG_KV(msg, ...) UT_LOG_KV(utoolkit::logging::LogLevel::DEBUG, msg, ##__VA_ARGS__)
+#else
+#define UT_DEBUG_KV(msg, ...) UT_LOG_KV_STRIPPED(msg, ##__VA_ARGS__)
+#endif
+
+#if UT_LOG_ACTIVE_LEVEL <= UT_LOG_LEVEL_INFO
+#define UT_INFO_KV(msg, ...) UT_LOG_KV(utoolkit::logging::LogLevel::INFO, msg, ##__VA_ARGS__)
+#else
+#define UT_INFO_KV(msg, ...) UT_LOG_KV_STRIPPED(msg, ##__VA_ARGS__)
+#endif
+
+#if UT_LOG_ACTIVE_LEVEL <= UT_LOG_LEVEL_WARN
+#define UT_WARN_KV(msg, ...) UT_LOG_KV(utoolkit::logging::LogLevel::WARN, msg, ##__VA_ARGS__)
+#else
+#define UT_WARN_KV(msg, ...) UT_LOG_KV_STRIPPED(msg, ##__VA_ARGS__)
+#endif
+
+#if UT_LOG_ACTIVE_LEVEL <= UT_LOG_LEVEL_ERROR
+#define UT_ERROR_KV(msg, ...) UT_LOG_KV(utoolkit::logging::LogLevel::ERROR, msg, ##__VA_ARGS__)
+#else
+#define UT_ERROR_KV(msg, ...) UT_LOG_KV_STRIPPED(msg, ##__VA_ARGS__)
+#endif
+
+#define UT_FATAL_KV(msg, ...) UT_LOG_KV(utoolkit::logging::LogLevel::FATAL, msg, ##__VA_ARGS__)
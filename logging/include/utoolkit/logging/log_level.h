@@ -0,0 +1,16 @@
+#pragma once
+
+namespace utoolkit {
+namespace logging {
+
+enum class LogLevel {
+    TRACE = 0,
+    DEBUG = 1,
+    INFO = 2,
+    WARN = 3,
+    ERROR = 4,
+    FATAL = 5
+};
+
+} // namespace logging
+} // namespace utoolkit
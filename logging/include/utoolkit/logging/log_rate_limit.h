@@ -0,0 +1,182 @@
+#pragma once
+
+#include <utoolkit/logging/logger.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#if defined(__linux__)
+#include <time.h>
+#endif
+
+namespace utoolkit {
+namespace logging {
+namespace detail {
+
+// Monotonic nanoseconds from a clock that is cheap to read; on Linux the
+// coarse clock, which advances once per scheduler tick (a few milliseconds).
+inline int64_t coarse_now_ns() {
+#if defined(__linux__) && defined(CLOCK_MONOTONIC_COARSE)
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Per call site state of the macros below. Constant-initialized statics, so
+// a call site costs no guard; suppressed calls touch one or two atomics.
+
+struct EveryNState {
+    std::atomic<uint64_t> count {0};
+
+    // Allows calls 0, n, 2n, ...; |suppressed| is the count since the last.
+    bool allow(uint64_t n, uint64_t& suppressed) {
+        const uint64_t index = count.fetch_add(1, std::memory_order_relaxed);
+        if (n <= 1) {
+            suppressed = 0;
+            return true;
+        }
+        suppressed = index == 0 ? 0 : n - 1;
+        return index % n == 0;
+    }
+};
+
+struct FirstNState {
+    std::atomic<uint64_t> count {0};
+
+    // Once the limit is reached, a plain load.
+    bool allow(uint64_t n) {
+        if (count.load(std::memory_order_relaxed) >= n) {
+            return false;
+        }
+        return count.fetch_add(1, std::memory_order_relaxed) < n;
+    }
+};
+
+// Counts what the time based limiters suppress until the next allowed call.
+struct SuppressedCount {
+    std::atomic<uint64_t> suppressed {0};
+
+    void add() { suppressed.fetch_add(1, std::memory_order_relaxed); }
+    uint64_t take() { return suppressed.exchange(0, std::memory_order_relaxed); }
+};
+
+struct EveryMsState : SuppressedCount {
+    std::atomic<int64_t> next_ns {0};
+
+    // At most one call per |interval_ms|.
+    bool allow(int64_t interval_ms) {
+        const int64_t now = coarse_now_ns();
+        int64_t next = next_ns.load(std::memory_order_relaxed);
+        if (now < next || !next_ns.compare_exchange_strong(next, now + interval_ms * 1000000,
+                                                           std::memory_order_relaxed)) {
+            add();
+            return false;
+        }
+        return true;
+    }
+};
+
+// Token bucket in its GCRA form: a single timestamp, the time at which the
+// bucket would be full again, stands for the tokens left.
+struct TokenBucketState : SuppressedCount {
+    std::atomic<int64_t> full_at_ns {0};
+
+    // |per_second| calls on average, up to |burst| at once.
+    bool allow(double per_second, int64_t burst) {
+        const int64_t now = coarse_now_ns();
+        const int64_t cost = per_second > 0 ? static_cast<int64_t>(1e9 / per_second) : INT64_MAX / 4;
+        const int64_t limit = cost * std::max<int64_t>(burst, 1);
+        int64_t full_at = full_at_ns.load(std::memory_order_relaxed);
+        while (true) {
+            const int64_t next = std::max(full_at, now) + cost;
+            if (next - now > limit) {
+                add();
+                return false;
+            }
+            if (full_at_ns.compare_exchange_weak(full_at, next, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }
+};
+
+// Logs |message|, noting how many calls of the site were suppressed before it.
+inline void log_with_suppressed(LogLevel level, std::string_view message, uint64_t suppressed,
+                                const char* file, int line) {
+    Logger& logger = Logger::instance();
+    if (suppressed == 0) {
+        logger.log(level, message, file, line);
+        return;
+    }
+    std::string text(message);
+    text += " (";
+    text += std::to_string(suppressed);
+    text += suppressed == 1 ? " similar message suppressed)" : " similar messages suppressed)";
+    logger.log(level, text, file, line);
+}
+
+} // namespace detail
+} // namespace logging
+} // namespace utoolkit
+
+// Sampled and rate limited logging for hot paths, e.g.
+//   UT_LOG_EVERY_MS(LogLevel::ERROR, 1000, "connect failed: " + reason);
+// Every call site has its own state. |msg| is only evaluated for calls that
+// are logged; those report how many calls were suppressed since the last one.
+// Levels that are neither logged nor captured by the flight recorder do not
+// touch the state.
+
+// Logs the 1st, (n+1)th, (2n+1)th, ... call.
+#define UT_LOG_EVERY_N(level, n, msg) \
+    do { \
+        if (utoolkit::logging::Logger::instance().should_capture(level)) { \
+            static utoolkit::logging::detail::EveryNState ut_every_n_state_; \
+            uint64_t ut_suppressed_ = 0; \
+            if (ut_every_n_state_.allow(n, ut_suppressed_)) { \
+                utoolkit::logging::detail::log_with_suppressed(level, msg, ut_suppressed_, __FILE__, __LINE__); \
+            } \
+        } \
+    } while (0)
+
+// Logs the first n calls only.
+#define UT_LOG_FIRST_N(level, n, msg) \
+    do { \
+        if (utoolkit::logging::Logger::instance().should_capture(level)) { \
+            static utoolkit::logging::detail::FirstNState ut_first_n_state_; \
+            if (ut_first_n_state_.allow(n)) { \
+                utoolkit::logging::Logger::instance().log(level, msg, __FILE__, __LINE__); \
+            } \
+        } \
+    } while (0)
+
+// Logs at most once per |ms| milliseconds. Time is read from a coarse clock,
+// intervals are accurate to a few milliseconds.
+#define UT_LOG_EVERY_MS(level, ms, msg) \
+    do { \
+        if (utoolkit::logging::Logger::instance().should_capture(level)) { \
+            static utoolkit::logging::detail::EveryMsState ut_every_ms_state_; \
+            if (ut_every_ms_state_.allow(ms)) { \
+                utoolkit::logging::detail::log_with_suppressed(level, msg, ut_every_ms_state_.take(), \
+                                                               __FILE__, __LINE__); \
+            } \
+        } \
+    } while (0)
+
+// Logs |per_second| calls per second on average and up to |burst| in a row.
+#define UT_LOG_RATE_LIMITED(level, per_second, burst, msg) \
+    do { \
+        if (utoolkit::logging::Logger::instance().should_capture(level)) { \
+            static utoolkit::logging::detail::TokenBucketState ut_token_bucket_state_; \
+            if (ut_token_bucket_state_.allow(per_second, burst)) { \
+                utoolkit::logging::detail::log_with_suppressed(level, msg, ut_token_bucket_state_.take(), \
+                                                               __FILE__, __LINE__); \
+            } \
+        } \
+    } while (0)
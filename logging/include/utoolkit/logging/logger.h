@@ -2,39 +2,171 @@
 
 #include <string>
 #include <memory>
-#include <fstream>
 #include <mutex>
 #include <chrono>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string_view>
+#include <vector>
+#include <utoolkit/logging/flight_recorder.h>
+#include <utoolkit/logging/log_category.h>
+#include <utoolkit/logging/log_level.h>
+#include <utoolkit/logging/sink.h>
+#include <utoolkit/logging/timestamp_formatter.h>
 
 namespace utoolkit {
 namespace logging {
 
-enum class LogLevel {
-    TRACE = 0,
-    DEBUG = 1,
-    INFO = 2,
-    WARN = 3,
-    ERROR = 4,
-    FATAL = 5
+// Numeric levels for the preprocessor, matching LogLevel.
+#define UT_LOG_LEVEL_TRACE 0
+#define UT_LOG_LEVEL_DEBUG 1
+#define UT_LOG_LEVEL_INFO 2
+#define UT_LOG_LEVEL_WARN 3
+#define UT_LOG_LEVEL_ERROR 4
+#define UT_LOG_LEVEL_FATAL 5
+
+// Call sites below this level are compiled out entirely, e.g. build with
+// -DUT_LOG_ACTIVE_LEVEL=UT_LOG_LEVEL_INFO (CMake: UTOOLKIT_LOG_ACTIVE_LEVEL=INFO)
+// to strip UT_TRACE and UT_DEBUG from release builds. UT_FATAL is never stripped.
+#ifndef UT_LOG_ACTIVE_LEVEL
+#define UT_LOG_ACTIVE_LEVEL UT_LOG_LEVEL_TRACE
+#endif
+
+// What an asynchronous logger does when its queue is full.
+enum class OverflowPolicy {
+    BLOCK = 0,          // wait for the writer to make room
+    DROP = 1,           // discard the message
+    DROP_AND_COUNT = 2  // discard, count, and log the count once there is room
+};
+
+struct AsyncOptions {
+    // Number of queued messages, rounded up to a power of two.
+    size_t queue_size = 8192;
+    OverflowPolicy overflow_policy = OverflowPolicy::BLOCK;
+};
+
+// How Logger lays out a line. Fields of structured messages (UT_INFO_KV())
+// follow the message as key=value in TEXT and LOGFMT.
+enum class LineFormat {
+    TEXT = 0,   // 2024-01-31 23:59:59.123 [INFO] message key=value (file:line)
+    JSON = 1,   // {"time":"...","level":"INFO","msg":"message","key":value,"file":"...","line":1}
+    LOGFMT = 2  // time="..." level=INFO msg=message key=value file=... line=1
 };
 
 class Logger {
 public:
+    // Formats a message from arguments packed by the caller; see log_format.h.
+    using DeferredFormatter = void (*)(const unsigned char* args, std::string_view format, std::string& out);
+    static constexpr size_t kMaxDeferredArgBytes = 64;
+
     static Logger& instance();
     
     void set_log_level(LogLevel level);
+
+    // Runtime level filter; a relaxed atomic load, cheap enough to guard every
+    // call site. The UT_* macros check it before evaluating the message.
+    bool should_log(LogLevel level) const {
+        return level >= current_level_.load(std::memory_order_relaxed);
+    }
+
+    // Whether a message at |level| is written or captured by the flight
+    // recorder; what the UT_* macros check before building the message.
+    bool should_capture(LogLevel level) const {
+        return level >= capture_level_.load(std::memory_order_relaxed);
+    }
+
+    // The category |name|, created on first use. The pointer stays valid
+    // for the life of the process; UT_LOG_CAT() looks it up once per call
+    // site.
+    LogCategory* category(std::string_view name);
+
+    // Gives |name| a level of its own, e.g. DEBUG for one module while the
+    // rest stays at INFO. Creates the category if needed, so it may be
+    // configured before its first message.
+    void set_category_level(std::string_view name, LogLevel level);
+    // Makes |name| follow the level set above again.
+    void reset_category_level(std::string_view name);
+
+    // Output goes to sinks, each with its own level and flush policy on top
+    // of the level above. A console sink is installed by default.
+    void add_sink(std::shared_ptr<Sink> sink);
+    void remove_sink(const std::shared_ptr<Sink>& sink);
+    void clear_sinks();
+
+    // Shorthands for the built-in console and file sinks.
     void set_log_file(const std::string& filename);
     void enable_console_output(bool enable);
+    std::shared_ptr<ConsoleSink> console_sink() const { return console_sink_; }
+    std::shared_ptr<RotatingFileSink> file_sink() const { return file_sink_; }
+
+    // Size and time based rotation of the log file, see RotatingFile. May be
+    // changed at any time, e.g. to adjust retention.
+    void set_rotation(const RotationOptions& options);
+
+    // TEXT by default. Applies to messages logged after the call.
+    void set_line_format(LineFormat format);
+    LineFormat line_format() const { return line_format_.load(std::memory_order_relaxed); }
+
+    // Timestamps are local time with milliseconds by default.
+    void set_time_zone(TimestampFormatter::Zone zone);
+    void set_timestamp_precision(TimestampFormatter::Precision precision);
     
-    void log(LogLevel level, const std::string& message, 
-             const std::string& file = "", int line = 0);
+    // Switches to asynchronous logging: log() enqueues the message into a
+    // bounded lock-free queue and returns; a writer thread formats queued
+    // messages and writes them in batches. FATAL messages, flush() and
+    // process exit wait until everything queued has been written.
+    // Switch modes from one thread at a time.
+    void enable_async(const AsyncOptions& options = AsyncOptions());
+    // Writes what is still queued and goes back to synchronous logging.
+    // Messages logged meanwhile by other threads are either queued before
+    // the writer stops or written synchronously.
+    void disable_async();
+    bool is_async() const;
+
+    // Returns once all messages logged before the call have been written.
+    void flush();
+
+    // Keeps recent messages of every thread in memory, including those below
+    // the level set above, and dumps them on FATAL messages and crashes; see
+    // FlightRecorder. Messages of UT_INFOF() and friends are formatted by the
+    // caller while the recorder captures their level.
+    void enable_flight_recorder(const FlightRecorderOptions& options = FlightRecorderOptions());
+    void disable_flight_recorder();
+    // Writes the recorded messages to the dump file, e.g. from a debug command.
+    bool dump_flight_recorder();
+
+    // Messages discarded by OverflowPolicy::DROP_AND_COUNT.
+    uint64_t dropped_messages() const;
+
+    void log(LogLevel level, std::string_view message,
+             std::string_view file = {}, int line = 0);
+
+    // Logs |message| in |category|, filtered by the category's level
+    // instead of the Logger's.
+    void log(const LogCategory& category, LogLevel level, std::string_view message,
+             std::string_view file = {}, int line = 0);
+
+    // Logs |message| followed by |fields|, already encoded for |format|;
+    // see log_kv.h.
+    void log_fields(LogLevel level, std::string_view message, std::string_view fields, LineFormat format,
+                    std::string_view file = {}, int line = 0);
     
-    void trace(const std::string& message, const std::string& file = "", int line = 0);
-    void debug(const std::string& message, const std::string& file = "", int line = 0);
-    void info(const std::string& message, const std::string& file = "", int line = 0);
-    void warn(const std::string& message, const std::string& file = "", int line = 0);
-    void error(const std::string& message, const std::string& file = "", int line = 0);
-    void fatal(const std::string& message, const std::string& file = "", int line = 0);
+    // In async mode queues |args| for |formatter| to format on the writer
+    // thread and returns true. Returns false in synchronous mode and for
+    // levels the flight recorder captures, leaving formatting to the caller.
+    // |format| must be a string literal.
+    bool log_deferred(LogLevel level, DeferredFormatter formatter, std::string_view format,
+                      const unsigned char* args, size_t size,
+                      std::string_view file = {}, int line = 0);
+
+    void trace(std::string_view message, std::string_view file = {}, int line = 0);
+    void debug(std::string_view message, std::string_view file = {}, int line = 0);
+    void info(std::string_view message, std::string_view file = {}, int line = 0);
+    void warn(std::string_view message, std::string_view file = {}, int line = 0);
+    void error(std::string_view message, std::string_view file = {}, int line = 0);
+    void fatal(std::string_view message, std::string_view file = {}, int line = 0);
 
 private:
     Logger();
@@ -43,21 +175,135 @@ private:
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
     
-    std::string level_to_string(LogLevel level);
-    std::string get_current_time();
+    struct AsyncState;
+
+    const char* level_to_string(LogLevel level);
+    void format_entry(std::string& out, std::chrono::system_clock::time_point time, LogLevel level,
+                      std::string_view category, std::string_view message, std::string_view fields,
+                      LineFormat format, std::string_view file, int line);
+
+    // Hands a message that passed the capture level to the flight recorder.
+    void capture(LogLevel level, std::string_view message, std::string_view fields,
+                 std::string_view file, int line);
+    // Writes or queues a message that passed the output level.
+    void dispatch(LogLevel level, std::string_view category, std::string_view message, std::string_view fields,
+                  LineFormat format, std::string_view file, int line);
+
+    // Queues a record whose message part is written by |fill|. Defined and
+    // instantiated in logger.cpp only.
+    template <typename Fill>
+    bool enqueue(AsyncState* state, LogLevel level, std::string_view file, int line, Fill&& fill);
+    void run_writer(AsyncState* state);
+
+    using SinkList = std::vector<std::shared_ptr<Sink>>;
+    std::shared_ptr<const SinkList> sinks() const;
+    // Replaces the sink list with a copy changed by |change|.
+    template <typename Change>
+    void update_sinks(Change&& change);
+    void flush_sinks();
+    // Derives the capture level and the levels of categories without one of
+    // their own from the Logger's and the flight recorder's.
+    void update_levels();
     
-    LogLevel current_level_;
-    std::ofstream log_file_;
+    std::atomic<LogLevel> current_level_;
+    std::atomic<LogLevel> capture_level_;
+    std::atomic<LineFormat> line_format_ {LineFormat::TEXT};
+    FlightRecorder& recorder_;
+
+    // Guarded by |mutex_|. Never removed, call sites hold pointers.
+    std::map<std::string, std::unique_ptr<LogCategory>, std::less<>> categories_;
+    TimestampFormatter timestamp_;
+
+    // Read without locking through an atomic shared_ptr; changes copy the
+    // list under |mutex_|.
+    std::shared_ptr<const SinkList> sinks_;
+    std::shared_ptr<ConsoleSink> console_sink_;
+    std::shared_ptr<RotatingFileSink> file_sink_;
     std::mutex mutex_;
-    bool console_output_enabled_;
+
+    // Non-null while asynchronous. Stopped states are kept until destruction
+    // because a logging thread may still hold a pointer to them.
+    std::atomic<AsyncState*> async_ {nullptr};
+    std::vector<std::unique_ptr<AsyncState>> async_states_;
 };
 
-#define UT_TRACE(msg) utoolkit::logging::Logger::instance().trace(msg, __FILE__, __LINE__)
-#define UT_DEBUG(msg) utoolkit::logging::Logger::instance().debug(msg, __FILE__, __LINE__)
-#define UT_INFO(msg) utoolkit::logging::Logger::instance().info(msg, __FILE__, __LINE__)
-#define UT_WARN(msg) utoolkit::logging::Logger::instance().warn(msg, __FILE__, __LINE__)
-#define UT_ERROR(msg) utoolkit::logging::Logger::instance().error(msg, __FILE__, __LINE__)
-#define UT_FATAL(msg) utoolkit::logging::Logger::instance().fatal(msg, __FILE__, __LINE__)
+// Logs |msg| at |level| if the runtime level allows it or the flight recorder
+// captures it. |msg| is not evaluated otherwise. The file is passed as the
+// __FILE__ literal.
+#define UT_LOG(level, msg) \
+    do { \
+        if (utoolkit::logging::Logger::instance().should_capture(level)) { \
+            utoolkit::logging::Logger::instance().log(level, msg, __FILE__, __LINE__); \
+        } \
+    } while (0)
+
+// Logs |msg| in the category named by the identifier |name| at |level|,
+// one of TRACE ... FATAL, e.g. UT_LOG_CAT(net, DEBUG, "connected to " + host).
+// The category is looked up once per call site; after that a filtered call
+// costs one relaxed load. Levels below UT_LOG_ACTIVE_LEVEL are compiled out.
+#define UT_LOG_CAT(name, level, msg) \
+    do { \
+        if (UT_LOG_LEVEL_##level >= UT_LOG_ACTIVE_LEVEL) { \
+            static utoolkit::logging::LogCategory* const ut_category_ = \
+                utoolkit::logging::Logger::instance().category(#name); \
+            if (ut_category_->should_capture(utoolkit::logging::LogLevel::level)) { \
+                utoolkit::logging::Logger::instance().log(*ut_category_, utoolkit::logging::LogLevel::level, \
+                                                          msg, __FILE__, __LINE__); \
+            } \
+        } \
+    } while (0)
+
+// Expands to nothing at runtime but keeps |msg| compiling, so stripped call
+// sites do not rot or leave variables unused.
+#define UT_LOG_STRIPPED(msg) \
+    do { \
+        if (false) { \
+            (void)(msg); \
+        } \
+    } while (0)
+
+#if UT_LOG_ACTIVE_LEVEL <= UT_LOG_LEVEL_TRACE
+#define UT_TRACE(msg) UT_LOG(utoolkit::logging::LogLevel::TRACE, msg)
+#else
+#define UT_TRACE(msg) UT_LOG_STRIPPED(msg)
+#endif
+
+#if UT_LOG_ACTIVE_LEVEL <= UT_LOG_LEVEL_DEBUG
+#define UT_DEBUG(msg) UT_LOG(utoolkit::logging::LogLevel::DEBUG, msg)
+#else
+#define UT_DEBUG(msg) UT_LOG_STRIPPED(msg)
+#endif
+
+#if UT_LOG_ACTIVE_LEVEL <= UT_LOG_LEVEL_INFO
+#define UT_INFO(msg) UT_LOG(utoolkit::logging::LogLevel::INFO, msg)
+#else
+#define UT_INFO(msg) UT_LOG_STRIPPED(msg)
+#endif
+
+#if UT_LOG_ACTIVE_LEVEL <= UT_LOG_LEVEL_WARN
+#define UT_WARN(msg) UT_LOG(utoolkit::logging::LogLevel::WARN, msg)
+#else
+#define UT_WARN(msg) UT_LOG_STRIPPED(msg)
+#endif
+
+#if UT_LOG_ACTIVE_LEVEL <= UT_LOG_LEVEL_ERROR
+#define UT_ERROR(msg) UT_LOG(utoolkit::logging::LogLevel::ERROR, msg)
+#else
+#define UT_ERROR(msg) UT_LOG_STRIPPED(msg)
+#endif
+
+#define UT_FATAL(msg) UT_LOG(utoolkit::logging::LogLevel::FATAL, msg)
 
 } // namespace logging
-} // namespace utoolkit
\ No newline at end of file
+} // namespace utoolkit
+
+// fmt-based UT_INFOF() and friends, available when built with fmt.
+#if defined(UT_LOG_HAVE_FMT) && UT_LOG_HAVE_FMT
+#include <utoolkit/logging/log_format.h>
+#endif
+
+// UT_LOG_EVERY_N() and the other sampled and rate limited macros.
+#include <utoolkit/logging/log_rate_limit.h>
+
+// UT_INFO_KV() and the other structured logging macros.
+#include <utoolkit/logging/log_kv.h>
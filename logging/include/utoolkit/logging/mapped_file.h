@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace utoolkit {
+namespace logging {
+
+struct MappedFileOptions {
+    // Bytes preallocated and mapped at a time, rounded up to whole pages.
+    // Crossing into the next extent costs an fallocate() and an mmap().
+    size_t extent_size = 32 * 1024 * 1024;
+
+    // Start writing back to disk every time this many bytes have been
+    // written and drop them from the mapping, which bounds the dirty and
+    // resident pages of the file; 0 leaves writeback to the kernel. Starting
+    // writeback may block the writer on a busy disk.
+    size_t writeback_bytes = 0;
+};
+
+// A log file appended to through a shared memory mapping, for the highest
+// volume logs: a write is a memcpy, with system calls only when a new extent
+// is mapped or writeback is started.
+//
+// The file is preallocated an extent at a time, so while it is open it is
+// longer than what was written and padded with NUL bytes, which readers such
+// as tail -f show. close() truncates it to the real length. A file left
+// padded by a crash is trimmed when opened again; log files therefore should
+// not end in NUL bytes of their own.
+//
+// Written data is in the page cache as soon as write() returns, so it
+// survives a crash of the process; sync() waits for it to reach the disk.
+//
+// Not thread safe, the owner serializes calls. POSIX only, open() fails
+// elsewhere.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Opens |filename| for appending, closing the current file first.
+    bool open(const std::string& filename, const MappedFileOptions& options = MappedFileOptions());
+    void close();
+    bool is_open() const { return fd_ >= 0; }
+    const std::string& filename() const { return filename_; }
+
+    // Bytes in the file, without the padding.
+    uint64_t size() const { return size_; }
+
+    // Closes the file and returns false if no space can be preallocated.
+    bool write(std::string_view data);
+
+    // Writes back everything written so far and waits for it.
+    void sync();
+
+    static bool is_supported();
+
+private:
+    // Maps the extent that starts at the page holding |size_|.
+    bool map_extent();
+    void unmap();
+    // Starts writeback of the pages written up to |size_|.
+    void start_writeback();
+
+    std::string filename_;
+    MappedFileOptions options_;
+    int fd_ = -1;
+
+    char* map_ = nullptr;
+    uint64_t map_offset_ = 0;
+    size_t map_size_ = 0;
+
+    uint64_t size_ = 0;
+    // Writeback has been started up to here.
+    uint64_t written_back_ = 0;
+};
+
+} // namespace logging
+} // namespace utoolkit
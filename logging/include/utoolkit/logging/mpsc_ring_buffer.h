@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace utoolkit {
+namespace logging {
+
+// Bounded lock-free queue for many producers and a single consumer.
+//
+// Every slot carries a sequence number that tells whether it is free for the
+// producer claiming its position or filled for the consumer. Producers only
+// contend on one compare-and-swap of the enqueue position; the consumer never
+// writes shared counters other than the slot it releases. Elements are filled
+// and consumed in place, so slots keep their buffers (e.g. std::string
+// capacity) and steady-state use does not allocate.
+template <typename T>
+class MpscRingBuffer {
+public:
+    // |capacity| is rounded up to a power of two, at least 2.
+    explicit MpscRingBuffer(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        slots_.reset(new Slot[size]);
+        for (size_t i = 0; i < size; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRingBuffer(const MpscRingBuffer&) = delete;
+    MpscRingBuffer& operator=(const MpscRingBuffer&) = delete;
+
+    // Claims a slot and calls |fill(T&)| on it. Returns false if the buffer is
+    // full. Any thread.
+    template <typename Fill>
+    bool try_push(Fill&& fill) {
+        uint64_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos & mask_];
+            const uint64_t seq = slot.sequence.load(std::memory_order_acquire);
+            const int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    fill(slot.value);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Calls |consume(T&)| on the oldest element and frees its slot. Returns
+    // false if the buffer is empty or the oldest element is still being
+    // filled. Consumer thread only.
+    template <typename Consume>
+    bool try_pop(Consume&& consume) {
+        Slot& slot = slots_[dequeue_pos_ & mask_];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1) {
+            return false;
+        }
+        consume(slot.value);
+        slot.sequence.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+        ++dequeue_pos_;
+        return true;
+    }
+
+    // Number of slots ever claimed by producers. Every element pushed before
+    // a call has been consumed once the consumer popped this many.
+    uint64_t push_count() const { return enqueue_pos_.load(std::memory_order_acquire); }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_ = 0;
+
+    // Kept on separate cache lines, producers and the consumer each own one.
+    alignas(64) std::atomic<uint64_t> enqueue_pos_ {0};
+    alignas(64) uint64_t dequeue_pos_ = 0;
+};
+
+} // namespace logging
+} // namespace utoolkit
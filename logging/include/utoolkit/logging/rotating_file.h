@@ -0,0 +1,115 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace utoolkit {
+namespace logging {
+
+enum class Compression {
+    NONE = 0,
+    GZIP = 1,   // .gz, needs zlib
+    ZSTD = 2    // .zst, needs libzstd
+};
+
+struct RotationOptions {
+    // Rotate before a write would take the file past this many bytes; 0 for
+    // no limit. A single write larger than this still goes to one file.
+    uint64_t max_file_size = 0;
+
+    // Rotate at multiples of this interval since the epoch, e.g. every hour
+    // on the hour; 0 for no time based rotation.
+    std::chrono::seconds interval {0};
+
+    // Rotated files to keep, the oldest are deleted; 0 keeps all of them.
+    size_t max_files = 0;
+
+    Compression compression = Compression::NONE;
+};
+
+// A log file that rotates by size and time.
+//
+// "app.log" is rotated by renaming it to "app.<UTC time>.log", e.g.
+// "app.20240131-235959.log", and opening a new "app.log". Only the rename
+// and the open happen in write(); compressing the rotated file and deleting
+// the ones beyond max_files is done by a background thread, started with the
+// first rotation.
+//
+// Not thread safe, the owner serializes calls. The background thread only
+// touches rotated files.
+class RotatingFile {
+public:
+    RotatingFile() = default;
+    // Finishes pending compression before returning.
+    ~RotatingFile();
+
+    RotatingFile(const RotatingFile&) = delete;
+    RotatingFile& operator=(const RotatingFile&) = delete;
+
+    // Opens |filename| for appending, closing the current file first.
+    bool open(const std::string& filename);
+    void close();
+    bool is_open() const { return file_.is_open(); }
+    const std::string& filename() const { return filename_; }
+
+    // May be changed at any time; a smaller max_files prunes right away.
+    // Unsupported compression falls back to NONE.
+    void set_options(const RotationOptions& options);
+    const RotationOptions& options() const { return options_; }
+
+    static bool is_supported(Compression compression);
+
+    // Rotates first if writing |data| at |now| is due for it.
+    void write(std::string_view data,
+               std::chrono::system_clock::time_point now = std::chrono::system_clock::now());
+    void flush();
+
+    // Waits until the background thread has compressed and pruned everything
+    // rotated so far.
+    void wait_idle();
+
+private:
+    // Work for the background thread: compress |archive| unless empty, then
+    // prune the rotated files of |filename|.
+    struct Job {
+        std::string filename;
+        std::string archive;
+        Compression compression;
+        size_t max_files;
+    };
+
+    void rotate(std::chrono::system_clock::time_point now);
+    void schedule_next_rotation(std::chrono::system_clock::time_point now);
+    std::string archive_name(std::chrono::system_clock::time_point now);
+    void post(Job job);
+    void run_worker();
+
+    std::string filename_;
+    std::ofstream file_;
+    uint64_t size_ = 0;
+    RotationOptions options_;
+    std::chrono::system_clock::time_point next_rotation_ = std::chrono::system_clock::time_point::max();
+    // The stamp of the last archive and the sequence number of the next one
+    // with that stamp.
+    std::string last_stamp_;
+    unsigned long next_sequence_ = 0;
+
+    std::thread worker_;
+    std::mutex jobs_mutex_;
+    std::condition_variable jobs_cv_;
+    std::condition_variable idle_cv_;
+    std::deque<Job> jobs_;
+    bool working_ = false;
+    bool stop_ = false;
+};
+
+} // namespace logging
+} // namespace utoolkit
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <utoolkit/logging/log_level.h>
+#include <utoolkit/logging/mapped_file.h>
+#include <utoolkit/logging/rotating_file.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace utoolkit {
+namespace logging {
+
+// When a sink writes buffered messages to its output. With the defaults every
+// message is written and flushed right away.
+struct FlushPolicy {
+    // Gather up to this many bytes before writing; 0 for no size limit.
+    size_t buffer_size = 0;
+
+    // Write buffered messages once the oldest is this old; 0 for no limit.
+    // Checked on every write, by Logger::flush() and, in async mode, by the
+    // writer thread while idle.
+    std::chrono::milliseconds max_delay {0};
+
+    // Messages at or above this level are written right away along with
+    // everything buffered before them.
+    LogLevel flush_level = LogLevel::WARN;
+
+    // Buffering is off when neither a size nor a delay is set.
+    bool buffered() const { return buffer_size > 0 || max_delay.count() > 0; }
+};
+
+// A destination of formatted log lines with its own level and flush policy.
+//
+// Every sink has its own lock, so sinks do not wait for each other's output.
+// Implementations only provide write_output() and flush_output(), which are
+// called with |mutex_| held.
+class Sink {
+public:
+    Sink() = default;
+    virtual ~Sink() = default;
+
+    Sink(const Sink&) = delete;
+    Sink& operator=(const Sink&) = delete;
+
+    // Messages below |level| are skipped; everything by default.
+    void set_level(LogLevel level);
+    LogLevel level() const;
+    bool should_log(LogLevel level) const;
+
+    void set_flush_policy(const FlushPolicy& policy);
+    FlushPolicy flush_policy() const;
+
+    // Takes |data|, one or more complete lines whose highest level is
+    // |level|, and writes out what is buffered if the policy says so.
+    void write(LogLevel level, std::string_view data,
+               std::chrono::system_clock::time_point now = std::chrono::system_clock::now());
+
+    // Writes out everything buffered and flushes the output.
+    void flush();
+
+    // Writes out buffered messages older than the policy's max_delay.
+    void flush_if_due(std::chrono::system_clock::time_point now = std::chrono::system_clock::now());
+
+protected:
+    virtual void write_output(std::string_view data, std::chrono::system_clock::time_point now) = 0;
+    virtual void flush_output() {}
+
+    // Writes out the buffer; |mutex_| must be held.
+    void flush_locked(std::chrono::system_clock::time_point now);
+
+    // Guards the buffer, the policy and the output of derived classes.
+    mutable std::mutex mutex_;
+
+private:
+    std::atomic<LogLevel> level_ {LogLevel::TRACE};
+    FlushPolicy policy_;
+    std::string buffer_;
+    std::chrono::system_clock::time_point oldest_;
+};
+
+// Writes to std::cout or another stream.
+class ConsoleSink : public Sink {
+public:
+    explicit ConsoleSink(std::ostream& stream = std::cout);
+    ~ConsoleSink() override;
+
+protected:
+    void write_output(std::string_view data, std::chrono::system_clock::time_point now) override;
+    void flush_output() override;
+
+private:
+    std::ostream& stream_;
+};
+
+// Appends to a file.
+class FileSink : public Sink {
+public:
+    FileSink() = default;
+    explicit FileSink(const std::string& filename);
+    ~FileSink() override;
+
+    // Writes out what is buffered for the current file, then switches.
+    bool open(const std::string& filename);
+    bool is_open() const;
+
+protected:
+    void write_output(std::string_view data, std::chrono::system_clock::time_point now) override;
+    void flush_output() override;
+
+private:
+    std::ofstream file_;
+};
+
+// Appends to a file that rotates by size and time, see RotatingFile.
+class RotatingFileSink : public Sink {
+public:
+    RotatingFileSink() = default;
+    explicit RotatingFileSink(const std::string& filename, const RotationOptions& options = RotationOptions());
+    ~RotatingFileSink() override;
+
+    bool open(const std::string& filename);
+    bool is_open() const;
+
+    // May be changed at any time.
+    void set_rotation(const RotationOptions& options);
+
+    // Waits for background compression and pruning.
+    void wait_idle();
+
+protected:
+    void write_output(std::string_view data, std::chrono::system_clock::time_point now) override;
+    void flush_output() override;
+
+private:
+    RotatingFile file_;
+};
+
+// Appends to a memory mapped file, see MappedFile. A message is in the file
+// once written, so flushing has nothing left to do; buffering only adds a
+// copy.
+class MappedFileSink : public Sink {
+public:
+    MappedFileSink() = default;
+    explicit MappedFileSink(const std::string& filename, const MappedFileOptions& options = MappedFileOptions());
+    ~MappedFileSink() override;
+
+    // Truncates the current file to its contents, then switches; reopening
+    // the same name lets external rotation take effect.
+    bool open(const std::string& filename, const MappedFileOptions& options = MappedFileOptions());
+    void close();
+    bool is_open() const;
+
+    // Waits until everything written is on disk.
+    void sync();
+
+protected:
+    void write_output(std::string_view data, std::chrono::system_clock::time_point now) override;
+
+private:
+    MappedFile file_;
+};
+
+// Keeps the last |capacity| lines in memory, e.g. for tests or to attach
+// recent log output to a crash report.
+class RingSink : public Sink {
+public:
+    explicit RingSink(size_t capacity);
+
+    // Oldest first, without line breaks.
+    std::vector<std::string> lines() const;
+    void clear();
+
+protected:
+    void write_output(std::string_view data, std::chrono::system_clock::time_point now) override;
+
+private:
+    const size_t capacity_;
+    std::deque<std::string> lines_;
+};
+
+// Discards everything; measures the cost of logging without output.
+class NullSink : public Sink {
+public:
+    uint64_t bytes_written() const { return bytes_.load(std::memory_order_relaxed); }
+
+protected:
+    void write_output(std::string_view data, std::chrono::system_clock::time_point now) override;
+
+private:
+    std::atomic<uint64_t> bytes_ {0};
+};
+
+} // namespace logging
+} // namespace utoolkit
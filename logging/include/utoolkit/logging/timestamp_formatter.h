@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace utoolkit {
+namespace logging {
+
+// Formats "YYYY-MM-DD HH:MM:SS.mmm" (or .uuuuuu) timestamps.
+//
+// The date and time up to the seconds only change once per second, so that
+// prefix is cached and only the fraction digits are written per call. The
+// cache is shared by all threads through a sequence lock: readers copy it
+// without blocking and retry on a concurrent update; whoever sees a new second
+// converts it (with the reentrant localtime_r/gmtime_r) and publishes it.
+class TimestampFormatter {
+public:
+    enum class Zone {
+        LOCAL = 0,
+        UTC = 1
+    };
+
+    enum class Precision {
+        MILLISECONDS = 0,
+        MICROSECONDS = 1
+    };
+
+    // Longest output of format().
+    static constexpr size_t kMaxLength = 26;
+
+    explicit TimestampFormatter(Zone zone = Zone::LOCAL, Precision precision = Precision::MILLISECONDS);
+
+    // May be called while other threads format.
+    void set_zone(Zone zone);
+    void set_precision(Precision precision);
+    Zone zone() const;
+    Precision precision() const;
+
+    // Writes the timestamp of |time| to |out|, which must hold kMaxLength
+    // bytes, and returns its length. Thread safe and lock-free.
+    size_t format(std::chrono::system_clock::time_point time, char* out);
+
+    void append(std::string& out, std::chrono::system_clock::time_point time);
+
+private:
+    // "YYYY-MM-DD HH:MM:SS." padded to whole words.
+    static constexpr size_t kPrefixLength = 20;
+    static constexpr size_t kPrefixWords = 3;
+
+    static void format_prefix(int64_t seconds, Zone zone, char* out);
+
+    std::atomic<int> zone_;
+    std::atomic<int> precision_;
+
+    // Sequence lock around the cached prefix: odd while it is written.
+    std::atomic<uint32_t> seq_ {0};
+    std::atomic<int64_t> cached_second_;
+    std::atomic<int> cached_zone_ {-1};
+    std::array<std::atomic<uint64_t>, kPrefixWords> cached_prefix_ {};
+};
+
+} // namespace logging
+} // namespace utoolkit
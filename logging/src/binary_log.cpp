@@ -0,0 +1,212 @@
+#include <utoolkit/logging/binary_log.h>
+#include <iostream>
+
+namespace utoolkit {
+namespace logging {
+
+namespace {
+
+template <typename T>
+void put(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void put_string(std::string& out, std::string_view value) {
+    const uint16_t size = static_cast<uint16_t>(std::min<size_t>(value.size(), UINT16_MAX));
+    put(out, size);
+    out.append(value.data(), size);
+}
+
+int64_t wall_clock_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Ticks per second of BinaryLogger::ticks(). The TSC rate is measured against
+// steady_clock; clock sync entries let the decoder correct for the error.
+uint64_t measure_ticks_per_second() {
+#if defined(UT_BINARY_LOG_HAVE_TSC)
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t start_ticks = BinaryLogger::ticks();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    const uint64_t end_ticks = BinaryLogger::ticks();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    if (elapsed <= 0 || end_ticks <= start_ticks) {
+        return 1000000000;
+    }
+    return static_cast<uint64_t>(static_cast<double>(end_ticks - start_ticks) * 1e9 / static_cast<double>(elapsed));
+#else
+    return 1000000000;
+#endif
+}
+
+} // namespace
+
+// Returns the buffer of a thread to the logger when the thread exits.
+struct BinaryThreadHolder {
+    detail::BinaryThreadBuffer* buffer = nullptr;
+
+    ~BinaryThreadHolder() {
+        if (buffer != nullptr) {
+            BinaryLogger::instance().detach_thread(buffer);
+        }
+    }
+};
+
+BinaryLogger& BinaryLogger::instance() {
+    static BinaryLogger instance;
+    return instance;
+}
+
+BinaryLogger::~BinaryLogger() {
+    close();
+}
+
+bool BinaryLogger::open(const std::string& filename) {
+    close();
+
+    const uint64_t ticks_per_second = measure_ticks_per_second();
+
+    std::lock_guard<std::mutex> sites_lock(sites_mutex_);
+    std::lock_guard<std::mutex> file_lock(file_mutex_);
+
+    file_.open(filename, std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) {
+        std::cerr << "Failed to open binary log file: " << filename << std::endl;
+        return false;
+    }
+    ticks_per_second_ = ticks_per_second;
+
+    std::string header(kBinaryLogMagic, sizeof(kBinaryLogMagic));
+    put(header, ticks_per_second_);
+    put(header, ticks());
+    put(header, wall_clock_ns());
+    file_.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+    // Sites registered while no file was open.
+    for (size_t i = 0; i < sites_.size(); ++i) {
+        write_descriptor(static_cast<uint32_t>(i + 1), sites_[i]);
+    }
+
+    open_.store(true, std::memory_order_release);
+    return true;
+}
+
+void BinaryLogger::close() {
+    if (!open_.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    flush();
+    open_.store(false, std::memory_order_release);
+
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    write_clock_sync();
+    file_.close();
+}
+
+void BinaryLogger::flush() {
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        for (const auto& buffer : buffers_) {
+            while (buffer->busy.exchange(true, std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            drain(*buffer);
+            buffer->busy.store(false, std::memory_order_release);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    if (file_.is_open()) {
+        file_.flush();
+    }
+}
+
+uint32_t BinaryLogger::register_site(BinaryLogSite& site, const char* arg_types) {
+    std::lock_guard<std::mutex> lock(sites_mutex_);
+
+    // Another thread may have registered it meanwhile.
+    uint32_t id = site.id.load(std::memory_order_relaxed);
+    if (id != 0) {
+        return id;
+    }
+
+    sites_.push_back(Descriptor{&site, arg_types});
+    id = static_cast<uint32_t>(sites_.size());
+    {
+        std::lock_guard<std::mutex> file_lock(file_mutex_);
+        if (file_.is_open()) {
+            write_descriptor(id, sites_.back());
+        }
+    }
+    site.id.store(id, std::memory_order_release);
+    return id;
+}
+
+detail::BinaryThreadBuffer* BinaryLogger::attach_thread() {
+    thread_local BinaryThreadHolder holder;
+
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if (!free_buffers_.empty()) {
+        holder.buffer = free_buffers_.back();
+        free_buffers_.pop_back();
+    } else {
+        buffers_.push_back(std::make_unique<detail::BinaryThreadBuffer>());
+        holder.buffer = buffers_.back().get();
+        holder.buffer->data.reset(new char[kBinaryThreadBufferBytes]);
+    }
+    detail::t_binary_buffer = holder.buffer;
+    return holder.buffer;
+}
+
+void BinaryLogger::detach_thread(detail::BinaryThreadBuffer* buffer) {
+    detail::t_binary_buffer = nullptr;
+
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    while (buffer->busy.exchange(true, std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    drain(*buffer);
+    buffer->busy.store(false, std::memory_order_release);
+    free_buffers_.push_back(buffer);
+}
+
+void BinaryLogger::drain(detail::BinaryThreadBuffer& buffer) {
+    if (buffer.size == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    if (file_.is_open()) {
+        write_clock_sync();
+        file_.write(buffer.data.get(), static_cast<std::streamsize>(buffer.size));
+    }
+    buffer.size = 0;
+}
+
+void BinaryLogger::write_descriptor(uint32_t id, const Descriptor& descriptor) {
+    std::string entry;
+    put(entry, uint32_t {0});
+    put(entry, BinaryEntry::DESCRIPTOR);
+    put(entry, id);
+    put(entry, static_cast<uint8_t>(descriptor.site->level));
+    put(entry, static_cast<uint32_t>(descriptor.site->line));
+    put_string(entry, descriptor.site->file);
+    put_string(entry, descriptor.site->format);
+    put_string(entry, descriptor.arg_types);
+    file_.write(entry.data(), static_cast<std::streamsize>(entry.size()));
+}
+
+void BinaryLogger::write_clock_sync() {
+    std::string entry;
+    put(entry, uint32_t {0});
+    put(entry, BinaryEntry::CLOCK_SYNC);
+    put(entry, ticks());
+    put(entry, wall_clock_ns());
+    file_.write(entry.data(), static_cast<std::streamsize>(entry.size()));
+}
+
+} // namespace logging
+} // namespace utoolkit
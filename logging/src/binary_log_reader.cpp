@@ -0,0 +1,280 @@
+#include <utoolkit/logging/binary_log_reader.h>
+#include <utoolkit/logging/binary_log.h>
+#include <charconv>
+#include <cstring>
+
+#if defined(UT_LOG_HAVE_FMT) && UT_LOG_HAVE_FMT
+#include <fmt/args.h>
+#include <fmt/format.h>
+#endif
+
+namespace utoolkit {
+namespace logging {
+
+namespace {
+
+// The wall clock rate is refined from clock syncs at least this far apart.
+constexpr int64_t kMinCalibrationNs = 1000000000;
+
+size_t arg_size(char type) {
+    switch (type) {
+        case '?': case 'c': case 'b': case 'B': return 1;
+        case 'h': case 'H': return 2;
+        case 'i': case 'I': case 'f': return 4;
+        case 'q': case 'Q': case 'd': case 'P': return 8;
+        default: return 0;
+    }
+}
+
+template <typename T>
+void append_number(std::string& out, T value) {
+    char buffer[64];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+} // namespace
+
+bool BinaryLogReader::open(const std::string& filename) {
+    file_.close();
+    file_.clear();
+    error_.clear();
+    sites_.clear();
+
+    file_.open(filename, std::ios::binary);
+    if (!file_.is_open()) {
+        return fail("cannot open " + filename);
+    }
+
+    char magic[sizeof(kBinaryLogMagic)];
+    uint64_t ticks_per_second = 0;
+    if (!read_bytes(magic, sizeof(magic)) || std::memcmp(magic, kBinaryLogMagic, sizeof(magic)) != 0 ||
+        !read_bytes(&ticks_per_second, sizeof(ticks_per_second)) || ticks_per_second == 0 ||
+        !read_bytes(&start_ticks_, sizeof(start_ticks_)) ||
+        !read_bytes(&start_wall_ns_, sizeof(start_wall_ns_))) {
+        return fail(filename + " is not a binary log");
+    }
+    ticks_per_ns_ = static_cast<double>(ticks_per_second) / 1e9;
+    sync_ticks_ = start_ticks_;
+    sync_wall_ns_ = start_wall_ns_;
+    return true;
+}
+
+bool BinaryLogReader::next(BinaryLogRecord& record) {
+    while (file_.is_open()) {
+        uint32_t id = 0;
+        file_.read(reinterpret_cast<char*>(&id), sizeof(id));
+        if (file_.gcount() == 0 && file_.eof()) {
+            return false;
+        }
+        if (file_.gcount() != sizeof(id)) {
+            return fail("truncated entry");
+        }
+
+        if (id != 0) {
+            return read_record(id, record);
+        }
+
+        BinaryEntry entry;
+        if (!read_bytes(&entry, sizeof(entry))) {
+            return fail("truncated entry");
+        }
+        switch (entry) {
+            case BinaryEntry::DESCRIPTOR:
+                if (!read_descriptor()) {
+                    return false;
+                }
+                break;
+            case BinaryEntry::CLOCK_SYNC:
+                if (!read_clock_sync()) {
+                    return false;
+                }
+                break;
+            default:
+                return fail("unknown entry type " + std::to_string(static_cast<int>(entry)));
+        }
+    }
+    return false;
+}
+
+bool BinaryLogReader::read_bytes(void* out, size_t size) {
+    file_.read(static_cast<char*>(out), static_cast<std::streamsize>(size));
+    return static_cast<size_t>(file_.gcount()) == size;
+}
+
+bool BinaryLogReader::read_string(std::string& out) {
+    uint16_t size = 0;
+    if (!read_bytes(&size, sizeof(size))) {
+        return false;
+    }
+    out.resize(size);
+    return read_bytes(out.data(), size);
+}
+
+bool BinaryLogReader::read_descriptor() {
+    uint32_t id = 0;
+    uint8_t level = 0;
+    uint32_t line = 0;
+    Site site;
+    if (!read_bytes(&id, sizeof(id)) || !read_bytes(&level, sizeof(level)) || !read_bytes(&line, sizeof(line)) ||
+        !read_string(site.file) || !read_string(site.format) || !read_string(site.arg_types)) {
+        return fail("truncated descriptor");
+    }
+    if (id == 0) {
+        return fail("invalid descriptor id");
+    }
+    for (char type : site.arg_types) {
+        if (type != 's' && arg_size(type) == 0) {
+            return fail(std::string("unknown argument type '") + type + "'");
+        }
+    }
+    site.known = true;
+    site.level = static_cast<LogLevel>(level);
+    site.line = static_cast<int>(line);
+
+    if (sites_.size() < id) {
+        sites_.resize(id);
+    }
+    sites_[id - 1] = std::move(site);
+    return true;
+}
+
+bool BinaryLogReader::read_clock_sync() {
+    uint64_t ticks = 0;
+    int64_t wall_ns = 0;
+    if (!read_bytes(&ticks, sizeof(ticks)) || !read_bytes(&wall_ns, sizeof(wall_ns))) {
+        return fail("truncated clock sync");
+    }
+    if (wall_ns - start_wall_ns_ >= kMinCalibrationNs && ticks > start_ticks_) {
+        ticks_per_ns_ = static_cast<double>(ticks - start_ticks_) / static_cast<double>(wall_ns - start_wall_ns_);
+    }
+    sync_ticks_ = ticks;
+    sync_wall_ns_ = wall_ns;
+    return true;
+}
+
+bool BinaryLogReader::read_record(uint32_t id, BinaryLogRecord& record) {
+    if (id > sites_.size() || !sites_[id - 1].known) {
+        return fail("record of unknown site " + std::to_string(id));
+    }
+    const Site& site = sites_[id - 1];
+
+    uint64_t ticks = 0;
+    if (!read_bytes(&ticks, sizeof(ticks))) {
+        return fail("truncated record");
+    }
+
+    args_.resize(site.arg_types.size());
+    for (size_t i = 0; i < site.arg_types.size(); ++i) {
+        Arg& arg = args_[i];
+        arg.type = site.arg_types[i];
+        bool ok = true;
+        switch (arg.type) {
+            case 's': ok = read_string(arg.s); break;
+            case '?': case 'c': case 'B': { uint8_t v; ok = read_bytes(&v, 1); arg.u = v; break; }
+            case 'H': { uint16_t v; ok = read_bytes(&v, 2); arg.u = v; break; }
+            case 'I': { uint32_t v; ok = read_bytes(&v, 4); arg.u = v; break; }
+            case 'Q': case 'P': ok = read_bytes(&arg.u, 8); break;
+            case 'b': { int8_t v; ok = read_bytes(&v, 1); arg.i = v; break; }
+            case 'h': { int16_t v; ok = read_bytes(&v, 2); arg.i = v; break; }
+            case 'i': { int32_t v; ok = read_bytes(&v, 4); arg.i = v; break; }
+            case 'q': ok = read_bytes(&arg.i, 8); break;
+            case 'f': ok = read_bytes(&arg.f, 4); break;
+            case 'd': ok = read_bytes(&arg.d, 8); break;
+            default: ok = false; break;
+        }
+        if (!ok) {
+            return fail("truncated record");
+        }
+    }
+
+    record.level = site.level;
+    record.time = to_wall_clock(ticks);
+    record.file = site.file;
+    record.line = site.line;
+    record.message.clear();
+    format_message(site.format, args_, record.message);
+    return true;
+}
+
+bool BinaryLogReader::fail(const std::string& error) {
+    error_ = error;
+    file_.close();
+    return false;
+}
+
+std::chrono::system_clock::time_point BinaryLogReader::to_wall_clock(uint64_t ticks) const {
+    // Signed, records of a chunk may precede its clock sync.
+    const double delta_ticks = ticks >= sync_ticks_ ? static_cast<double>(ticks - sync_ticks_)
+                                                     : -static_cast<double>(sync_ticks_ - ticks);
+    const int64_t wall_ns = sync_wall_ns_ + static_cast<int64_t>(delta_ticks / ticks_per_ns_);
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(wall_ns)));
+}
+
+void BinaryLogReader::format_message(const std::string& format, const std::vector<Arg>& args, std::string& out) {
+#if defined(UT_LOG_HAVE_FMT) && UT_LOG_HAVE_FMT
+    fmt::dynamic_format_arg_store<fmt::format_context> store;
+    for (const Arg& arg : args) {
+        switch (arg.type) {
+            case 's': store.push_back(arg.s); break;
+            case '?': store.push_back(arg.u != 0); break;
+            case 'c': store.push_back(static_cast<char>(arg.u)); break;
+            case 'B': case 'H': case 'I': case 'Q': store.push_back(arg.u); break;
+            case 'b': case 'h': case 'i': case 'q': store.push_back(arg.i); break;
+            case 'f': store.push_back(arg.f); break;
+            case 'd': store.push_back(arg.d); break;
+            case 'P': store.push_back(reinterpret_cast<const void*>(static_cast<uintptr_t>(arg.u))); break;
+        }
+    }
+    try {
+        fmt::vformat_to(std::back_inserter(out), format, store);
+        return;
+    } catch (const fmt::format_error&) {
+        // A spec that does not fit the argument; fall back to plain output.
+        out.clear();
+    }
+#endif
+
+    size_t next_arg = 0;
+    for (size_t i = 0; i < format.size(); ++i) {
+        const char c = format[i];
+        if ((c == '{' || c == '}') && i + 1 < format.size() && format[i + 1] == c) {
+            out += c;
+            ++i;
+            continue;
+        }
+        if (c != '{') {
+            out += c;
+            continue;
+        }
+
+        const size_t end = format.find('}', i);
+        if (end == std::string::npos || next_arg >= args.size()) {
+            out.append(format, i, std::string::npos);
+            break;
+        }
+        i = end;
+
+        const Arg& arg = args[next_arg++];
+        switch (arg.type) {
+            case 's': out += arg.s; break;
+            case '?': out += arg.u != 0 ? "true" : "false"; break;
+            case 'c': out += static_cast<char>(arg.u); break;
+            case 'B': case 'H': case 'I': case 'Q': append_number(out, arg.u); break;
+            case 'b': case 'h': case 'i': case 'q': append_number(out, arg.i); break;
+            case 'f': append_number(out, arg.f); break;
+            case 'd': append_number(out, arg.d); break;
+            case 'P': {
+                out += "0x";
+                char buffer[16];
+                const auto result = std::to_chars(buffer, buffer + sizeof(buffer), arg.u, 16);
+                out.append(buffer, result.ptr);
+                break;
+            }
+        }
+    }
+}
+
+} // namespace logging
+} // namespace utoolkit
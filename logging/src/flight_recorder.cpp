@@ -0,0 +1,511 @@
+#include <utoolkit/logging/flight_recorder.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <memory>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+namespace utoolkit {
+namespace logging {
+
+namespace {
+
+// A recorded message; trivially copyable so that a dump can take a snapshot.
+struct Record {
+    int64_t time_ns;
+    uint32_t thread;
+    int32_t line;
+    LogLevel level;
+    uint16_t message_size;
+    uint8_t file_size;
+    char file[FlightRecorder::kMaxFileBytes];
+    char message[FlightRecorder::kMaxMessageBytes];
+};
+
+constexpr int kCrashSignals[] = {
+    SIGSEGV, SIGABRT, SIGFPE, SIGILL,
+#ifdef SIGBUS
+    SIGBUS,
+#endif
+};
+constexpr size_t kCrashSignalCount = sizeof(kCrashSignals) / sizeof(kCrashSignals[0]);
+
+#ifdef _WIN32
+using SignalHandler = void (*)(int);
+SignalHandler g_previous[kCrashSignalCount];
+#else
+struct sigaction g_previous[kCrashSignalCount];
+
+// For crashes on stack overflow, see install_handlers().
+alignas(16) char g_signal_stack[64 * 1024];
+#endif
+
+FlightRecorder* g_recorder = nullptr;
+
+uint32_t current_thread_id() {
+#if defined(__linux__)
+    return static_cast<uint32_t>(::syscall(SYS_gettid));
+#else
+    static std::atomic<uint32_t> next_id {1};
+    return next_id.fetch_add(1, std::memory_order_relaxed);
+#endif
+}
+
+const char* signal_name(int signal) {
+    switch (signal) {
+        case SIGSEGV: return "SIGSEGV";
+        case SIGABRT: return "SIGABRT";
+        case SIGFPE: return "SIGFPE";
+        case SIGILL: return "SIGILL";
+#ifdef SIGBUS
+        case SIGBUS: return "SIGBUS";
+#endif
+        default: return "signal";
+    }
+}
+
+const char* level_name(LogLevel level) {
+    switch (level) {
+        case LogLevel::TRACE: return "TRACE";
+        case LogLevel::DEBUG: return "DEBUG";
+        case LogLevel::INFO: return "INFO";
+        case LogLevel::WARN: return "WARN";
+        case LogLevel::ERROR: return "ERROR";
+        case LogLevel::FATAL: return "FATAL";
+        default: return "UNKNOWN";
+    }
+}
+
+bool write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+#ifdef _WIN32
+        const int written = ::_write(fd, data, static_cast<unsigned>(size));
+#else
+        const ssize_t written = ::write(fd, data, size);
+#endif
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// Copies at most a few hundred bytes. GCC expands a memcpy of bounded size
+// into rep movs, whose startup cost dominates at these sizes; fixed size
+// blocks become plain vector moves.
+void copy_short(char* out, const char* in, size_t size) {
+    for (; size >= 16; size -= 16, out += 16, in += 16) {
+        std::memcpy(out, in, 16);
+    }
+    for (; size > 0; --size) {
+        *out++ = *in++;
+    }
+}
+
+// Builds one line in a fixed buffer; everything here is async-signal-safe.
+class LineBuilder {
+public:
+    void append(const char* data, size_t size) {
+        size = std::min(size, sizeof(buffer_) - size_);
+        std::memcpy(buffer_ + size_, data, size);
+        size_ += size;
+    }
+
+    void append(const char* text) { append(text, std::strlen(text)); }
+
+    // Zero padded to |width| digits.
+    void append_number(uint64_t value, int width = 1) {
+        char digits[20];
+        int count = 0;
+        do {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value > 0 && count < 20);
+        for (int i = count; i < width; ++i) {
+            append("0", 1);
+        }
+        while (count > 0) {
+            append(&digits[--count], 1);
+        }
+    }
+
+    // "YYYY-mm-dd HH:MM:SS.uuuuuu" in UTC; localtime is not signal safe.
+    void append_time(int64_t time_ns) {
+        const int64_t micros = time_ns / 1000;
+        int64_t days = micros / 86400000000LL;
+        int64_t rest = micros % 86400000000LL;
+        if (rest < 0) {
+            rest += 86400000000LL;
+            --days;
+        }
+
+        // Civil date from days since 1970-01-01, proleptic Gregorian.
+        days += 719468;
+        const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+        const int64_t day_of_era = days - era * 146097;
+        const int64_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+        const int64_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+        const int64_t month_index = (5 * day_of_year + 2) / 153;
+        const int64_t day = day_of_year - (153 * month_index + 2) / 5 + 1;
+        const int64_t month = month_index < 10 ? month_index + 3 : month_index - 9;
+        const int64_t year = year_of_era + era * 400 + (month <= 2 ? 1 : 0);
+
+        append_number(static_cast<uint64_t>(year), 4);
+        append("-", 1);
+        append_number(static_cast<uint64_t>(month), 2);
+        append("-", 1);
+        append_number(static_cast<uint64_t>(day), 2);
+        append(" ", 1);
+        append_number(static_cast<uint64_t>(rest / 3600000000LL), 2);
+        append(":", 1);
+        append_number(static_cast<uint64_t>(rest / 60000000 % 60), 2);
+        append(":", 1);
+        append_number(static_cast<uint64_t>(rest / 1000000 % 60), 2);
+        append(".", 1);
+        append_number(static_cast<uint64_t>(rest % 1000000), 6);
+    }
+
+    bool write_to(int fd) const { return write_all(fd, buffer_, size_); }
+
+private:
+    char buffer_[512];
+    size_t size_ = 0;
+};
+
+} // namespace
+
+struct FlightRecorder::Slot {
+    // Even while stable: twice the number of writes to the slot so far.
+    std::atomic<uint32_t> seq {0};
+    Record record;
+};
+
+struct FlightRecorder::Ring {
+    explicit Ring(size_t size) : capacity(size), slots(new Slot[size]) {}
+
+    // Copies the record at |index| if it is complete and not overwritten.
+    bool read(uint64_t index, Record& out) const {
+        const Slot& slot = slots[index & (capacity - 1)];
+        const auto expected = static_cast<uint32_t>(2 * (index / capacity + 1));
+        if (slot.seq.load(std::memory_order_acquire) != expected) {
+            return false;
+        }
+        std::memcpy(&out, &slot.record, sizeof(Record));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.seq.load(std::memory_order_relaxed) == expected;
+    }
+
+    const size_t capacity;
+    const std::unique_ptr<Slot[]> slots;
+    Ring* next = nullptr;
+
+    // Set while a thread owns the ring.
+    std::atomic<bool> in_use {false};
+
+    // Records written so far, by the owning thread only.
+    std::atomic<uint64_t> head {0};
+    // Records before this one have been cleared.
+    std::atomic<uint64_t> floor {0};
+
+    // Merge state of a dump, guarded by |dumping_|.
+    uint64_t cursor = 0;
+    uint64_t end = 0;
+    bool has_pending = false;
+    Record pending;
+
+    void advance() {
+        has_pending = false;
+        while (cursor < end && !has_pending) {
+            has_pending = read(cursor++, pending);
+        }
+    }
+};
+
+struct FlightRecorder::RingOwner {
+    Ring* ring = nullptr;
+    uint32_t thread = 0;
+
+    ~RingOwner() {
+        if (ring != nullptr) {
+            ring->in_use.store(false, std::memory_order_release);
+        }
+    }
+};
+
+FlightRecorder& FlightRecorder::instance() {
+    static FlightRecorder instance;
+    return instance;
+}
+
+void FlightRecorder::enable(const FlightRecorderOptions& options) {
+    size_t capacity = 1;
+    while (capacity < options.records_per_thread) {
+        capacity <<= 1;
+    }
+    records_per_thread_.store(capacity, std::memory_order_relaxed);
+    level_.store(options.level, std::memory_order_relaxed);
+
+    const size_t length = std::min(options.dump_file.size(), sizeof(dump_path_) - 1);
+    std::memcpy(dump_path_, options.dump_file.data(), length);
+    dump_path_[length] = '\0';
+
+    g_recorder = this;
+    if (options.dump_on_crash) {
+        install_handlers();
+    } else {
+        restore_handlers();
+    }
+    enabled_.store(true, std::memory_order_release);
+}
+
+void FlightRecorder::disable() {
+    enabled_.store(false, std::memory_order_relaxed);
+    restore_handlers();
+}
+
+void FlightRecorder::record(LogLevel level, std::string_view message, std::string_view fields,
+                            std::string_view file, int line) {
+    if (!captures(level)) {
+        return;
+    }
+
+    thread_local RingOwner owner;
+    if (owner.ring == nullptr) {
+        owner.ring = acquire_ring();
+        owner.thread = current_thread_id();
+    }
+    Ring& ring = *owner.ring;
+
+    const uint64_t index = ring.head.load(std::memory_order_relaxed);
+    Slot& slot = ring.slots[index & (ring.capacity - 1)];
+    const uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+    slot.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    Record& record = slot.record;
+    record.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    record.thread = owner.thread;
+    record.line = line;
+    record.level = level;
+    const size_t message_size = std::min(message.size(), kMaxMessageBytes);
+    const size_t fields_size = std::min(fields.size(), kMaxMessageBytes - message_size);
+    copy_short(record.message, message.data(), message_size);
+    copy_short(record.message + message_size, fields.data(), fields_size);
+    record.message_size = static_cast<uint16_t>(message_size + fields_size);
+    // The end of the path is the part worth keeping.
+    if (file.size() > kMaxFileBytes) {
+        file.remove_prefix(file.size() - kMaxFileBytes);
+    }
+    record.file_size = static_cast<uint8_t>(file.size());
+    copy_short(record.file, file.data(), file.size());
+
+    slot.seq.store(seq + 2, std::memory_order_release);
+    ring.head.store(index + 1, std::memory_order_release);
+}
+
+FlightRecorder::Ring* FlightRecorder::acquire_ring() {
+    const size_t capacity = records_per_thread_.load(std::memory_order_relaxed);
+    for (Ring* ring = rings_.load(std::memory_order_acquire); ring != nullptr; ring = ring->next) {
+        bool expected = false;
+        if (ring->capacity == capacity && !ring->in_use.load(std::memory_order_relaxed) &&
+            ring->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            return ring;
+        }
+    }
+
+    // Never freed: a signal handler may walk the list at any time.
+    Ring* ring = new Ring(capacity);
+    ring->in_use.store(true, std::memory_order_relaxed);
+    ring->next = rings_.load(std::memory_order_relaxed);
+    while (!rings_.compare_exchange_weak(ring->next, ring, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    return ring;
+}
+
+void FlightRecorder::clear() {
+    for (Ring* ring = rings_.load(std::memory_order_acquire); ring != nullptr; ring = ring->next) {
+        ring->floor.store(ring->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
+
+bool FlightRecorder::dump() {
+    return dump_file(dump_path_, nullptr);
+}
+
+bool FlightRecorder::dump(const char* path) {
+    return dump_file(path, nullptr);
+}
+
+bool FlightRecorder::dump_to_fd(int fd) {
+    return write_dump(fd, nullptr);
+}
+
+bool FlightRecorder::dump_file(const char* path, const char* reason) {
+#ifdef _WIN32
+    const int fd = ::_open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    const int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif
+    if (fd < 0) {
+        return false;
+    }
+    const bool ok = write_dump(fd, reason);
+#ifdef _WIN32
+    ::_close(fd);
+#else
+    ::close(fd);
+#endif
+    return ok;
+}
+
+bool FlightRecorder::write_dump(int fd, const char* reason) {
+    if (dumping_.test_and_set(std::memory_order_acquire)) {
+        return false;
+    }
+
+    LineBuilder header;
+    header.append("--- flight recorder dump");
+    if (reason != nullptr) {
+        header.append(": ");
+        header.append(reason);
+    }
+    header.append(" ---\n");
+    bool ok = header.write_to(fd);
+
+    Ring* const first = rings_.load(std::memory_order_acquire);
+    for (Ring* ring = first; ring != nullptr; ring = ring->next) {
+        ring->end = ring->head.load(std::memory_order_acquire);
+        const uint64_t oldest = ring->end > ring->capacity ? ring->end - ring->capacity : 0;
+        ring->cursor = std::max(oldest, ring->floor.load(std::memory_order_relaxed));
+        ring->advance();
+    }
+
+    // Merges the rings by time, each is in order already.
+    while (true) {
+        Ring* next = nullptr;
+        for (Ring* ring = first; ring != nullptr; ring = ring->next) {
+            if (ring->has_pending && (next == nullptr || ring->pending.time_ns < next->pending.time_ns)) {
+                next = ring;
+            }
+        }
+        if (next == nullptr) {
+            break;
+        }
+
+        const Record& record = next->pending;
+        LineBuilder line;
+        line.append_time(record.time_ns);
+        line.append(" [");
+        line.append(level_name(record.level));
+        line.append("] [tid ");
+        line.append_number(record.thread);
+        line.append("] ");
+        line.append(record.message, record.message_size);
+        if (record.file_size > 0) {
+            line.append(" (");
+            line.append(record.file, record.file_size);
+            if (record.line > 0) {
+                line.append(":");
+                line.append_number(static_cast<uint64_t>(record.line));
+            }
+            line.append(")");
+        }
+        line.append("\n");
+        ok = line.write_to(fd) && ok;
+
+        next->advance();
+    }
+
+    dumping_.clear(std::memory_order_release);
+    return ok;
+}
+
+void FlightRecorder::install_handlers() {
+    if (handlers_installed_) {
+        return;
+    }
+    handlers_installed_ = true;
+
+#ifdef _WIN32
+    for (size_t i = 0; i < kCrashSignalCount; ++i) {
+        g_previous[i] = std::signal(kCrashSignals[i], &FlightRecorder::on_crash);
+    }
+#else
+    // A stack overflow leaves no stack to run the handler on. The alternate
+    // stack is per thread, this covers the thread enabling the recorder
+    // unless it has one already.
+    stack_t current {};
+    if (::sigaltstack(nullptr, &current) == 0 && (current.ss_flags & SS_DISABLE) != 0) {
+        stack_t stack {};
+        stack.ss_sp = g_signal_stack;
+        stack.ss_size = sizeof(g_signal_stack);
+        ::sigaltstack(&stack, nullptr);
+    }
+
+    struct sigaction action {};
+    action.sa_handler = &FlightRecorder::on_crash;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_ONSTACK;
+    for (size_t i = 0; i < kCrashSignalCount; ++i) {
+        ::sigaction(kCrashSignals[i], &action, &g_previous[i]);
+    }
+#endif
+}
+
+void FlightRecorder::restore_handlers() {
+    if (!handlers_installed_) {
+        return;
+    }
+    handlers_installed_ = false;
+
+    for (size_t i = 0; i < kCrashSignalCount; ++i) {
+#ifdef _WIN32
+        std::signal(kCrashSignals[i], g_previous[i]);
+#else
+        ::sigaction(kCrashSignals[i], &g_previous[i], nullptr);
+#endif
+    }
+}
+
+void FlightRecorder::on_crash(int signal) {
+    const int saved_errno = errno;
+    if (g_recorder != nullptr && g_recorder->enabled()) {
+        g_recorder->dump_file(g_recorder->dump_path_, signal_name(signal));
+    }
+
+    // Hand the signal on: the previous handler, or the default action which
+    // terminates the process and writes a core dump.
+    for (size_t i = 0; i < kCrashSignalCount; ++i) {
+        if (kCrashSignals[i] == signal) {
+#ifdef _WIN32
+            std::signal(signal, g_previous[i] != nullptr ? g_previous[i] : SIG_DFL);
+#else
+            ::sigaction(signal, &g_previous[i], nullptr);
+#endif
+        }
+    }
+    errno = saved_errno;
+    std::raise(signal);
+}
+
+} // namespace logging
+} // namespace utoolkit
@@ -1,100 +1,595 @@
 #include <utoolkit/logging/logger.h>
+#include <utoolkit/logging/log_kv.h>
+#include <utoolkit/logging/mpsc_ring_buffer.h>
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
 #include <iostream>
-#include <iomanip>
-#include <ctime>
-#include <sstream>
+#include <thread>
 
 namespace utoolkit {
 namespace logging {
 
+namespace {
+
+// A queued message. Slots are reused, the strings keep their capacity.
+struct LogRecord {
+    LogLevel level;
+    std::chrono::system_clock::time_point time;
+    // Names of categories live as long as the process.
+    std::string_view category;
+    std::string message;
+    std::string fields;
+    LineFormat line_format;
+    std::string file;
+    int line;
+
+    // Set for messages formatted by the writer from |args|, see
+    // Logger::log_deferred(). |message| is unused then.
+    Logger::DeferredFormatter formatter;
+    std::string_view format;
+    unsigned char args[Logger::kMaxDeferredArgBytes];
+};
+
+// Lines are gathered up to this size before they are handed to the sinks.
+constexpr size_t kBatchBytes = 64 * 1024;
+
+} // namespace
+
+struct Logger::AsyncState {
+    explicit AsyncState(const AsyncOptions& options)
+        : ring(options.queue_size), policy(options.overflow_policy) {}
+
+    MpscRingBuffer<LogRecord> ring;
+    const OverflowPolicy policy;
+
+    std::thread writer;
+
+    // Guards the writer's sleep and the flush waits.
+    std::mutex mutex;
+    std::condition_variable wake_cv;
+    std::condition_variable written_cv;
+    // Set under |mutex|; read without it by blocked producers.
+    std::atomic<bool> stop {false};
+    bool finished = false;
+
+    // Threads between taking this state from Logger::async_ and finishing
+    // their push. disable_async() waits for them before stopping the writer,
+    // so nothing is pushed after the writer has left.
+    std::atomic<uint32_t> producers {0};
+
+    // Set while the writer sleeps, so that producers only notify when needed.
+    std::atomic<bool> sleeping {false};
+
+    // Messages popped and written so far, guarded by |mutex|.
+    uint64_t written = 0;
+
+    std::atomic<uint64_t> dropped {0};
+
+    // Pairs with the fence in run_writer(): either the writer sees the new
+    // message or this sees it sleeping.
+    void wake() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            wake_cv.notify_one();
+        }
+    }
+
+    // The current state registered as a producer for one message, or none
+    // if logging is synchronous.
+    class Producer {
+    public:
+        explicit Producer(const std::atomic<AsyncState*>& async) : state_(async.load(std::memory_order_seq_cst)) {
+            if (state_ == nullptr) {
+                return;
+            }
+            // Pairs with disable_async(): either it sees this producer or
+            // this sees the state taken away.
+            state_->producers.fetch_add(1, std::memory_order_seq_cst);
+            if (async.load(std::memory_order_seq_cst) != state_) {
+                state_->producers.fetch_sub(1, std::memory_order_release);
+                state_ = nullptr;
+            }
+        }
+
+        ~Producer() {
+            if (state_ != nullptr) {
+                state_->producers.fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        Producer(const Producer&) = delete;
+        Producer& operator=(const Producer&) = delete;
+
+        AsyncState* state() const { return state_; }
+
+    private:
+        AsyncState* state_;
+    };
+};
+
 Logger& Logger::instance() {
     static Logger instance;
     return instance;
 }
 
-Logger::Logger() : current_level_(LogLevel::INFO), console_output_enabled_(true) {
+Logger::Logger()
+    : current_level_(LogLevel::INFO),
+      capture_level_(LogLevel::INFO),
+      recorder_(FlightRecorder::instance()),
+      console_sink_(std::make_shared<ConsoleSink>()),
+      file_sink_(std::make_shared<RotatingFileSink>()) {
+    sinks_ = std::make_shared<const SinkList>(SinkList{console_sink_});
 }
 
 Logger::~Logger() {
-    if (log_file_.is_open()) {
-        log_file_.close();
-    }
+    // Static destruction at exit: write out whatever is still queued.
+    disable_async();
+    flush_sinks();
 }
 
 void Logger::set_log_level(LogLevel level) {
-    current_level_ = level;
+    current_level_.store(level, std::memory_order_relaxed);
+    update_levels();
 }
 
-void Logger::set_log_file(const std::string& filename) {
+void Logger::enable_flight_recorder(const FlightRecorderOptions& options) {
+    recorder_.enable(options);
+    update_levels();
+}
+
+void Logger::disable_flight_recorder() {
+    recorder_.disable();
+    update_levels();
+}
+
+bool Logger::dump_flight_recorder() {
+    return recorder_.dump();
+}
+
+void Logger::update_levels() {
     std::lock_guard<std::mutex> lock(mutex_);
-    
-    if (log_file_.is_open()) {
-        log_file_.close();
+    const LogLevel level = current_level_.load(std::memory_order_relaxed);
+    const auto capture_level = [this](LogLevel output_level) {
+        return recorder_.enabled() ? std::min(output_level, recorder_.level()) : output_level;
+    };
+    capture_level_.store(capture_level(level), std::memory_order_relaxed);
+
+    for (const auto& entry : categories_) {
+        LogCategory& category = *entry.second;
+        const LogLevel category_level = category.own_level_.load(std::memory_order_relaxed)
+                                            ? category.own_level_value_ : level;
+        category.level_.store(category_level, std::memory_order_relaxed);
+        category.capture_level_.store(capture_level(category_level), std::memory_order_relaxed);
     }
-    
-    log_file_.open(filename, std::ios::app);
-    if (!log_file_.is_open()) {
+}
+
+LogCategory* Logger::category(std::string_view name) {
+    LogCategory* result = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = categories_.find(name);
+        if (it != categories_.end()) {
+            return it->second.get();
+        }
+        it = categories_.emplace(std::string(name), std::unique_ptr<LogCategory>(new LogCategory(std::string(name))))
+                 .first;
+        result = it->second.get();
+    }
+    update_levels();
+    return result;
+}
+
+void Logger::set_category_level(std::string_view name, LogLevel level) {
+    LogCategory* target = category(name);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        target->own_level_value_ = level;
+        target->own_level_.store(true, std::memory_order_relaxed);
+    }
+    update_levels();
+}
+
+void Logger::reset_category_level(std::string_view name) {
+    LogCategory* target = category(name);
+    target->own_level_.store(false, std::memory_order_relaxed);
+    update_levels();
+}
+
+void Logger::add_sink(std::shared_ptr<Sink> sink) {
+    update_sinks([&sink](SinkList& list) {
+        if (std::find(list.begin(), list.end(), sink) == list.end()) {
+            list.push_back(std::move(sink));
+        }
+    });
+}
+
+void Logger::remove_sink(const std::shared_ptr<Sink>& sink) {
+    update_sinks([&sink](SinkList& list) {
+        list.erase(std::remove(list.begin(), list.end(), sink), list.end());
+    });
+}
+
+void Logger::clear_sinks() {
+    update_sinks([](SinkList& list) { list.clear(); });
+}
+
+void Logger::set_log_file(const std::string& filename) {
+    if (!file_sink_->open(filename)) {
         std::cerr << "Failed to open log file: " << filename << std::endl;
+        return;
     }
+    add_sink(file_sink_);
+}
+
+void Logger::set_rotation(const RotationOptions& options) {
+    file_sink_->set_rotation(options);
 }
 
 void Logger::enable_console_output(bool enable) {
-    console_output_enabled_ = enable;
+    if (enable) {
+        add_sink(console_sink_);
+    } else {
+        remove_sink(console_sink_);
+    }
+}
+
+std::shared_ptr<const Logger::SinkList> Logger::sinks() const {
+    return std::atomic_load(&sinks_);
+}
+
+template <typename Change>
+void Logger::update_sinks(Change&& change) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto list = std::make_shared<SinkList>(*sinks());
+    change(*list);
+    std::atomic_store(&sinks_, std::shared_ptr<const SinkList>(std::move(list)));
+}
+
+void Logger::flush_sinks() {
+    for (const auto& sink : *sinks()) {
+        sink->flush();
+    }
+}
+
+void Logger::set_line_format(LineFormat format) {
+    line_format_.store(format, std::memory_order_relaxed);
+}
+
+void Logger::set_time_zone(TimestampFormatter::Zone zone) {
+    timestamp_.set_zone(zone);
+}
+
+void Logger::set_timestamp_precision(TimestampFormatter::Precision precision) {
+    timestamp_.set_precision(precision);
 }
 
-void Logger::log(LogLevel level, const std::string& message, 
-                 const std::string& file, int line) {
-    if (level < current_level_) {
+void Logger::log(LogLevel level, std::string_view message,
+                 std::string_view file, int line) {
+    log_fields(level, message, {}, line_format(), file, line);
+}
+
+void Logger::log(const LogCategory& category, LogLevel level, std::string_view message,
+                 std::string_view file, int line) {
+    if (!category.should_capture(level)) {
         return;
     }
-    
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    std::string log_entry = get_current_time() + " [" + level_to_string(level) + "] " + message;
-    
-    if (!file.empty()) {
-        log_entry += " (" + file;
-        if (line > 0) {
-            log_entry += ":" + std::to_string(line);
+    capture(level, message, {}, file, line);
+    if (category.should_log(level)) {
+        dispatch(level, category.name(), message, {}, line_format(), file, line);
+    }
+}
+
+void Logger::log_fields(LogLevel level, std::string_view message, std::string_view fields, LineFormat format,
+                        std::string_view file, int line) {
+    if (!should_capture(level)) {
+        return;
+    }
+    capture(level, message, fields, file, line);
+    if (should_log(level)) {
+        dispatch(level, {}, message, fields, format, file, line);
+    }
+}
+
+void Logger::capture(LogLevel level, std::string_view message, std::string_view fields,
+                     std::string_view file, int line) {
+    recorder_.record(level, message, fields, file, line);
+    if (level == LogLevel::FATAL && recorder_.enabled()) {
+        recorder_.dump();
+    }
+}
+
+void Logger::dispatch(LogLevel level, std::string_view category, std::string_view message, std::string_view fields,
+                      LineFormat format, std::string_view file, int line) {
+    const AsyncState::Producer producer(async_);
+    if (AsyncState* state = producer.state()) {
+        auto fill = [&](LogRecord& record) {
+            record.category = category;
+            record.message.assign(message.data(), message.size());
+            record.fields.assign(fields.data(), fields.size());
+            record.line_format = format;
+            record.formatter = nullptr;
+        };
+        if (enqueue(state, level, file, line, fill) && level == LogLevel::FATAL) {
+            flush();
         }
-        log_entry += ")";
+        return;
     }
     
-    if (console_output_enabled_) {
-        std::cout << log_entry << std::endl;
+    const auto sinks = this->sinks();
+    const auto takes = [level](const std::shared_ptr<Sink>& sink) { return sink->should_log(level); };
+    if (std::none_of(sinks->begin(), sinks->end(), takes)) {
+        return;
     }
-    
-    if (log_file_.is_open()) {
-        log_file_ << log_entry << std::endl;
-        log_file_.flush();
+
+    const auto now = std::chrono::system_clock::now();
+    std::string log_entry;
+    // Room for the timestamp, level and punctuation too, so that it is
+    // allocated once.
+    log_entry.reserve(category.size() + message.size() + fields.size() + file.size() + 96);
+    format_entry(log_entry, now, level, category, message, fields, format, file, line);
+    log_entry += '\n';
+
+    // Each sink locks itself, so sinks do not wait for each other.
+    for (const auto& sink : *sinks) {
+        if (sink->should_log(level)) {
+            sink->write(level, log_entry, now);
+        }
+    }
+}
+
+void Logger::enable_async(const AsyncOptions& options) {
+    if (async_.load(std::memory_order_acquire) != nullptr) {
+        disable_async();
+    }
+
+    async_states_.push_back(std::make_unique<AsyncState>(options));
+    AsyncState* state = async_states_.back().get();
+    state->writer = std::thread([this, state]() { run_writer(state); });
+    async_.store(state, std::memory_order_release);
+}
+
+void Logger::disable_async() {
+    AsyncState* state = async_.exchange(nullptr, std::memory_order_seq_cst);
+    if (state == nullptr) {
+        return;
+    }
+
+    // Producers that took the state before it was swapped out push while the
+    // writer still runs; under BLOCK it keeps draining for them.
+    while (state->producers.load(std::memory_order_seq_cst) != 0) {
+        std::this_thread::yield();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->stop.store(true, std::memory_order_relaxed);
+    }
+    state->wake_cv.notify_one();
+    if (state->writer.joinable()) {
+        state->writer.join();
+    }
+}
+
+bool Logger::is_async() const {
+    return async_.load(std::memory_order_acquire) != nullptr;
+}
+
+void Logger::flush() {
+    AsyncState* state = async_.load(std::memory_order_acquire);
+    if (state != nullptr) {
+        const uint64_t target = state->ring.push_count();
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->wake_cv.notify_one();
+        state->written_cv.wait(lock, [state, target]() {
+            return state->written >= target || state->finished;
+        });
+    }
+
+    // Sinks may still buffer what the writer handed them.
+    flush_sinks();
+}
+
+uint64_t Logger::dropped_messages() const {
+    uint64_t total = 0;
+    for (const auto& state : async_states_) {
+        total += state->dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+bool Logger::log_deferred(LogLevel level, DeferredFormatter formatter, std::string_view format,
+                          const unsigned char* args, size_t size, std::string_view file, int line) {
+    const AsyncState::Producer producer(async_);
+    AsyncState* state = producer.state();
+    // The recorder needs the formatted message.
+    if (state == nullptr || size > kMaxDeferredArgBytes || recorder_.captures(level)) {
+        return false;
     }
+
+    auto fill = [&](LogRecord& record) {
+        record.formatter = formatter;
+        record.format = format;
+        record.category = {};
+        record.fields.clear();
+        record.line_format = line_format();
+        std::memcpy(record.args, args, size);
+    };
+    if (enqueue(state, level, file, line, fill) && level == LogLevel::FATAL) {
+        flush();
+    }
+    return true;
+}
+
+template <typename Fill>
+bool Logger::enqueue(AsyncState* state, LogLevel level, std::string_view file, int line, Fill&& fill) {
+    auto fill_record = [&](LogRecord& record) {
+        record.level = level;
+        record.time = std::chrono::system_clock::now();
+        record.file.assign(file.data(), file.size());
+        record.line = line;
+        fill(record);
+    };
+
+    while (!state->ring.try_push(fill_record)) {
+        switch (state->policy) {
+            case OverflowPolicy::DROP:
+                return false;
+            case OverflowPolicy::DROP_AND_COUNT:
+                state->dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            case OverflowPolicy::BLOCK:
+            default:
+                // Registered producers hold off the stop, but never spin
+                // with no writer left to drain the queue.
+                if (state->stop.load(std::memory_order_relaxed)) {
+                    state->dropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                state->wake();
+                std::this_thread::yield();
+                break;
+        }
+    }
+
+    state->wake();
+    return true;
+}
+
+void Logger::run_writer(AsyncState* state) {
+    // The lines of the current batch for each sink, and their highest level.
+    std::shared_ptr<const SinkList> sinks;
+    std::vector<std::string> batches;
+    std::vector<LogLevel> batch_levels;
+    size_t batch_bytes = 0;
+    uint64_t reported_drops = 0;
+
+    std::string message;
+    std::string entry;
+
+    auto add_entry = [&](LogLevel level) {
+        entry += '\n';
+        for (size_t i = 0; i < sinks->size(); ++i) {
+            if ((*sinks)[i]->should_log(level)) {
+                batches[i] += entry;
+                batch_levels[i] = std::max(batch_levels[i], level);
+            }
+        }
+        batch_bytes += entry.size();
+    };
+
+    auto append = [&](LogRecord& record) {
+        const auto takes = [&record](const std::shared_ptr<Sink>& sink) { return sink->should_log(record.level); };
+        if (std::none_of(sinks->begin(), sinks->end(), takes)) {
+            return;
+        }
+        entry.clear();
+        if (record.formatter != nullptr) {
+            message.clear();
+            record.formatter(record.args, record.format, message);
+            format_entry(entry, record.time, record.level, record.category, message, record.fields,
+                         record.line_format, record.file, record.line);
+        } else {
+            format_entry(entry, record.time, record.level, record.category, record.message, record.fields,
+                         record.line_format, record.file, record.line);
+        }
+        add_entry(record.level);
+    };
+
+    while (true) {
+        sinks = this->sinks();
+        batches.resize(sinks->size());
+        batch_levels.assign(sinks->size(), LogLevel::TRACE);
+        batch_bytes = 0;
+
+        uint64_t count = 0;
+        while (batch_bytes < kBatchBytes && state->ring.try_pop(append)) {
+            ++count;
+        }
+
+        const uint64_t drops = state->dropped.load(std::memory_order_relaxed);
+        if (drops != reported_drops) {
+            entry.clear();
+            format_entry(entry, std::chrono::system_clock::now(), LogLevel::WARN, {},
+                         std::to_string(drops - reported_drops) + " log messages dropped, queue full", {},
+                         line_format(), {}, 0);
+            add_entry(LogLevel::WARN);
+            reported_drops = drops;
+        }
+
+        const auto now = std::chrono::system_clock::now();
+        if (count > 0 || batch_bytes > 0) {
+            for (size_t i = 0; i < sinks->size(); ++i) {
+                if (!batches[i].empty()) {
+                    (*sinks)[i]->write(batch_levels[i], batches[i], now);
+                    batches[i].clear();
+                }
+            }
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->written += count;
+            state->written_cv.notify_all();
+            continue;
+        }
+
+        for (const auto& sink : *sinks) {
+            sink->flush_if_due(now);
+        }
+
+        // Nothing queued. Announce the sleep before checking again, so that a
+        // producer either sees |sleeping| or its message is seen here.
+        std::unique_lock<std::mutex> lock(state->mutex);
+        if (state->stop.load(std::memory_order_relaxed)) {
+            if (state->ring.push_count() == state->written) {
+                break;
+            }
+            // A producer is still filling its slot.
+            lock.unlock();
+            std::this_thread::yield();
+            continue;
+        }
+        state->sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (state->ring.push_count() == state->written) {
+            // The timeout covers a producer that claimed a slot but has not
+            // filled it yet when it checked |sleeping|, and lets sinks flush
+            // on their max_delay.
+            state->wake_cv.wait_for(lock, std::chrono::milliseconds(10));
+        }
+        state->sleeping.store(false, std::memory_order_relaxed);
+    }
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->finished = true;
+    state->written_cv.notify_all();
 }
 
-void Logger::trace(const std::string& message, const std::string& file, int line) {
+void Logger::trace(std::string_view message, std::string_view file, int line) {
     log(LogLevel::TRACE, message, file, line);
 }
 
-void Logger::debug(const std::string& message, const std::string& file, int line) {
+void Logger::debug(std::string_view message, std::string_view file, int line) {
     log(LogLevel::DEBUG, message, file, line);
 }
 
-void Logger::info(const std::string& message, const std::string& file, int line) {
+void Logger::info(std::string_view message, std::string_view file, int line) {
     log(LogLevel::INFO, message, file, line);
 }
 
-void Logger::warn(const std::string& message, const std::string& file, int line) {
+void Logger::warn(std::string_view message, std::string_view file, int line) {
     log(LogLevel::WARN, message, file, line);
 }
 
-void Logger::error(const std::string& message, const std::string& file, int line) {
+void Logger::error(std::string_view message, std::string_view file, int line) {
     log(LogLevel::ERROR, message, file, line);
 }
 
-void Logger::fatal(const std::string& message, const std::string& file, int line) {
+void Logger::fatal(std::string_view message, std::string_view file, int line) {
+    // In async mode log() also waits until the message has been written.
     log(LogLevel::FATAL, message, file, line);
 }
 
-std::string Logger::level_to_string(LogLevel level) {
+const char* Logger::level_to_string(LogLevel level) {
     switch (level) {
         case LogLevel::TRACE: return "TRACE";
         case LogLevel::DEBUG: return "DEBUG";
@@ -106,18 +601,83 @@ std::string Logger::level_to_string(LogLevel level) {
     }
 }
 
-std::string Logger::get_current_time() {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
-    
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-    ss << "." << std::setfill('0') << std::setw(3) << ms.count();
+void Logger::format_entry(std::string& out, std::chrono::system_clock::time_point time, LogLevel level,
+                          std::string_view category, std::string_view message, std::string_view fields,
+                          LineFormat format, std::string_view file, int line) {
+    switch (format) {
+        case LineFormat::JSON:
+            out += "{\"time\":\"";
+            timestamp_.append(out, time);
+            out += "\",\"level\":\"";
+            out += level_to_string(level);
+            out += '"';
+            if (!category.empty()) {
+                out += ",\"category\":";
+                detail::append_json_string(out, category);
+            }
+            out += ",\"msg\":";
+            detail::append_json_string(out, message);
+            out += fields;
+            if (!file.empty()) {
+                out += ",\"file\":";
+                detail::append_json_string(out, file);
+                if (line > 0) {
+                    out += ",\"line\":";
+                    detail::append_number(out, line);
+                }
+            }
+            out += '}';
+            return;
+
+        case LineFormat::LOGFMT:
+            out += "time=\"";
+            timestamp_.append(out, time);
+            out += "\" level=";
+            out += level_to_string(level);
+            if (!category.empty()) {
+                out += " category=";
+                detail::append_logfmt_value(out, category);
+            }
+            out += " msg=";
+            detail::append_logfmt_value(out, message);
+            out += fields;
+            if (!file.empty()) {
+                out += " file=";
+                detail::append_logfmt_value(out, file);
+                if (line > 0) {
+                    out += " line=";
+                    detail::append_number(out, line);
+                }
+            }
+            return;
+
+        case LineFormat::TEXT:
+        default:
+            break;
+    }
+
+    timestamp_.append(out, time);
+    out += " [";
+    out += level_to_string(level);
+    out += "] ";
+    if (!category.empty()) {
+        out += '[';
+        out += category;
+        out += "] ";
+    }
+    out += message;
+    out += fields;
     
-    return ss.str();
+    if (!file.empty()) {
+        out += " (";
+        out += file;
+        if (line > 0) {
+            out += ":";
+            out += std::to_string(line);
+        }
+        out += ")";
+    }
 }
 
 } // namespace logging
-} // namespace utoolkit
\ No newline at end of file
+} // namespace utoolkit
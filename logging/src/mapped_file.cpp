@@ -0,0 +1,248 @@
+#include <utoolkit/logging/mapped_file.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace utoolkit {
+namespace logging {
+
+#ifndef _WIN32
+
+namespace {
+
+constexpr size_t kTrimBlockBytes = 64 * 1024;
+
+size_t page_size() {
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+size_t round_up_to_page(size_t bytes) {
+    const size_t page = page_size();
+    return std::max(page, (bytes + page - 1) / page * page);
+}
+
+// The length of |fd| without the NUL padding a crash may have left, looking
+// at most |limit| bytes back from the end.
+uint64_t written_length(int fd, uint64_t length, uint64_t limit) {
+    const uint64_t floor = length > limit ? length - limit : 0;
+    char block[kTrimBlockBytes];
+    while (length > floor) {
+        const size_t count = static_cast<size_t>(std::min<uint64_t>(kTrimBlockBytes, length - floor));
+        if (pread(fd, block, count, static_cast<off_t>(length - count)) != static_cast<ssize_t>(count)) {
+            break;
+        }
+        for (size_t i = count; i > 0; --i) {
+            if (block[i - 1] != '\0') {
+                return length - count + i;
+            }
+        }
+        length -= count;
+    }
+    return length;
+}
+
+// Makes sure [offset, offset + length) is backed by blocks of the file.
+bool preallocate(int fd, uint64_t offset, uint64_t length) {
+#ifdef __linux__
+    if (fallocate(fd, 0, static_cast<off_t>(offset), static_cast<off_t>(length)) == 0) {
+        return true;
+    }
+    if (errno != EOPNOTSUPP) {
+        return false;
+    }
+#endif
+    // No fallocate() on this file system, at least extend the file so that
+    // the mapping is backed; blocks are then allocated as pages are written.
+    struct stat st {};
+    if (fstat(fd, &st) != 0) {
+        return false;
+    }
+    return static_cast<uint64_t>(st.st_size) >= offset + length ||
+           ftruncate(fd, static_cast<off_t>(offset + length)) == 0;
+}
+
+} // namespace
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& filename, const MappedFileOptions& options) {
+    close();
+
+    options_ = options;
+    options_.extent_size = round_up_to_page(options_.extent_size);
+
+    fd_ = ::open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        return false;
+    }
+    filename_ = filename;
+
+    struct stat st {};
+    if (fstat(fd_, &st) != 0) {
+        close();
+        return false;
+    }
+    const auto length = static_cast<uint64_t>(st.st_size);
+    size_ = written_length(fd_, length, options_.extent_size);
+    written_back_ = size_;
+    if (size_ != length && ftruncate(fd_, static_cast<off_t>(size_)) != 0) {
+        close();
+        return false;
+    }
+    if (!map_extent()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (fd_ < 0) {
+        return;
+    }
+    unmap();
+    if (ftruncate(fd_, static_cast<off_t>(size_)) != 0) {
+        std::cerr << "Failed to truncate log file " << filename_ << ": " << std::strerror(errno) << std::endl;
+    }
+    ::close(fd_);
+    fd_ = -1;
+}
+
+bool MappedFile::write(std::string_view data) {
+    if (fd_ < 0) {
+        return false;
+    }
+
+    while (!data.empty()) {
+        const uint64_t map_end = map_offset_ + map_size_;
+        if (size_ == map_end) {
+            unmap();
+            if (!map_extent()) {
+                std::cerr << "Failed to extend log file " << filename_ << ": " << std::strerror(errno) << std::endl;
+                close();
+                return false;
+            }
+            continue;
+        }
+        const size_t count = static_cast<size_t>(std::min<uint64_t>(data.size(), map_end - size_));
+        std::memcpy(map_ + (size_ - map_offset_), data.data(), count);
+        size_ += count;
+        data.remove_prefix(count);
+    }
+
+    if (options_.writeback_bytes > 0 && size_ - written_back_ >= options_.writeback_bytes) {
+        start_writeback();
+    }
+    return true;
+}
+
+void MappedFile::sync() {
+    if (fd_ < 0) {
+        return;
+    }
+    if (map_ != nullptr) {
+        msync(map_, map_size_, MS_SYNC);
+    }
+    fdatasync(fd_);
+    written_back_ = size_;
+}
+
+bool MappedFile::is_supported() {
+    return true;
+}
+
+bool MappedFile::map_extent() {
+    map_offset_ = size_ / page_size() * page_size();
+    if (!preallocate(fd_, map_offset_, options_.extent_size)) {
+        return false;
+    }
+    void* map = mmap(nullptr, options_.extent_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_,
+                     static_cast<off_t>(map_offset_));
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    map_ = static_cast<char*>(map);
+    map_size_ = options_.extent_size;
+    madvise(map_, map_size_, MADV_SEQUENTIAL);
+    return true;
+}
+
+void MappedFile::unmap() {
+    if (map_ == nullptr) {
+        return;
+    }
+    if (options_.writeback_bytes > 0) {
+        start_writeback();
+    }
+    munmap(map_, map_size_);
+    map_ = nullptr;
+    map_size_ = 0;
+}
+
+void MappedFile::start_writeback() {
+    // Whole pages only, the last one is still being written.
+    const uint64_t end = size_ / page_size() * page_size();
+    const uint64_t begin = std::max(written_back_ / page_size() * page_size(), map_offset_);
+    if (end <= begin) {
+        return;
+    }
+#ifdef __linux__
+    // msync(MS_ASYNC) does nothing on Linux.
+    sync_file_range(fd_, static_cast<off_t>(begin), static_cast<off_t>(end - begin), SYNC_FILE_RANGE_WRITE);
+#else
+    msync(map_ + (begin - map_offset_), end - begin, MS_ASYNC);
+#endif
+    // Dirty pages stay in the page cache; this only keeps the mapping from
+    // adding the whole extent to the resident size of the process.
+    madvise(map_ + (begin - map_offset_), end - begin, MADV_DONTNEED);
+    written_back_ = end;
+}
+
+#else
+
+MappedFile::~MappedFile() = default;
+
+bool MappedFile::open(const std::string&, const MappedFileOptions&) {
+    std::cerr << "Memory mapped log files are not available on this platform" << std::endl;
+    return false;
+}
+
+void MappedFile::close() {
+}
+
+bool MappedFile::write(std::string_view) {
+    return false;
+}
+
+void MappedFile::sync() {
+}
+
+bool MappedFile::is_supported() {
+    return false;
+}
+
+bool MappedFile::map_extent() {
+    return false;
+}
+
+void MappedFile::unmap() {
+}
+
+void MappedFile::start_writeback() {
+}
+
+#endif
+
+} // namespace logging
+} // namespace utoolkit
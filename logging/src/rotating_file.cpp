@@ -0,0 +1,405 @@
+#include <utoolkit/logging/rotating_file.h>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#if defined(UT_LOG_HAVE_ZLIB) && UT_LOG_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#if defined(UT_LOG_HAVE_ZSTD) && UT_LOG_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace utoolkit {
+namespace logging {
+
+namespace {
+
+constexpr size_t kCompressChunkBytes = 256 * 1024;
+
+// "YYYYmmdd-HHMMSS"
+constexpr size_t kStampLength = 15;
+
+const char* compression_suffix(Compression compression) {
+    switch (compression) {
+        case Compression::GZIP: return ".gz";
+        case Compression::ZSTD: return ".zst";
+        case Compression::NONE:
+        default: return "";
+    }
+}
+
+std::string utc_stamp(std::chrono::system_clock::time_point time) {
+    const std::time_t seconds = std::chrono::system_clock::to_time_t(time);
+    std::tm tm {};
+#ifdef _WIN32
+    gmtime_s(&tm, &seconds);
+#else
+    gmtime_r(&seconds, &tm);
+#endif
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y%m%d-%H%M%S", &tm);
+    return buffer;
+}
+
+// A rotated file of the log, ordered by its name.
+struct Archive {
+    std::string stamp;
+    unsigned long sequence;
+    fs::path path;
+
+    bool operator<(const Archive& other) const {
+        return stamp != other.stamp ? stamp < other.stamp : sequence < other.sequence;
+    }
+};
+
+// Matches "<stem>.<stamp>[_<sequence>]<extension>[.gz|.zst]".
+bool parse_archive(const std::string& name, const std::string& stem, const std::string& extension,
+                   Archive& archive) {
+    size_t pos = stem.size() + 1;
+    if (name.size() < pos + kStampLength || name.compare(0, stem.size(), stem) != 0 || name[stem.size()] != '.') {
+        return false;
+    }
+    archive.stamp = name.substr(pos, kStampLength);
+    if (archive.stamp.find_first_not_of("0123456789-") != std::string::npos) {
+        return false;
+    }
+    pos += kStampLength;
+
+    archive.sequence = 0;
+    if (pos < name.size() && name[pos] == '_') {
+        const size_t end = std::min(name.find_first_not_of("0123456789", pos + 1), name.size());
+        if (end == pos + 1 || end - pos - 1 > 9) {
+            return false;
+        }
+        archive.sequence = std::stoul(name.substr(pos + 1, end - pos - 1));
+        pos = end;
+    }
+
+    if (name.compare(pos, extension.size(), extension) != 0) {
+        return false;
+    }
+    const std::string rest = name.substr(pos + extension.size());
+    return rest.empty() || rest == ".gz" || rest == ".zst";
+}
+
+// The rotated files of |filename|, in no particular order.
+std::vector<Archive> list_archives(const std::string& filename) {
+    const fs::path path(filename);
+    const fs::path directory = path.has_parent_path() ? path.parent_path() : fs::path(".");
+    const std::string stem = path.stem().string();
+    const std::string extension = path.extension().string();
+
+    std::vector<Archive> archives;
+    std::error_code ec;
+    for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        Archive archive;
+        if (parse_archive(it->path().filename().string(), stem, extension, archive)) {
+            archive.path = it->path();
+            archives.push_back(std::move(archive));
+        }
+    }
+    return archives;
+}
+
+void prune(const std::string& filename, size_t max_files) {
+    std::vector<Archive> archives = list_archives(filename);
+    if (archives.size() <= max_files) {
+        return;
+    }
+
+    std::sort(archives.begin(), archives.end());
+    std::error_code ec;
+    for (size_t i = 0; i + max_files < archives.size(); ++i) {
+        fs::remove(archives[i].path, ec);
+    }
+}
+
+bool compress_file(const std::string& source, const std::string& target, Compression compression) {
+    std::ifstream in(source, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+    std::vector<char> buffer(kCompressChunkBytes);
+
+    switch (compression) {
+#if defined(UT_LOG_HAVE_ZLIB) && UT_LOG_HAVE_ZLIB
+        case Compression::GZIP: {
+            gzFile out = gzopen(target.c_str(), "wb6");
+            if (out == nullptr) {
+                return false;
+            }
+            bool ok = true;
+            while (ok && in) {
+                in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                const auto size = static_cast<unsigned>(in.gcount());
+                ok = size == 0 || gzwrite(out, buffer.data(), size) == static_cast<int>(size);
+            }
+            return gzclose(out) == Z_OK && ok;
+        }
+#endif
+#if defined(UT_LOG_HAVE_ZSTD) && UT_LOG_HAVE_ZSTD
+        case Compression::ZSTD: {
+            std::ofstream out(target, std::ios::binary | std::ios::trunc);
+            ZSTD_CCtx* context = ZSTD_createCCtx();
+            if (!out.is_open() || context == nullptr) {
+                ZSTD_freeCCtx(context);
+                return false;
+            }
+            std::vector<char> output(ZSTD_CStreamOutSize());
+            bool ok = true;
+            bool last = false;
+            while (ok && !last) {
+                in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                ZSTD_inBuffer input = {buffer.data(), static_cast<size_t>(in.gcount()), 0};
+                last = !in;
+                const ZSTD_EndDirective mode = last ? ZSTD_e_end : ZSTD_e_continue;
+                bool finished = false;
+                while (ok && !finished) {
+                    ZSTD_outBuffer chunk = {output.data(), output.size(), 0};
+                    const size_t remaining = ZSTD_compressStream2(context, &chunk, &input, mode);
+                    ok = !ZSTD_isError(remaining) &&
+                         out.write(output.data(), static_cast<std::streamsize>(chunk.pos)).good();
+                    finished = last ? remaining == 0 : input.pos == input.size;
+                }
+            }
+            ZSTD_freeCCtx(context);
+            out.close();
+            return ok && !out.fail();
+        }
+#endif
+        default:
+            return false;
+    }
+}
+
+// Replaces |archive| by its compressed version. The output gets its final
+// name only when complete, so an interrupted run leaves the original.
+void compress_archive(const std::string& archive, Compression compression) {
+    const std::string target = archive + compression_suffix(compression);
+    const std::string partial = target + ".tmp";
+    std::error_code ec;
+    if (!compress_file(archive, partial, compression)) {
+        std::cerr << "Failed to compress rotated log file: " << archive << std::endl;
+        fs::remove(partial, ec);
+        return;
+    }
+    fs::rename(partial, target, ec);
+    if (ec) {
+        std::cerr << "Failed to rename compressed log file: " << partial << std::endl;
+        fs::remove(partial, ec);
+        return;
+    }
+    fs::remove(archive, ec);
+}
+
+} // namespace
+
+RotatingFile::~RotatingFile() {
+    close();
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex_);
+        stop_ = true;
+    }
+    jobs_cv_.notify_one();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+bool RotatingFile::open(const std::string& filename) {
+    close();
+
+    file_.open(filename, std::ios::app);
+    if (!file_.is_open()) {
+        return false;
+    }
+    filename_ = filename;
+    last_stamp_.clear();
+
+    std::error_code ec;
+    const auto size = fs::file_size(filename, ec);
+    size_ = ec ? 0 : size;
+    schedule_next_rotation(std::chrono::system_clock::now());
+    return true;
+}
+
+void RotatingFile::close() {
+    if (file_.is_open()) {
+        file_.close();
+    }
+}
+
+void RotatingFile::set_options(const RotationOptions& options) {
+    options_ = options;
+    if (!is_supported(options_.compression)) {
+        std::cerr << "Log compression is not available in this build, rotated files stay uncompressed" << std::endl;
+        options_.compression = Compression::NONE;
+    }
+    schedule_next_rotation(std::chrono::system_clock::now());
+
+    if (options_.max_files > 0 && !filename_.empty()) {
+        post(Job{filename_, std::string(), Compression::NONE, options_.max_files});
+    }
+}
+
+bool RotatingFile::is_supported(Compression compression) {
+    switch (compression) {
+        case Compression::NONE:
+            return true;
+        case Compression::GZIP:
+#if defined(UT_LOG_HAVE_ZLIB) && UT_LOG_HAVE_ZLIB
+            return true;
+#else
+            return false;
+#endif
+        case Compression::ZSTD:
+#if defined(UT_LOG_HAVE_ZSTD) && UT_LOG_HAVE_ZSTD
+            return true;
+#else
+            return false;
+#endif
+        default:
+            return false;
+    }
+}
+
+void RotatingFile::write(std::string_view data, std::chrono::system_clock::time_point now) {
+    if (!file_.is_open()) {
+        return;
+    }
+
+    const bool too_large = options_.max_file_size > 0 && size_ > 0 &&
+                           size_ + data.size() > options_.max_file_size;
+    if (too_large || now >= next_rotation_) {
+        rotate(now);
+        if (!file_.is_open()) {
+            return;
+        }
+    }
+
+    file_.write(data.data(), static_cast<std::streamsize>(data.size()));
+    size_ += data.size();
+}
+
+void RotatingFile::flush() {
+    if (file_.is_open()) {
+        file_.flush();
+    }
+}
+
+void RotatingFile::wait_idle() {
+    std::unique_lock<std::mutex> lock(jobs_mutex_);
+    idle_cv_.wait(lock, [this]() { return jobs_.empty() && !working_; });
+}
+
+void RotatingFile::rotate(std::chrono::system_clock::time_point now) {
+    // Closed before the rename, which Windows does not allow on open files.
+    file_.close();
+
+    const std::string archive = archive_name(now);
+    std::error_code ec;
+    fs::rename(filename_, archive, ec);
+    if (ec) {
+        std::cerr << "Failed to rotate log file " << filename_ << ": " << ec.message() << std::endl;
+    }
+
+    file_.open(filename_, std::ios::app);
+    if (!file_.is_open()) {
+        std::cerr << "Failed to open log file: " << filename_ << std::endl;
+    }
+    // Also after a failed rename, so that it is retried one file size later
+    // rather than on every write.
+    size_ = 0;
+    schedule_next_rotation(now);
+
+    if (!ec && (options_.compression != Compression::NONE || options_.max_files > 0)) {
+        post(Job{filename_, options_.compression != Compression::NONE ? archive : std::string(),
+                 options_.compression, options_.max_files});
+    }
+}
+
+void RotatingFile::schedule_next_rotation(std::chrono::system_clock::time_point now) {
+    const int64_t interval = options_.interval.count();
+    if (interval <= 0) {
+        next_rotation_ = std::chrono::system_clock::time_point::max();
+        return;
+    }
+    const int64_t seconds = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+    next_rotation_ = std::chrono::system_clock::time_point(std::chrono::seconds((seconds / interval + 1) * interval));
+}
+
+std::string RotatingFile::archive_name(std::chrono::system_clock::time_point now) {
+    const fs::path path(filename_);
+    const std::string stamp = utc_stamp(now);
+
+    // Several rotations within one second get increasing sequence numbers.
+    // A number is never taken again, also once the pruner has deleted its
+    // file, or the new file would sort as older than those before it. A
+    // stamp seen for the first time continues after the files an earlier
+    // process left with it.
+    if (stamp != last_stamp_) {
+        last_stamp_ = stamp;
+        next_sequence_ = 0;
+        for (const Archive& archive : list_archives(filename_)) {
+            if (archive.stamp == stamp) {
+                next_sequence_ = std::max(next_sequence_, archive.sequence + 1);
+            }
+        }
+    }
+    const unsigned long sequence = next_sequence_++;
+
+    std::string name = (path.parent_path() / path.stem()).string() + "." + stamp;
+    if (sequence > 0) {
+        name += "_" + std::to_string(sequence);
+    }
+    return name + path.extension().string();
+}
+
+void RotatingFile::post(Job job) {
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex_);
+        jobs_.push_back(std::move(job));
+        if (!worker_.joinable()) {
+            worker_ = std::thread([this]() { run_worker(); });
+        }
+    }
+    jobs_cv_.notify_one();
+}
+
+void RotatingFile::run_worker() {
+    std::unique_lock<std::mutex> lock(jobs_mutex_);
+    while (true) {
+        jobs_cv_.wait(lock, [this]() { return stop_ || !jobs_.empty(); });
+        if (jobs_.empty()) {
+            // Stopping, and everything posted has been done.
+            break;
+        }
+
+        Job job = std::move(jobs_.front());
+        jobs_.pop_front();
+        working_ = true;
+        lock.unlock();
+
+        if (!job.archive.empty()) {
+            compress_archive(job.archive, job.compression);
+        }
+        if (job.max_files > 0) {
+            prune(job.filename, job.max_files);
+        }
+
+        lock.lock();
+        working_ = false;
+        idle_cv_.notify_all();
+    }
+}
+
+} // namespace logging
+} // namespace utoolkit
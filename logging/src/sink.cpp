@@ -0,0 +1,223 @@
+#include <utoolkit/logging/sink.h>
+
+namespace utoolkit {
+namespace logging {
+
+void Sink::set_level(LogLevel level) {
+    level_.store(level, std::memory_order_relaxed);
+}
+
+LogLevel Sink::level() const {
+    return level_.load(std::memory_order_relaxed);
+}
+
+bool Sink::should_log(LogLevel level) const {
+    return level >= level_.load(std::memory_order_relaxed);
+}
+
+void Sink::set_flush_policy(const FlushPolicy& policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    policy_ = policy;
+    if (!policy_.buffered()) {
+        flush_locked(std::chrono::system_clock::now());
+    }
+}
+
+FlushPolicy Sink::flush_policy() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return policy_;
+}
+
+void Sink::write(LogLevel level, std::string_view data, std::chrono::system_clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!policy_.buffered()) {
+        write_output(data, now);
+        flush_output();
+        return;
+    }
+
+    if (buffer_.empty()) {
+        oldest_ = now;
+    }
+    buffer_.append(data.data(), data.size());
+
+    if ((policy_.buffer_size > 0 && buffer_.size() >= policy_.buffer_size) ||
+        (policy_.max_delay.count() > 0 && now - oldest_ >= policy_.max_delay) ||
+        level >= policy_.flush_level) {
+        flush_locked(now);
+    }
+}
+
+void Sink::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_locked(std::chrono::system_clock::now());
+}
+
+void Sink::flush_if_due(std::chrono::system_clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!buffer_.empty() && policy_.max_delay.count() > 0 && now - oldest_ >= policy_.max_delay) {
+        flush_locked(now);
+    }
+}
+
+void Sink::flush_locked(std::chrono::system_clock::time_point now) {
+    if (!buffer_.empty()) {
+        write_output(buffer_, now);
+        buffer_.clear();
+    }
+    flush_output();
+}
+
+ConsoleSink::ConsoleSink(std::ostream& stream) : stream_(stream) {
+}
+
+ConsoleSink::~ConsoleSink() {
+    flush();
+}
+
+void ConsoleSink::write_output(std::string_view data, std::chrono::system_clock::time_point) {
+    stream_.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+void ConsoleSink::flush_output() {
+    stream_.flush();
+}
+
+FileSink::FileSink(const std::string& filename) {
+    open(filename);
+}
+
+FileSink::~FileSink() {
+    flush();
+}
+
+bool FileSink::open(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_locked(std::chrono::system_clock::now());
+    if (file_.is_open()) {
+        file_.close();
+    }
+    file_.open(filename, std::ios::app);
+    return file_.is_open();
+}
+
+bool FileSink::is_open() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return file_.is_open();
+}
+
+void FileSink::write_output(std::string_view data, std::chrono::system_clock::time_point) {
+    if (file_.is_open()) {
+        file_.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+}
+
+void FileSink::flush_output() {
+    if (file_.is_open()) {
+        file_.flush();
+    }
+}
+
+RotatingFileSink::RotatingFileSink(const std::string& filename, const RotationOptions& options) {
+    file_.set_options(options);
+    open(filename);
+}
+
+RotatingFileSink::~RotatingFileSink() {
+    flush();
+}
+
+bool RotatingFileSink::open(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_locked(std::chrono::system_clock::now());
+    return file_.open(filename);
+}
+
+bool RotatingFileSink::is_open() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return file_.is_open();
+}
+
+void RotatingFileSink::set_rotation(const RotationOptions& options) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    file_.set_options(options);
+}
+
+void RotatingFileSink::wait_idle() {
+    file_.wait_idle();
+}
+
+void RotatingFileSink::write_output(std::string_view data, std::chrono::system_clock::time_point now) {
+    file_.write(data, now);
+}
+
+void RotatingFileSink::flush_output() {
+    file_.flush();
+}
+
+MappedFileSink::MappedFileSink(const std::string& filename, const MappedFileOptions& options) {
+    open(filename, options);
+}
+
+MappedFileSink::~MappedFileSink() {
+    flush();
+}
+
+bool MappedFileSink::open(const std::string& filename, const MappedFileOptions& options) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_locked(std::chrono::system_clock::now());
+    return file_.open(filename, options);
+}
+
+void MappedFileSink::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_locked(std::chrono::system_clock::now());
+    file_.close();
+}
+
+bool MappedFileSink::is_open() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return file_.is_open();
+}
+
+void MappedFileSink::sync() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_locked(std::chrono::system_clock::now());
+    file_.sync();
+}
+
+void MappedFileSink::write_output(std::string_view data, std::chrono::system_clock::time_point) {
+    file_.write(data);
+}
+
+RingSink::RingSink(size_t capacity) : capacity_(capacity) {
+}
+
+std::vector<std::string> RingSink::lines() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::vector<std::string>(lines_.begin(), lines_.end());
+}
+
+void RingSink::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lines_.clear();
+}
+
+void RingSink::write_output(std::string_view data, std::chrono::system_clock::time_point) {
+    while (!data.empty()) {
+        const size_t end = data.find('\n');
+        lines_.emplace_back(data.substr(0, end));
+        if (lines_.size() > capacity_) {
+            lines_.pop_front();
+        }
+        data.remove_prefix(end == std::string_view::npos ? data.size() : end + 1);
+    }
+}
+
+void NullSink::write_output(std::string_view data, std::chrono::system_clock::time_point) {
+    bytes_.fetch_add(data.size(), std::memory_order_relaxed);
+}
+
+} // namespace logging
+} // namespace utoolkit
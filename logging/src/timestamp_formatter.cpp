@@ -0,0 +1,133 @@
+#include <utoolkit/logging/timestamp_formatter.h>
+#include <cstring>
+#include <ctime>
+#include <limits>
+
+namespace utoolkit {
+namespace logging {
+
+namespace {
+
+void write_digits(char* out, uint32_t value, int width) {
+    for (int i = width - 1; i >= 0; --i) {
+        out[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+}
+
+} // namespace
+
+TimestampFormatter::TimestampFormatter(Zone zone, Precision precision)
+    : zone_(static_cast<int>(zone)),
+      precision_(static_cast<int>(precision)),
+      cached_second_(std::numeric_limits<int64_t>::min()) {
+}
+
+void TimestampFormatter::set_zone(Zone zone) {
+    zone_.store(static_cast<int>(zone), std::memory_order_relaxed);
+}
+
+void TimestampFormatter::set_precision(Precision precision) {
+    precision_.store(static_cast<int>(precision), std::memory_order_relaxed);
+}
+
+TimestampFormatter::Zone TimestampFormatter::zone() const {
+    return static_cast<Zone>(zone_.load(std::memory_order_relaxed));
+}
+
+TimestampFormatter::Precision TimestampFormatter::precision() const {
+    return static_cast<Precision>(precision_.load(std::memory_order_relaxed));
+}
+
+size_t TimestampFormatter::format(std::chrono::system_clock::time_point time, char* out) {
+    const int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+    // Floor division, so that times before the epoch keep positive fractions.
+    int64_t seconds = us / 1000000;
+    int64_t fraction = us % 1000000;
+    if (fraction < 0) {
+        fraction += 1000000;
+        --seconds;
+    }
+
+    const int zone = zone_.load(std::memory_order_relaxed);
+
+    uint64_t words[kPrefixWords];
+    bool cached = false;
+    const uint32_t begin = seq_.load(std::memory_order_acquire);
+    if ((begin & 1) == 0 &&
+        cached_second_.load(std::memory_order_relaxed) == seconds &&
+        cached_zone_.load(std::memory_order_relaxed) == zone) {
+        for (size_t i = 0; i < kPrefixWords; ++i) {
+            words[i] = cached_prefix_[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        cached = seq_.load(std::memory_order_relaxed) == begin;
+    }
+
+    if (!cached) {
+        char prefix[kPrefixWords * sizeof(uint64_t)] = {};
+        format_prefix(seconds, static_cast<Zone>(zone), prefix);
+        std::memcpy(words, prefix, sizeof(words));
+
+        // Publish unless another thread is doing so right now; losing the
+        // race only costs that thread's next call a conversion.
+        uint32_t expected = begin;
+        if ((expected & 1) == 0 &&
+            seq_.compare_exchange_strong(expected, expected + 1, std::memory_order_acquire)) {
+            std::atomic_thread_fence(std::memory_order_release);
+            cached_second_.store(seconds, std::memory_order_relaxed);
+            cached_zone_.store(zone, std::memory_order_relaxed);
+            for (size_t i = 0; i < kPrefixWords; ++i) {
+                cached_prefix_[i].store(words[i], std::memory_order_relaxed);
+            }
+            seq_.store(expected + 2, std::memory_order_release);
+        }
+    }
+
+    std::memcpy(out, words, kPrefixLength);
+    if (precision_.load(std::memory_order_relaxed) == static_cast<int>(Precision::MICROSECONDS)) {
+        write_digits(out + kPrefixLength, static_cast<uint32_t>(fraction), 6);
+        return kPrefixLength + 6;
+    }
+    write_digits(out + kPrefixLength, static_cast<uint32_t>(fraction / 1000), 3);
+    return kPrefixLength + 3;
+}
+
+void TimestampFormatter::append(std::string& out, std::chrono::system_clock::time_point time) {
+    char buffer[kMaxLength];
+    out.append(buffer, format(time, buffer));
+}
+
+void TimestampFormatter::format_prefix(int64_t seconds, Zone zone, char* out) {
+    const std::time_t time = static_cast<std::time_t>(seconds);
+    std::tm tm {};
+#ifdef _WIN32
+    if (zone == Zone::UTC) {
+        gmtime_s(&tm, &time);
+    } else {
+        localtime_s(&tm, &time);
+    }
+#else
+    if (zone == Zone::UTC) {
+        gmtime_r(&time, &tm);
+    } else {
+        localtime_r(&time, &tm);
+    }
+#endif
+
+    write_digits(out, static_cast<uint32_t>(tm.tm_year + 1900), 4);
+    out[4] = '-';
+    write_digits(out + 5, static_cast<uint32_t>(tm.tm_mon + 1), 2);
+    out[7] = '-';
+    write_digits(out + 8, static_cast<uint32_t>(tm.tm_mday), 2);
+    out[10] = ' ';
+    write_digits(out + 11, static_cast<uint32_t>(tm.tm_hour), 2);
+    out[13] = ':';
+    write_digits(out + 14, static_cast<uint32_t>(tm.tm_min), 2);
+    out[16] = ':';
+    write_digits(out + 17, static_cast<uint32_t>(tm.tm_sec), 2);
+    out[19] = '.';
+}
+
+} // namespace logging
+} // namespace utoolkit
@@ -0,0 +1,1233 @@
+#include <gtest/gtest.h>
+#include <utoolkit/logging/binary_log.h>
+#include <utoolkit/logging/binary_log_reader.h>
+#include <utoolkit/logging/logger.h>
+#include <utoolkit/logging/mapped_file.h>
+#include <utoolkit/logging/mpsc_ring_buffer.h>
+#include <utoolkit/logging/rotating_file.h>
+#include <utoolkit/logging/sink.h>
+#include <utoolkit/logging/timestamp_formatter.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <ctime>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace utoolkit::logging;
+
+namespace {
+
+std::vector<std::string> read_lines(const std::string& filename) {
+    std::ifstream in(filename);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(in, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+size_t count_containing(const std::vector<std::string>& lines, const std::string& needle) {
+    size_t count = 0;
+    for (const auto& line : lines) {
+        if (line.find(needle) != std::string::npos) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+class LoggerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        filename_ = ::testing::TempDir() + "utoolkit_logger_" +
+                    ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".log";
+        std::remove(filename_.c_str());
+
+        Logger& logger = Logger::instance();
+        logger.enable_console_output(false);
+        logger.set_log_level(LogLevel::TRACE);
+        logger.set_log_file(filename_);
+    }
+
+    void TearDown() override {
+        Logger& logger = Logger::instance();
+        logger.disable_async();
+        logger.set_line_format(LineFormat::TEXT);
+        logger.set_log_level(LogLevel::INFO);
+        logger.enable_console_output(true);
+        std::remove(filename_.c_str());
+    }
+
+    std::string filename_;
+};
+
+} // namespace
+
+TEST(MpscRingBufferTest, RejectsPushWhenFull) {
+    MpscRingBuffer<int> ring(3);
+    EXPECT_EQ(ring.capacity(), 4u);
+
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(ring.try_push([i](int& slot) { slot = i; }));
+    }
+    EXPECT_FALSE(ring.try_push([](int& slot) { slot = 99; }));
+
+    int value = -1;
+    EXPECT_TRUE(ring.try_pop([&value](int& slot) { value = slot; }));
+    EXPECT_EQ(value, 0);
+    EXPECT_TRUE(ring.try_push([](int& slot) { slot = 4; }));
+    EXPECT_EQ(ring.push_count(), 5u);
+}
+
+TEST(MpscRingBufferTest, KeepsPerProducerOrder) {
+    constexpr int kProducers = 4;
+    constexpr int kPerProducer = 5000;
+    MpscRingBuffer<std::pair<int, int>> ring(64);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&ring, p]() {
+            for (int i = 0; i < kPerProducer; ++i) {
+                while (!ring.try_push([p, i](std::pair<int, int>& slot) { slot = {p, i}; })) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<int> next(kProducers, 0);
+    int received = 0;
+    while (received < kProducers * kPerProducer) {
+        bool popped = ring.try_pop([&](std::pair<int, int>& slot) {
+            EXPECT_EQ(slot.second, next[slot.first]);
+            next[slot.first] = slot.second + 1;
+            ++received;
+        });
+        if (!popped) {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& thread : producers) {
+        thread.join();
+    }
+}
+
+namespace {
+
+std::string reference_timestamp(std::chrono::system_clock::time_point time, bool utc, int digits) {
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+    std::time_t seconds = static_cast<std::time_t>(us / 1000000);
+    std::tm tm {};
+    if (utc) {
+        gmtime_r(&seconds, &tm);
+    } else {
+        localtime_r(&seconds, &tm);
+    }
+    char buffer[64];
+    size_t length = std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tm);
+    long long fraction = us % 1000000;
+    if (digits == 3) {
+        std::snprintf(buffer + length, sizeof(buffer) - length, ".%03lld", fraction / 1000);
+    } else {
+        std::snprintf(buffer + length, sizeof(buffer) - length, ".%06lld", fraction);
+    }
+    return buffer;
+}
+
+std::string format_timestamp(TimestampFormatter& formatter, std::chrono::system_clock::time_point time) {
+    std::string out;
+    formatter.append(out, time);
+    return out;
+}
+
+} // namespace
+
+TEST(TimestampFormatterTest, MatchesStrftime) {
+    TimestampFormatter utc(TimestampFormatter::Zone::UTC);
+    TimestampFormatter local(TimestampFormatter::Zone::LOCAL);
+
+    auto time = std::chrono::system_clock::time_point(std::chrono::microseconds(1700000000123456LL));
+    EXPECT_EQ(format_timestamp(utc, time), "2023-11-14 22:13:20.123");
+    EXPECT_EQ(format_timestamp(local, time), reference_timestamp(time, false, 3));
+
+    // Crossing seconds, minutes and days refreshes the cached prefix.
+    for (int64_t step : {999LL, 1000000LL, 59000000LL, 86400000000LL}) {
+        time += std::chrono::microseconds(step);
+        EXPECT_EQ(format_timestamp(utc, time), reference_timestamp(time, true, 3));
+        EXPECT_EQ(format_timestamp(local, time), reference_timestamp(time, false, 3));
+    }
+}
+
+TEST(TimestampFormatterTest, MicrosecondsAndZoneChanges) {
+    TimestampFormatter formatter(TimestampFormatter::Zone::UTC, TimestampFormatter::Precision::MICROSECONDS);
+    auto time = std::chrono::system_clock::time_point(std::chrono::microseconds(1700000000000042LL));
+    EXPECT_EQ(format_timestamp(formatter, time), "2023-11-14 22:13:20.000042");
+
+    formatter.set_precision(TimestampFormatter::Precision::MILLISECONDS);
+    formatter.set_zone(TimestampFormatter::Zone::LOCAL);
+    EXPECT_EQ(format_timestamp(formatter, time), reference_timestamp(time, false, 3));
+}
+
+TEST(TimestampFormatterTest, ConcurrentSecondsStayConsistent) {
+    TimestampFormatter formatter(TimestampFormatter::Zone::UTC);
+    std::vector<std::thread> threads;
+    std::atomic<int> mismatches {0};
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&formatter, &mismatches, t]() {
+            for (int i = 0; i < 2000; ++i) {
+                auto time = std::chrono::system_clock::time_point(
+                    std::chrono::seconds(1700000000 + (i + t) % 7) + std::chrono::milliseconds(i % 1000));
+                if (format_timestamp(formatter, time) != reference_timestamp(time, true, 3)) {
+                    ++mismatches;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(mismatches.load(), 0);
+}
+
+TEST_F(LoggerTest, SyncWritesToFile) {
+    UT_INFO("sync message");
+    auto lines = read_lines(filename_);
+    ASSERT_EQ(lines.size(), 1u);
+    EXPECT_NE(lines[0].find("[INFO] sync message"), std::string::npos);
+    EXPECT_NE(lines[0].find("test_logger.cpp:"), std::string::npos);
+}
+
+TEST_F(LoggerTest, AsyncWritesEverythingOnFlush) {
+    Logger& logger = Logger::instance();
+    logger.enable_async();
+    EXPECT_TRUE(logger.is_async());
+
+    constexpr int kThreads = 4;
+    constexpr int kPerThread = 2000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([]() {
+            for (int i = 0; i < kPerThread; ++i) {
+                UT_INFO("async message " + std::to_string(i));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    logger.flush();
+
+    auto lines = read_lines(filename_);
+    EXPECT_EQ(lines.size(), static_cast<size_t>(kThreads * kPerThread));
+    EXPECT_EQ(count_containing(lines, "async message 1999"), static_cast<size_t>(kThreads));
+}
+
+TEST_F(LoggerTest, FatalIsWrittenBeforeReturning) {
+    Logger::instance().enable_async();
+    UT_INFO("before fatal");
+    UT_FATAL("fatal message");
+
+    auto lines = read_lines(filename_);
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_NE(lines[1].find("[FATAL] fatal message"), std::string::npos);
+}
+
+TEST_F(LoggerTest, DisableAsyncWritesQueuedMessages) {
+    Logger& logger = Logger::instance();
+    logger.enable_async();
+    for (int i = 0; i < 100; ++i) {
+        UT_DEBUG("queued");
+    }
+    logger.disable_async();
+    EXPECT_FALSE(logger.is_async());
+    EXPECT_EQ(read_lines(filename_).size(), 100u);
+
+    UT_INFO("sync again");
+    EXPECT_EQ(read_lines(filename_).size(), 101u);
+}
+
+TEST_F(LoggerTest, DisableAsyncWhileLoggingLosesNothing) {
+    Logger& logger = Logger::instance();
+    AsyncOptions options;
+    options.queue_size = 2;
+    options.overflow_policy = OverflowPolicy::BLOCK;
+    logger.enable_async(options);
+
+    constexpr int kThreads = 4;
+    constexpr int kPerThread = 2000;
+    std::atomic<int> logged {0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&logged]() {
+            for (int i = 0; i < kPerThread; ++i) {
+                UT_INFO("racing message");
+                logged.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    // Producers blocked on the full queue when it stops finish their push
+    // into it; later ones write synchronously.
+    while (logged.load(std::memory_order_relaxed) < kThreads * kPerThread / 4) {
+        std::this_thread::yield();
+    }
+    logger.disable_async();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    logger.flush();
+
+    EXPECT_EQ(count_containing(read_lines(filename_), "racing message"), static_cast<size_t>(kThreads * kPerThread));
+}
+
+TEST_F(LoggerTest, DropAndCountReportsDrops) {
+    Logger& logger = Logger::instance();
+    const uint64_t dropped_before = logger.dropped_messages();
+
+    AsyncOptions options;
+    options.queue_size = 2;
+    options.overflow_policy = OverflowPolicy::DROP_AND_COUNT;
+    logger.enable_async(options);
+
+    constexpr int kMessages = 20000;
+    for (int i = 0; i < kMessages; ++i) {
+        UT_INFO("maybe dropped");
+    }
+    // Stopping the writer also writes the final drop notice.
+    logger.disable_async();
+
+    const uint64_t dropped = logger.dropped_messages() - dropped_before;
+    auto lines = read_lines(filename_);
+    EXPECT_EQ(count_containing(lines, "maybe dropped"), kMessages - dropped);
+    if (dropped > 0) {
+        EXPECT_GE(count_containing(lines, "log messages dropped"), 1u);
+    }
+}
+
+TEST_F(LoggerTest, FilteredMacroDoesNotEvaluateMessage) {
+    Logger::instance().set_log_level(LogLevel::WARN);
+    int evaluated = 0;
+    auto message = [&evaluated]() {
+        ++evaluated;
+        return std::string("built");
+    };
+
+    UT_DEBUG(message());
+    UT_INFO(message());
+    EXPECT_EQ(evaluated, 0);
+    EXPECT_TRUE(read_lines(filename_).empty());
+
+    UT_WARN(message());
+    EXPECT_EQ(evaluated, 1);
+    EXPECT_EQ(read_lines(filename_).size(), 1u);
+}
+
+TEST_F(LoggerTest, ShouldLogFollowsLevel) {
+    Logger& logger = Logger::instance();
+    logger.set_log_level(LogLevel::ERROR);
+    EXPECT_FALSE(logger.should_log(LogLevel::WARN));
+    EXPECT_TRUE(logger.should_log(LogLevel::ERROR));
+    EXPECT_TRUE(logger.should_log(LogLevel::FATAL));
+}
+
+#if defined(UT_LOG_HAVE_FMT) && UT_LOG_HAVE_FMT
+TEST_F(LoggerTest, FormattedMacroWritesMessage) {
+    UT_INFOF("x={} y={:.2f} name={}", 42, 1.5, std::string("abc"));
+    auto lines = read_lines(filename_);
+    ASSERT_EQ(lines.size(), 1u);
+    EXPECT_NE(lines[0].find("[INFO] x=42 y=1.50 name=abc"), std::string::npos);
+}
+
+TEST_F(LoggerTest, FormattedMacroDefersNumbersInAsyncMode) {
+    Logger& logger = Logger::instance();
+    logger.enable_async();
+
+    const char* text = "text";
+    for (int i = 0; i < 100; ++i) {
+        UT_INFOF("deferred {} {} {}", i, 2u, i * 0.5);
+        UT_INFOF("eager {} {}", i, text);
+    }
+    UT_INFOF("no arguments");
+    logger.flush();
+
+    auto lines = read_lines(filename_);
+    ASSERT_EQ(lines.size(), 201u);
+    EXPECT_NE(lines[198].find("deferred 99 2 49.5"), std::string::npos);
+    EXPECT_NE(lines[199].find("eager 99 text"), std::string::npos);
+    EXPECT_NE(lines[200].find("no arguments"), std::string::npos);
+}
+
+TEST_F(LoggerTest, FilteredFormattedMacroDoesNotEvaluateArguments) {
+    Logger::instance().set_log_level(LogLevel::INFO);
+    int evaluated = 0;
+    UT_DEBUGF("value {}", ++evaluated);
+    EXPECT_EQ(evaluated, 0);
+    EXPECT_TRUE(read_lines(filename_).empty());
+}
+#endif
+
+namespace {
+
+class BinaryLogTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        filename_ = ::testing::TempDir() + "utoolkit_binary_" +
+                    ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".blog";
+        Logger::instance().set_log_level(LogLevel::TRACE);
+        ASSERT_TRUE(BinaryLogger::instance().open(filename_));
+    }
+
+    void TearDown() override {
+        BinaryLogger::instance().close();
+        Logger::instance().set_log_level(LogLevel::INFO);
+        std::remove(filename_.c_str());
+    }
+
+    std::vector<BinaryLogRecord> read_records() {
+        BinaryLogReader reader;
+        EXPECT_TRUE(reader.open(filename_)) << reader.error();
+        std::vector<BinaryLogRecord> records;
+        BinaryLogRecord record;
+        while (reader.next(record)) {
+            records.push_back(record);
+        }
+        EXPECT_EQ(reader.error(), "");
+        return records;
+    }
+
+    std::string filename_;
+};
+
+enum Color { RED, GREEN };
+
+} // namespace
+
+static_assert(detail::count_placeholders("a {} b {:.2f} {{literal}} }}") == 2, "");
+static_assert(detail::count_placeholders("none") == 0, "");
+
+TEST_F(BinaryLogTest, RoundTripsArguments) {
+    const std::string name = "worker";
+    const char* null_text = nullptr;
+    UT_INFOB("start");
+    const int line = __LINE__ + 1;
+    UT_WARNB("i={} u={} q={} c={} b={} d={} f={} s={} sv={} n={} e={}", -7, 42u, -(int64_t {1} << 40), 'x', true,
+             0.1, 2.5f, name, std::string_view("view"), null_text, GREEN);
+    BinaryLogger::instance().close();
+
+    auto records = read_records();
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[0].message, "start");
+    EXPECT_EQ(records[0].level, LogLevel::INFO);
+    EXPECT_EQ(records[1].level, LogLevel::WARN);
+    EXPECT_EQ(records[1].message,
+              "i=-7 u=42 q=-1099511627776 c=x b=true d=0.1 f=2.5 s=worker sv=view n=(null) e=1");
+    EXPECT_EQ(records[1].line, line);
+    EXPECT_NE(records[1].file.find("test_logger.cpp"), std::string::npos);
+}
+
+TEST_F(BinaryLogTest, TimestampsFollowWallClock) {
+    const auto before = std::chrono::system_clock::now();
+    UT_INFOB("now");
+    const auto after = std::chrono::system_clock::now();
+    BinaryLogger::instance().close();
+
+    auto records = read_records();
+    ASSERT_EQ(records.size(), 1u);
+    // The tick rate is measured over a few milliseconds when the file opens.
+    EXPECT_GE(records[0].time, before - std::chrono::milliseconds(5));
+    EXPECT_LE(records[0].time, after + std::chrono::milliseconds(5));
+}
+
+TEST_F(BinaryLogTest, WritesRecordsOfAllThreads) {
+    constexpr int kThreads = 4;
+    constexpr int kPerThread = 20000;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([t]() {
+            for (int i = 0; i < kPerThread; ++i) {
+                UT_DEBUGB("thread {} message {}", t, i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    BinaryLogger::instance().close();
+
+    auto records = read_records();
+    ASSERT_EQ(records.size(), static_cast<size_t>(kThreads * kPerThread));
+    std::vector<int> next(kThreads, 0);
+    for (const auto& record : records) {
+        int t = -1;
+        int i = -1;
+        ASSERT_EQ(std::sscanf(record.message.c_str(), "thread %d message %d", &t, &i), 2);
+        ASSERT_GE(t, 0);
+        ASSERT_LT(t, kThreads);
+        EXPECT_EQ(i, next[t]++);
+    }
+}
+
+TEST_F(BinaryLogTest, FlushWritesBufferedRecords) {
+    UT_INFOB("buffered {}", 1);
+    BinaryLogger::instance().flush();
+
+    // Still open: the file holds everything logged before flush().
+    auto records = read_records();
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_EQ(records[0].message, "buffered 1");
+}
+
+TEST_F(BinaryLogTest, FilteredCallDoesNotEvaluateArguments) {
+    Logger::instance().set_log_level(LogLevel::WARN);
+    int evaluated = 0;
+    UT_INFOB("value {}", ++evaluated);
+    EXPECT_EQ(evaluated, 0);
+    BinaryLogger::instance().close();
+    EXPECT_TRUE(read_records().empty());
+}
+
+TEST_F(BinaryLogTest, ReportsTruncatedFile) {
+    UT_INFOB("first {}", 1);
+    UT_INFOB("second {}", std::string("abcdef"));
+    BinaryLogger::instance().close();
+
+    std::ifstream in(filename_, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    // Cut into the last record, ahead of the closing clock sync.
+    const size_t cut = content.rfind("abcdef") + 3;
+    std::ofstream(filename_, std::ios::binary | std::ios::trunc).write(content.data(), cut);
+
+    BinaryLogReader reader;
+    ASSERT_TRUE(reader.open(filename_));
+    BinaryLogRecord record;
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.message, "first 1");
+    EXPECT_FALSE(reader.next(record));
+    EXPECT_EQ(reader.error(), "truncated record");
+}
+
+TEST_F(BinaryLogTest, RejectsOtherFiles) {
+    BinaryLogger::instance().close();
+    std::ofstream(filename_, std::ios::trunc) << "2024-01-01 00:00:00.000 [INFO] text log";
+    BinaryLogReader reader;
+    EXPECT_FALSE(reader.open(filename_));
+    EXPECT_FALSE(reader.error().empty());
+}
+
+namespace {
+
+class RotatingFileTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        directory_ = std::filesystem::path(::testing::TempDir()) /
+                     (std::string("utoolkit_rotating_") +
+                      ::testing::UnitTest::GetInstance()->current_test_info()->name());
+        std::filesystem::remove_all(directory_);
+        std::filesystem::create_directories(directory_);
+        filename_ = (directory_ / "app.log").string();
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(directory_);
+    }
+
+    // Rotated files, oldest first.
+    std::vector<std::string> archives() const {
+        std::vector<std::string> names;
+        for (const auto& entry : std::filesystem::directory_iterator(directory_)) {
+            const std::string name = entry.path().filename().string();
+            if (name != "app.log") {
+                names.push_back(name);
+            }
+        }
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    std::filesystem::path directory_;
+    std::string filename_;
+};
+
+} // namespace
+
+TEST_F(RotatingFileTest, RotatesBySizeAndKeepsMaxFiles) {
+    RotatingFile file;
+    ASSERT_TRUE(file.open(filename_));
+    RotationOptions options;
+    options.max_file_size = 100;
+    options.max_files = 3;
+    file.set_options(options);
+
+    const auto now = std::chrono::system_clock::now();
+    for (int i = 0; i < 20; ++i) {
+        char line[64];
+        std::snprintf(line, sizeof(line), "line %02d with some padding\n", i);
+        file.write(line, now);
+    }
+    file.flush();
+    file.wait_idle();
+
+    // Three lines per file; the newest three rotated files are kept.
+    auto names = archives();
+    ASSERT_EQ(names.size(), 3u);
+    auto current = read_lines(filename_);
+    ASSERT_EQ(current.size(), 2u);
+    EXPECT_EQ(current[0].substr(0, 7), "line 18");
+
+    // Rotations within one second are told apart by a sequence number that
+    // keeps growing while the oldest files are pruned, so the newest three
+    // of the six rotations are kept.
+    const std::time_t rotated = std::chrono::system_clock::to_time_t(now);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "app.%Y%m%d-%H%M%S", std::gmtime(&rotated));
+    EXPECT_EQ(names, (std::vector<std::string>{std::string(stamp) + "_3.log", std::string(stamp) + "_4.log",
+                                               std::string(stamp) + "_5.log"}));
+    auto newest = read_lines((directory_ / names.back()).string());
+    ASSERT_EQ(newest.size(), 3u);
+    EXPECT_EQ(newest[0].substr(0, 7), "line 15");
+}
+
+TEST_F(RotatingFileTest, RotatesOnInterval) {
+    RotatingFile file;
+    ASSERT_TRUE(file.open(filename_));
+    RotationOptions options;
+    options.interval = std::chrono::seconds(3600);
+    file.set_options(options);
+
+    const auto now = std::chrono::system_clock::now();
+    file.write("first\n", now);
+    EXPECT_TRUE(archives().empty());
+
+    file.write("second\n", now + std::chrono::hours(1));
+    file.write("third\n", now + std::chrono::hours(1));
+    file.flush();
+    auto names = archives();
+    ASSERT_EQ(names.size(), 1u);
+    EXPECT_EQ(read_lines((directory_ / names[0]).string()), std::vector<std::string>{"first"});
+    EXPECT_EQ(read_lines(filename_), (std::vector<std::string>{"second", "third"}));
+
+    // Named after the UTC time of the rotation.
+    const std::time_t rotated = std::chrono::system_clock::to_time_t(now + std::chrono::hours(1));
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "app.%Y%m%d-%H%M%S.log", std::gmtime(&rotated));
+    EXPECT_EQ(names[0], stamp);
+}
+
+TEST_F(RotatingFileTest, RetentionCanShrinkAtRuntime) {
+    RotatingFile file;
+    ASSERT_TRUE(file.open(filename_));
+    RotationOptions options;
+    options.max_file_size = 10;
+    file.set_options(options);
+
+    const auto now = std::chrono::system_clock::now();
+    for (int i = 0; i < 6; ++i) {
+        file.write("0123456789\n", now + std::chrono::seconds(i));
+    }
+    EXPECT_EQ(archives().size(), 5u);
+
+    options.max_files = 2;
+    file.set_options(options);
+    file.wait_idle();
+    EXPECT_EQ(archives().size(), 2u);
+}
+
+TEST_F(RotatingFileTest, CompressesInBackground) {
+    if (!RotatingFile::is_supported(Compression::GZIP)) {
+        GTEST_SKIP() << "built without zlib";
+    }
+
+    RotatingFile file;
+    ASSERT_TRUE(file.open(filename_));
+    RotationOptions options;
+    options.max_file_size = 1000;
+    options.compression = Compression::GZIP;
+    file.set_options(options);
+
+    const auto now = std::chrono::system_clock::now();
+    const std::string line(100, 'x');
+    for (int i = 0; i < 11; ++i) {
+        file.write(line + "\n", now);
+    }
+    file.wait_idle();
+
+    auto names = archives();
+    ASSERT_EQ(names.size(), 1u);
+    ASSERT_EQ(names[0].substr(names[0].size() - 7), ".log.gz");
+    std::ifstream in(directory_ / names[0], std::ios::binary);
+    unsigned char magic[2] = {};
+    in.read(reinterpret_cast<char*>(magic), 2);
+    EXPECT_EQ(magic[0], 0x1f);
+    EXPECT_EQ(magic[1], 0x8b);
+    EXPECT_LT(std::filesystem::file_size(directory_ / names[0]), 100u);
+}
+
+TEST_F(RotatingFileTest, LoggerRotatesItsFile) {
+    Logger& logger = Logger::instance();
+    logger.enable_console_output(false);
+    logger.set_log_file(filename_);
+    RotationOptions options;
+    options.max_file_size = 200;
+    options.max_files = 2;
+    logger.set_rotation(options);
+
+    for (int i = 0; i < 20; ++i) {
+        UT_INFO("rotating logger message " + std::to_string(i));
+    }
+    logger.flush();
+    // The pruner must be done before TearDown() removes the directory.
+    logger.file_sink()->wait_idle();
+
+    EXPECT_EQ(count_containing(read_lines(filename_), "rotating logger message 19"), 1u);
+    EXPECT_FALSE(archives().empty());
+    logger.set_rotation(RotationOptions());
+    logger.set_log_file((directory_ / "other.log").string());
+    logger.enable_console_output(true);
+}
+
+TEST(SinkTest, BuffersUntilSizeIsReached) {
+    RingSink sink(16);
+    FlushPolicy policy;
+    policy.buffer_size = 30;
+    sink.set_flush_policy(policy);
+
+    sink.write(LogLevel::INFO, "first line\n");
+    sink.write(LogLevel::INFO, "second line\n");
+    EXPECT_TRUE(sink.lines().empty());
+
+    sink.write(LogLevel::INFO, "third line\n");
+    EXPECT_EQ(sink.lines(), (std::vector<std::string>{"first line", "second line", "third line"}));
+}
+
+TEST(SinkTest, FlushLevelWritesRightAway) {
+    RingSink sink(16);
+    FlushPolicy policy;
+    policy.buffer_size = 1 << 20;
+    policy.flush_level = LogLevel::ERROR;
+    sink.set_flush_policy(policy);
+
+    sink.write(LogLevel::WARN, "buffered\n");
+    EXPECT_TRUE(sink.lines().empty());
+    sink.write(LogLevel::ERROR, "urgent\n");
+    EXPECT_EQ(sink.lines(), (std::vector<std::string>{"buffered", "urgent"}));
+}
+
+TEST(SinkTest, FlushesAfterMaxDelay) {
+    RingSink sink(16);
+    FlushPolicy policy;
+    policy.max_delay = std::chrono::milliseconds(50);
+    sink.set_flush_policy(policy);
+
+    const auto start = std::chrono::system_clock::now();
+    sink.write(LogLevel::INFO, "delayed\n", start);
+    sink.flush_if_due(start + std::chrono::milliseconds(10));
+    EXPECT_TRUE(sink.lines().empty());
+    sink.flush_if_due(start + std::chrono::milliseconds(60));
+    EXPECT_EQ(sink.lines(), std::vector<std::string>{"delayed"});
+}
+
+TEST(SinkTest, RingKeepsLastLines) {
+    RingSink sink(2);
+    sink.write(LogLevel::INFO, "a\nb\nc\n");
+    EXPECT_EQ(sink.lines(), (std::vector<std::string>{"b", "c"}));
+    sink.clear();
+    EXPECT_TRUE(sink.lines().empty());
+}
+
+namespace {
+
+std::string read_file(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+std::string mapped_file_name() {
+    const std::string name = ::testing::TempDir() + "utoolkit_mapped_" +
+                             ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".log";
+    std::remove(name.c_str());
+    return name;
+}
+
+} // namespace
+
+TEST(MappedFileTest, AppendsAcrossExtentsAndTruncatesOnClose) {
+    if (!MappedFile::is_supported()) {
+        GTEST_SKIP();
+    }
+    const std::string filename = mapped_file_name();
+    MappedFileOptions options;
+    options.extent_size = 4096;
+    options.writeback_bytes = 8192;
+
+    MappedFile file;
+    ASSERT_TRUE(file.open(filename, options));
+    std::string expected;
+    for (int i = 0; i < 1000; ++i) {
+        const std::string line = "line " + std::to_string(i) + " " + std::string(static_cast<size_t>(i % 50), 'x') + "\n";
+        ASSERT_TRUE(file.write(line));
+        expected += line;
+    }
+    // A single write spanning several extents.
+    const std::string large(3 * 4096 + 100, 'y');
+    ASSERT_TRUE(file.write(large));
+    expected += large;
+
+    EXPECT_EQ(file.size(), expected.size());
+    EXPECT_GT(std::filesystem::file_size(filename), expected.size());
+    file.close();
+    EXPECT_EQ(read_file(filename), expected);
+    std::remove(filename.c_str());
+}
+
+TEST(MappedFileTest, ReopenAppendsAfterCrashPadding) {
+    if (!MappedFile::is_supported()) {
+        GTEST_SKIP();
+    }
+    const std::string filename = mapped_file_name();
+    {
+        // What a process killed while writing leaves behind.
+        std::ofstream out(filename, std::ios::binary);
+        out << "before\n" << std::string(10000, '\0');
+    }
+
+    MappedFile file;
+    ASSERT_TRUE(file.open(filename));
+    EXPECT_EQ(file.size(), 7u);
+    ASSERT_TRUE(file.write("after\n"));
+    file.sync();
+    EXPECT_EQ(read_file(filename).substr(0, 13), "before\nafter\n");
+    file.close();
+    EXPECT_EQ(read_file(filename), "before\nafter\n");
+    std::remove(filename.c_str());
+}
+
+TEST_F(LoggerTest, MappedFileSinkReceivesMessages) {
+    if (!MappedFile::is_supported()) {
+        GTEST_SKIP();
+    }
+    const std::string filename = mapped_file_name();
+    Logger& logger = Logger::instance();
+    auto sink = std::make_shared<MappedFileSink>(filename);
+    ASSERT_TRUE(sink->is_open());
+    logger.add_sink(sink);
+
+    for (int i = 0; i < 100; ++i) {
+        UT_INFO("mapped " + std::to_string(i));
+    }
+    logger.remove_sink(sink);
+    sink->close();
+
+    auto lines = read_lines(filename);
+    ASSERT_EQ(lines.size(), 100u);
+    EXPECT_NE(lines[99].find("[INFO] mapped 99"), std::string::npos);
+    std::remove(filename.c_str());
+}
+
+TEST_F(LoggerTest, SinksHaveTheirOwnLevels) {
+    Logger& logger = Logger::instance();
+    auto all = std::make_shared<RingSink>(16);
+    auto warnings = std::make_shared<RingSink>(16);
+    warnings->set_level(LogLevel::WARN);
+    logger.add_sink(all);
+    logger.add_sink(warnings);
+
+    UT_INFO("info message");
+    UT_WARN("warn message");
+    logger.remove_sink(all);
+    logger.remove_sink(warnings);
+    UT_ERROR("after removal");
+
+    EXPECT_EQ(all->lines().size(), 2u);
+    ASSERT_EQ(warnings->lines().size(), 1u);
+    EXPECT_NE(warnings->lines()[0].find("[WARN] warn message"), std::string::npos);
+    EXPECT_EQ(read_lines(filename_).size(), 3u);
+}
+
+TEST_F(LoggerTest, AsyncFlushWritesBufferedSinks) {
+    Logger& logger = Logger::instance();
+    auto sink = std::make_shared<RingSink>(1000);
+    FlushPolicy policy;
+    policy.buffer_size = 1 << 20;
+    sink->set_flush_policy(policy);
+    auto null_sink = std::make_shared<NullSink>();
+    logger.add_sink(sink);
+    logger.add_sink(null_sink);
+    logger.enable_async();
+
+    for (int i = 0; i < 100; ++i) {
+        UT_INFO("buffered " + std::to_string(i));
+    }
+    logger.flush();
+
+    auto lines = sink->lines();
+    ASSERT_EQ(lines.size(), 100u);
+    EXPECT_NE(lines[99].find("buffered 99"), std::string::npos);
+    EXPECT_GT(null_sink->bytes_written(), 100u * 10);
+
+    logger.disable_async();
+    logger.remove_sink(sink);
+    logger.remove_sink(null_sink);
+}
+
+TEST_F(LoggerTest, EveryNReportsSkippedCalls) {
+    Logger& logger = Logger::instance();
+    auto sink = std::make_shared<RingSink>(16);
+    logger.add_sink(sink);
+
+    for (int i = 0; i < 10; ++i) {
+        UT_LOG_EVERY_N(LogLevel::INFO, 3, "every third " + std::to_string(i));
+    }
+    logger.remove_sink(sink);
+
+    auto lines = sink->lines();
+    ASSERT_EQ(lines.size(), 4u);
+    EXPECT_NE(lines[0].find("every third 0"), std::string::npos);
+    EXPECT_EQ(lines[0].find("suppressed"), std::string::npos);
+    EXPECT_NE(lines[3].find("every third 9 (2 similar messages suppressed)"), std::string::npos);
+}
+
+TEST_F(LoggerTest, FirstNStopsAfterLimit) {
+    Logger& logger = Logger::instance();
+    auto sink = std::make_shared<RingSink>(16);
+    logger.add_sink(sink);
+
+    int evaluated = 0;
+    for (int i = 0; i < 10; ++i) {
+        UT_LOG_FIRST_N(LogLevel::WARN, 3, (++evaluated, "first calls"));
+    }
+    logger.remove_sink(sink);
+
+    EXPECT_EQ(sink->lines().size(), 3u);
+    EXPECT_EQ(evaluated, 3);
+}
+
+TEST_F(LoggerTest, EveryMsReportsSuppressedCountOnResume) {
+    Logger& logger = Logger::instance();
+    auto sink = std::make_shared<RingSink>(16);
+    logger.add_sink(sink);
+
+    auto log = []() { UT_LOG_EVERY_MS(LogLevel::ERROR, 50, "throttled"); };
+    for (int i = 0; i < 5; ++i) {
+        log();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    log();
+    logger.remove_sink(sink);
+
+    auto lines = sink->lines();
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_NE(lines[1].find("throttled (4 similar messages suppressed)"), std::string::npos);
+}
+
+TEST_F(LoggerTest, RateLimitedAllowsBurst) {
+    Logger& logger = Logger::instance();
+    auto sink = std::make_shared<RingSink>(16);
+    logger.add_sink(sink);
+
+    for (int i = 0; i < 10; ++i) {
+        UT_LOG_RATE_LIMITED(LogLevel::INFO, 1, 3, "bursty");
+    }
+    logger.remove_sink(sink);
+
+    EXPECT_EQ(sink->lines().size(), 3u);
+}
+
+TEST_F(LoggerTest, RateLimitedFilteredLevelKeepsTokens) {
+    Logger& logger = Logger::instance();
+    auto sink = std::make_shared<RingSink>(16);
+    logger.add_sink(sink);
+
+    auto log = []() { UT_LOG_RATE_LIMITED(LogLevel::DEBUG, 1, 2, "debug"); };
+    logger.set_log_level(LogLevel::INFO);
+    for (int i = 0; i < 10; ++i) {
+        log();
+    }
+    logger.set_log_level(LogLevel::TRACE);
+    log();
+    log();
+    logger.remove_sink(sink);
+
+    auto lines = sink->lines();
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_EQ(lines[1].find("suppressed"), std::string::npos);
+}
+
+namespace {
+
+class FlightRecorderTest : public LoggerTest {
+protected:
+    void SetUp() override {
+        LoggerTest::SetUp();
+        dump_file_ = ::testing::TempDir() + "utoolkit_flight_" +
+                     ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".log";
+        std::remove(dump_file_.c_str());
+        FlightRecorder::instance().clear();
+    }
+
+    void TearDown() override {
+        Logger::instance().disable_flight_recorder();
+        std::remove(dump_file_.c_str());
+        LoggerTest::TearDown();
+    }
+
+    FlightRecorderOptions options() const {
+        FlightRecorderOptions options;
+        options.dump_file = dump_file_;
+        options.dump_on_crash = false;
+        return options;
+    }
+
+    std::string dump_file_;
+};
+
+} // namespace
+
+TEST_F(FlightRecorderTest, CapturesFilteredMessages) {
+    Logger& logger = Logger::instance();
+    logger.set_log_level(LogLevel::INFO);
+    logger.enable_flight_recorder(options());
+    EXPECT_FALSE(logger.should_log(LogLevel::DEBUG));
+    EXPECT_TRUE(logger.should_capture(LogLevel::DEBUG));
+
+    UT_DEBUG("debug context");
+    UT_INFO("info message");
+    ASSERT_TRUE(logger.dump_flight_recorder());
+
+    auto written = read_lines(filename_);
+    ASSERT_EQ(written.size(), 1u);
+    EXPECT_NE(written[0].find("info message"), std::string::npos);
+
+    auto dumped = read_lines(dump_file_);
+    ASSERT_EQ(dumped.size(), 3u);
+    EXPECT_EQ(dumped[0], "--- flight recorder dump ---");
+    EXPECT_NE(dumped[1].find("[DEBUG] [tid "), std::string::npos);
+    EXPECT_NE(dumped[1].find("debug context (" __FILE__), std::string::npos);
+    EXPECT_NE(dumped[2].find("[INFO]"), std::string::npos);
+
+    logger.disable_flight_recorder();
+    EXPECT_FALSE(logger.should_capture(LogLevel::DEBUG));
+}
+
+TEST_F(FlightRecorderTest, KeepsLastRecordsOfEachThread) {
+    Logger& logger = Logger::instance();
+    FlightRecorderOptions opts = options();
+    opts.records_per_thread = 4;
+    logger.enable_flight_recorder(opts);
+    logger.clear_sinks();
+
+    // Alive until all have recorded, an exited thread's ring is reused.
+    std::atomic<int> done {0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 3; ++t) {
+        threads.emplace_back([t, &done]() {
+            for (int i = 0; i < 10; ++i) {
+                UT_TRACE("thread " + std::to_string(t) + " record " + std::to_string(i));
+            }
+            done.fetch_add(1);
+            while (done.load() < 3) {
+                std::this_thread::yield();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_TRUE(FlightRecorder::instance().dump(dump_file_.c_str()));
+    logger.add_sink(logger.file_sink());
+
+    auto dumped = read_lines(dump_file_);
+    ASSERT_EQ(dumped.size(), 1u + 3 * 4);
+    for (int t = 0; t < 3; ++t) {
+        const std::string prefix = "thread " + std::to_string(t) + " record ";
+        EXPECT_EQ(count_containing(dumped, prefix), 4u);
+        EXPECT_EQ(count_containing(dumped, prefix + "5"), 0u);
+        EXPECT_EQ(count_containing(dumped, prefix + "6"), 1u);
+    }
+    EXPECT_TRUE(std::is_sorted(dumped.begin() + 1, dumped.end()));
+}
+
+TEST_F(FlightRecorderTest, DumpsOnFatal) {
+    Logger& logger = Logger::instance();
+    logger.set_log_level(LogLevel::WARN);
+    logger.enable_flight_recorder(options());
+
+    UT_DEBUG("before the end");
+    UT_FATAL("the end");
+
+    auto dumped = read_lines(dump_file_);
+    ASSERT_EQ(dumped.size(), 3u);
+    EXPECT_NE(dumped[1].find("before the end"), std::string::npos);
+    EXPECT_NE(dumped[2].find("[FATAL] [tid"), std::string::npos);
+}
+
+TEST_F(FlightRecorderTest, ClearForgetsRecords) {
+    Logger& logger = Logger::instance();
+    logger.enable_flight_recorder(options());
+    UT_INFO("forgotten");
+    FlightRecorder::instance().clear();
+    UT_INFO("kept");
+    ASSERT_TRUE(logger.dump_flight_recorder());
+
+    auto dumped = read_lines(dump_file_);
+    ASSERT_EQ(dumped.size(), 2u);
+    EXPECT_NE(dumped[1].find("kept"), std::string::npos);
+}
+
+TEST_F(FlightRecorderTest, DumpsOnCrash) {
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    FlightRecorderOptions opts = options();
+    opts.dump_on_crash = true;
+    EXPECT_DEATH({
+        Logger::instance().enable_flight_recorder(opts);
+        UT_TRACE("last words");
+        std::abort();
+    }, "");
+
+    auto dumped = read_lines(dump_file_);
+    ASSERT_EQ(dumped.size(), 2u);
+    EXPECT_EQ(dumped[0], "--- flight recorder dump: SIGABRT ---");
+    EXPECT_NE(dumped[1].find("last words"), std::string::npos);
+}
+
+TEST_F(LoggerTest, KeyValuesFollowTextMessage) {
+    UT_INFO_KV("request done", kv("user", 42), kv("path", "/a b"), kv("ok", true), kv("ratio", 0.5),
+               kv("name", std::string("bob")));
+    UT_INFO_KV("no fields");
+
+    auto lines = read_lines(filename_);
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_NE(lines[0].find("[INFO] request done user=42 path=\"/a b\" ok=true ratio=0.5 name=bob ("),
+              std::string::npos);
+    EXPECT_NE(lines[1].find("[INFO] no fields ("), std::string::npos);
+}
+
+TEST_F(LoggerTest, JsonLines) {
+    Logger& logger = Logger::instance();
+    logger.set_line_format(LineFormat::JSON);
+
+    enum class Color { RED = 1, BLUE = 2 };
+    const int line = __LINE__ + 1;
+    UT_WARN_KV("say \"hi\"\n", kv("user", -7), kv("lat_us", 1.25), kv("path", "c:\\tmp"), kv("color", Color::BLUE),
+               kv("nan", std::nan("")), kv("we\"ird", 'x'), kv("none", static_cast<const char*>(nullptr)));
+    logger.log(LogLevel::INFO, "plain");
+
+    auto lines = read_lines(filename_);
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_EQ(lines[0].rfind("{\"time\":\"", 0), 0u);
+    const std::string expected = "\",\"level\":\"WARN\",\"msg\":\"say \\\"hi\\\"\\n\",\"user\":-7,\"lat_us\":1.25,"
+                                 "\"path\":\"c:\\\\tmp\",\"color\":2,\"nan\":null,\"we\\\"ird\":\"x\",\"none\":null,"
+                                 "\"file\":\"" __FILE__ "\",\"line\":" + std::to_string(line) + "}";
+    EXPECT_NE(lines[0].find(expected), std::string::npos) << lines[0];
+    EXPECT_NE(lines[1].find("\",\"level\":\"INFO\",\"msg\":\"plain\"}"), std::string::npos) << lines[1];
+}
+
+TEST_F(LoggerTest, Logfmt) {
+    Logger& logger = Logger::instance();
+    logger.set_line_format(LineFormat::LOGFMT);
+    logger.enable_async();
+
+    UT_ERROR_KV("disk full", kv("free", 0u), kv("mount point", "/var/log"), kv("empty", ""),
+                kv("inf", -HUGE_VAL));
+    logger.flush();
+
+    auto lines = read_lines(filename_);
+    ASSERT_EQ(lines.size(), 1u);
+    EXPECT_EQ(lines[0].rfind("time=\"", 0), 0u);
+    EXPECT_NE(lines[0].find("\" level=ERROR msg=\"disk full\" free=0 mount_point=/var/log empty=\"\" inf=-Inf file="),
+              std::string::npos) << lines[0];
+}
+
+TEST_F(LoggerTest, FilteredKeyValuesAreNotEvaluated) {
+    Logger& logger = Logger::instance();
+    logger.set_log_level(LogLevel::INFO);
+    int evaluated = 0;
+    UT_DEBUG_KV("filtered", kv("n", ++evaluated));
+    EXPECT_EQ(evaluated, 0);
+    EXPECT_TRUE(read_lines(filename_).empty());
+}
+
+TEST_F(LoggerTest, CategoryLevelOverridesLoggerLevel) {
+    Logger& logger = Logger::instance();
+    logger.set_log_level(LogLevel::INFO);
+    logger.set_category_level("net", LogLevel::DEBUG);
+    logger.set_category_level("db", LogLevel::ERROR);
+
+    UT_LOG_CAT(net, DEBUG, "net debug");
+    UT_LOG_CAT(net, TRACE, "net trace");
+    UT_LOG_CAT(db, WARN, "db warn");
+    UT_LOG_CAT(disk, DEBUG, "disk debug");
+    UT_LOG_CAT(disk, INFO, "disk info");
+    UT_DEBUG("global debug");
+
+    auto lines = read_lines(filename_);
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_NE(lines[0].find("[DEBUG] [net] net debug ("), std::string::npos) << lines[0];
+    EXPECT_NE(lines[1].find("[INFO] [disk] disk info ("), std::string::npos) << lines[1];
+
+    logger.reset_category_level("net");
+    logger.reset_category_level("db");
+}
+
+TEST_F(LoggerTest, CategoryFollowsLoggerLevelAfterReset) {
+    Logger& logger = Logger::instance();
+    LogCategory* cache = logger.category("cache");
+    EXPECT_EQ(logger.category("cache"), cache);
+    EXPECT_EQ(cache->name(), "cache");
+    EXPECT_FALSE(cache->has_own_level());
+
+    logger.set_log_level(LogLevel::WARN);
+    EXPECT_EQ(cache->level(), LogLevel::WARN);
+    logger.set_category_level("cache", LogLevel::TRACE);
+    EXPECT_TRUE(cache->should_log(LogLevel::TRACE));
+    logger.set_log_level(LogLevel::ERROR);
+    EXPECT_EQ(cache->level(), LogLevel::TRACE);
+
+    logger.reset_category_level("cache");
+    EXPECT_FALSE(cache->has_own_level());
+    EXPECT_EQ(cache->level(), LogLevel::ERROR);
+    EXPECT_FALSE(cache->should_log(LogLevel::WARN));
+}
+
+TEST_F(LoggerTest, FilteredCategoryDoesNotEvaluateMessage) {
+    Logger& logger = Logger::instance();
+    logger.set_log_level(LogLevel::DEBUG);
+    logger.set_category_level("quiet", LogLevel::ERROR);
+    int evaluated = 0;
+    auto message = [&evaluated]() {
+        ++evaluated;
+        return std::string("built");
+    };
+
+    UT_LOG_CAT(quiet, WARN, message());
+    EXPECT_EQ(evaluated, 0);
+    UT_LOG_CAT(quiet, ERROR, message());
+    EXPECT_EQ(evaluated, 1);
+    EXPECT_EQ(read_lines(filename_).size(), 1u);
+
+    logger.reset_category_level("quiet");
+}
+
+TEST_F(LoggerTest, CategoryInStructuredLines) {
+    Logger& logger = Logger::instance();
+    logger.set_line_format(LineFormat::JSON);
+    UT_LOG_CAT(net, INFO, "json");
+    logger.set_line_format(LineFormat::LOGFMT);
+    logger.enable_async();
+    UT_LOG_CAT(net, INFO, "logfmt");
+    logger.flush();
+
+    auto lines = read_lines(filename_);
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_NE(lines[0].find("\",\"level\":\"INFO\",\"category\":\"net\",\"msg\":\"json\","), std::string::npos)
+        << lines[0];
+    EXPECT_NE(lines[1].find("\" level=INFO category=net msg=logfmt file="), std::string::npos) << lines[1];
+}
@@ -0,0 +1,110 @@
+// Turns binary log files written by BinaryLogger (UT_INFOB and friends) back
+// into text lines in the Logger format.
+//
+//   utoolkit_log_decode [--utc] [--sort] FILE...
+
+#include <utoolkit/logging/binary_log_reader.h>
+#include <utoolkit/logging/timestamp_formatter.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace utoolkit::logging;
+
+namespace {
+
+const char* level_to_string(LogLevel level) {
+    switch (level) {
+        case LogLevel::TRACE: return "TRACE";
+        case LogLevel::DEBUG: return "DEBUG";
+        case LogLevel::INFO: return "INFO";
+        case LogLevel::WARN: return "WARN";
+        case LogLevel::ERROR: return "ERROR";
+        case LogLevel::FATAL: return "FATAL";
+        default: return "UNKNOWN";
+    }
+}
+
+void print(const BinaryLogRecord& record, TimestampFormatter& timestamp, std::string& line) {
+    line.clear();
+    timestamp.append(line, record.time);
+    line += " [";
+    line += level_to_string(record.level);
+    line += "] ";
+    line += record.message;
+    if (!record.file.empty()) {
+        line += " (";
+        line += record.file;
+        line += ":";
+        line += std::to_string(record.line);
+        line += ")";
+    }
+    line += '\n';
+    std::cout.write(line.data(), static_cast<std::streamsize>(line.size()));
+}
+
+void usage() {
+    std::cerr << "usage: utoolkit_log_decode [--utc] [--sort] FILE..." << std::endl
+              << "  --utc   print UTC instead of local time" << std::endl
+              << "  --sort  order the records of all threads by time (reads the whole file)" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    TimestampFormatter timestamp(TimestampFormatter::Zone::LOCAL, TimestampFormatter::Precision::MICROSECONDS);
+    bool sort = false;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--utc") == 0) {
+            timestamp.set_zone(TimestampFormatter::Zone::UTC);
+        } else if (std::strcmp(argv[i], "--sort") == 0) {
+            sort = true;
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 2;
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.empty()) {
+        usage();
+        return 2;
+    }
+
+    int status = 0;
+    std::string line;
+    for (const std::string& file : files) {
+        BinaryLogReader reader;
+        if (!reader.open(file)) {
+            std::cerr << "utoolkit_log_decode: " << reader.error() << std::endl;
+            status = 1;
+            continue;
+        }
+
+        std::vector<BinaryLogRecord> records;
+        BinaryLogRecord record;
+        while (reader.next(record)) {
+            if (sort) {
+                records.push_back(record);
+            } else {
+                print(record, timestamp, line);
+            }
+        }
+
+        std::stable_sort(records.begin(), records.end(),
+                         [](const BinaryLogRecord& a, const BinaryLogRecord& b) { return a.time < b.time; });
+        for (const BinaryLogRecord& sorted : records) {
+            print(sorted, timestamp, line);
+        }
+
+        if (!reader.error().empty()) {
+            std::cerr << "utoolkit_log_decode: " << file << ": " << reader.error() << std::endl;
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,63 @@
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "utoolkit/task_queue/simulated_task_queue.h"
+#include "utoolkit/task_queue/task_queue.h"
+
+#ifdef HAVE_BENCHMARK
+#include <benchmark/benchmark.h>
+#endif
+
+#ifdef HAVE_BENCHMARK
+
+// 基准：虚拟时钟下的调度开销，结果不受真实计时器精度影响
+// 每次迭代：state.range(0) 个定时器，各以不同周期运行一小时虚拟时间
+static void BM_SimulatedTimers(benchmark::State& state) {
+    const int timers = static_cast<int>(state.range(0));
+    int64_t fired = 0;
+    for (auto _ : state) {
+        vi::SimulatedTimeController clock;
+        auto queue = vi::TaskQueue::create("timers", &clock);
+        std::vector<std::function<void()>> ticks(timers);
+        for (int i = 0; i < timers; ++i) {
+            const uint32_t period = 100 + i * 10;
+            std::function<void()>* tick = &ticks[i];
+            *tick = [&queue, &fired, tick, period]() {
+                ++fired;
+                queue->postDelayedTask(*tick, period);
+            };
+            queue->postDelayedTask(*tick, period);
+        }
+        clock.advanceTime(60 * 60 * 1000);
+        queue.reset();
+    }
+    state.counters["tasks/s"] = benchmark::Counter(static_cast<double>(fired), benchmark::Counter::kIsRate);
+}
+
+// 基准：不带延时的投递与执行
+static void BM_SimulatedPostRun(benchmark::State& state) {
+    vi::SimulatedTimeController clock;
+    auto queue = vi::TaskQueue::create("post", &clock);
+    const int batch = static_cast<int>(state.range(0));
+    int64_t runs = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < batch; ++i) {
+            queue->postTask([&runs]() { ++runs; });
+        }
+        clock.runReady();
+    }
+    benchmark::DoNotOptimize(runs);
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+
+BENCHMARK(BM_SimulatedTimers)->Arg(1)->Arg(16)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SimulatedPostRun)->Arg(1)->Arg(64)->Arg(1024);
+
+BENCHMARK_MAIN();
+#else
+int main() {
+    std::cout << "Google Benchmark library not available" << std::endl;
+    return 0;
+}
+#endif
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "utoolkit/task_queue/task_queue.h"
+#include "utoolkit/task_queue/task_queue_manager.h"
+
+#ifdef HAVE_BENCHMARK
+#include <benchmark/benchmark.h>
+#endif
+
+#ifdef HAVE_BENCHMARK
+namespace {
+
+void setupQueues() {
+    static std::once_flag ocf;
+    std::call_once(ocf, [](){
+        TQMgr->create({"worker", "network", "render", "audio", "video", "io"});
+    });
+}
+
+// 旧实现的参照：加锁 + std::string 构造 + 两次查找
+std::mutex g_mutex;
+std::unordered_map<std::string, vi::TaskQueue*> g_map;
+
+vi::TaskQueue* lockedLookup(const std::string& name) {
+    std::unique_lock<std::mutex> lock(g_mutex);
+    return g_map.find(name) != g_map.end() ? g_map[name] : nullptr;
+}
+
+}
+
+// 基准：加锁查找（旧实现参照）
+static void BM_LockedLookup(benchmark::State& state) {
+    setupQueues();
+    if (state.thread_index() == 0) {
+        std::unique_lock<std::mutex> lock(g_mutex);
+        g_map["worker"] = TQ("worker");
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lockedLookup("worker"));
+    }
+}
+
+// 基准：TQ(name) 无锁快照查找
+static void BM_TQByName(benchmark::State& state) {
+    setupQueues();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(TQ("worker"));
+    }
+}
+
+// 基准：缓存的整型句柄查找
+static void BM_TQById(benchmark::State& state) {
+    setupQueues();
+    const auto id = TQMgr->queueId("worker");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(TQ(id));
+    }
+}
+
+BENCHMARK(BM_LockedLookup)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_TQByName)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_TQById)->ThreadRange(1, 8)->UseRealTime();
+
+BENCHMARK_MAIN();
+#else
+int main() {
+    std::cout << "Google Benchmark library not available" << std::endl;
+    return 0;
+}
+#endif
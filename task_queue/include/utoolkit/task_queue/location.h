@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+
+namespace vi {
+
+#if defined(__GNUC__) || defined(__clang__) || (defined(_MSC_VER) && _MSC_VER >= 1926)
+#define VI_HAS_BUILTIN_LOCATION 1
+#else
+#define VI_HAS_BUILTIN_LOCATION 0
+#endif
+
+// Location records the source position a task was posted from, so that a slow
+// or stuck task can be traced back to its origin.
+//
+// All strings must have static storage duration (string literals), so that a
+// Location can be copied and stored freely without owning any memory.
+class Location {
+public:
+    constexpr Location() = default;
+
+    constexpr Location(const char* function, const char* file, int line)
+        : function_(function), file_(file), line_(line) {}
+
+    // Captures the location of the caller when used as a default argument.
+#if VI_HAS_BUILTIN_LOCATION
+    static constexpr Location current(const char* function = __builtin_FUNCTION(),
+                                      const char* file = __builtin_FILE(),
+                                      int line = __builtin_LINE()) {
+        return Location(function, file, line);
+    }
+#else
+    static constexpr Location current() { return Location(); }
+#endif
+
+    const char* function() const { return function_ ? function_ : "unknown"; }
+    const char* file() const { return file_ ? file_ : "unknown"; }
+    int line() const { return line_; }
+
+    bool isValid() const { return file_ != nullptr; }
+
+    // Returns "function@file:line".
+    std::string toString() const;
+
+private:
+    const char* function_ = nullptr;
+    const char* file_ = nullptr;
+    int line_ = 0;
+};
+
+}
+
+// Define a macro to record the current source location.
+#define VI_FROM_HERE vi::Location(__FUNCTION__, __FILE__, __LINE__)
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <array>
+#include <map>
+#include <memory>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include "location.h"
+#include "pending_task_safety_flag.h"
+#include "queued_task.h"
+#include "task_queue_base.h"
+
+namespace vi {
+
+// Bookkeeping of the tasks of one task queue that were posted but have not
+// started yet: a FIFO lane per priority, the delayed tasks ordered by due time,
+// the coalescing index and the references to safety flags.
+//
+// It decides which task runs next and is shared by the TaskQueueBase
+// implementations so that they all follow the same ordering rules. It is not
+// thread safe: the owner serializes all calls with the lock that also guards
+// the reference counts of the safety flags bound to it.
+class PendingTaskQueue {
+public:
+    using Priority = TaskQueueBase::Priority;
+
+    struct Task {
+        std::unique_ptr<QueuedTask> task_;
+        Location location_;
+        // When the task became runnable, see TaskQueueMetrics::nowUs().
+        int64_t ready_at_us_{};
+        // Flow id linking post and run in the trace, 0 when not traced.
+        uint64_t trace_id_{};
+        // Optional; a reference is taken when the task is pushed.
+        PendingTaskSafetyFlag* safety_{};
+    };
+
+    struct NextTask {
+        std::unique_ptr<QueuedTask> run_task_;
+        Location location_;
+        int64_t ready_at_us_{};
+        uint64_t trace_id_{};
+        // The task's safety flag was cleared; drop it without running.
+        bool discard_{false};
+        // Set when no task is runnable but a delayed one is pending: the time
+        // until it is due. 0 otherwise.
+        int64_t sleep_time_ms_{};
+    };
+
+    PendingTaskQueue() = default;
+    ~PendingTaskQueue();
+
+    void push(Task task, Priority priority);
+
+    void pushDelayed(Task task, int64_t fire_at_ms);
+
+    // Replaces the work of the pending task pushed with the same |key| and
+    // returns the replaced work, or pushes |task| at kNormal and returns null.
+    std::unique_ptr<QueuedTask> pushCoalesced(uint64_t key, Task task);
+
+    // Takes the next task to run at |now_ms|:
+    //   1. kHigh tasks,
+    //   2. kNormal tasks and due delayed tasks, in posting order,
+    //   3. kLow tasks,
+    //   4. kIdle tasks, only if no delayed task is due.
+    NextTask next(int64_t now_ms);
+
+    // Due time of the earliest delayed task, or -1 if there is none.
+    int64_t nextDelayedAt() const;
+
+    bool empty() const;
+
+    // Clears |flag|, moves the delayed tasks posted with it to |dropped| and
+    // releases the reference of the flag's owner.
+    void releaseSafetyFlag(PendingTaskSafetyFlag* flag,
+                           std::vector<std::unique_ptr<QueuedTask>>& dropped);
+
+private:
+    using OrderId = uint64_t;
+
+    struct Entry {
+        OrderId order_{};
+        Task task_;
+        // Set for tasks pushed with pushCoalesced().
+        bool coalescable_{false};
+        uint64_t coalesce_key_{};
+    };
+
+    struct DelayedEntryTimeout {
+        int64_t next_fire_at_ms_{};
+        OrderId order_{};
+
+        bool operator<(const DelayedEntryTimeout& o) const {
+            return std::tie(next_fire_at_ms_, order_) < std::tie(o.next_fire_at_ms_, o.order_);
+        }
+    };
+
+    void take(Entry& entry, NextTask& result);
+
+    static void retainSafetyFlag(PendingTaskSafetyFlag* flag) { ++flag->refs_; }
+    static void releaseSafetyFlagRef(PendingTaskSafetyFlag* flag);
+
+private:
+    PendingTaskQueue(const PendingTaskQueue&) = delete;
+    PendingTaskQueue& operator=(const PendingTaskQueue&) = delete;
+
+private:
+    // Holds the next order to use for the next task to be
+    // put into one of the pending queues.
+    OrderId posting_order_ {};
+
+    // The lists of all pending tasks that need to be processed in the
+    // FIFO queue ordering on the worker thread, one per Priority. A lane is
+    // only served once all lanes of higher priority are empty.
+    std::array<std::queue<Entry>, TaskQueueBase::kPriorityCount> pending_queues_;
+
+    // The list of all pending tasks that need to be processed at a future
+    // time based upon a delay. On the off change the delayed task should
+    // happen at exactly the same time interval as another task then the
+    // task is processed based on FIFO ordering. std::priority_queue was
+    // considered but rejected due to its inability to extract the
+    // std::unique_ptr out of the queue without the presence of a hack.
+    std::map<DelayedEntryTimeout, Entry> delayed_queue_;
+
+    // Pending coalescable tasks by key. std::queue is backed by std::deque,
+    // which keeps element addresses stable on push and pop, so the entries
+    // can be pointed to until they are taken.
+    std::unordered_map<uint64_t, Entry*> coalescing_index_;
+};
+
+}
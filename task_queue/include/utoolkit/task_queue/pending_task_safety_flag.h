@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace vi {
+
+class TaskQueueBase;
+class PendingTaskQueue;
+class ScopedTaskSafety;
+
+// Liveness flag shared by an object and the tasks it posted to one task queue.
+// Tasks posted with a flag are dropped, without running, when the queue
+// dequeues them after the flag was cleared.
+//
+// A flag is bound to the queue it was created for. Its reference count is
+// only touched by that queue's PendingTaskQueue, under the task lock which
+// posting and dequeueing hold anyway, so a post costs no atomic read-modify-write and a dequeue costs
+// a single atomic load.
+class PendingTaskSafetyFlag {
+public:
+    bool alive() const { return alive_.load(std::memory_order_acquire); }
+
+    TaskQueueBase* queue() const { return queue_; }
+
+private:
+    friend class PendingTaskQueue;
+    friend class ScopedTaskSafety;
+
+    explicit PendingTaskSafetyFlag(TaskQueueBase* queue) : queue_(queue) {}
+
+    PendingTaskSafetyFlag(const PendingTaskSafetyFlag&) = delete;
+    PendingTaskSafetyFlag& operator=(const PendingTaskSafetyFlag&) = delete;
+
+    TaskQueueBase* const queue_;
+
+    std::atomic<bool> alive_ {true};
+
+    // One reference held by the ScopedTaskSafety plus one per pending task.
+    // Guarded by the task lock of |queue_|.
+    uint32_t refs_ {1};
+};
+
+// Owns a PendingTaskSafetyFlag for an object that posts tasks to |queue|.
+// Declare it as the last member, so it is destroyed first:
+//
+//     class MyClass {
+//       ...
+//       void startWork() { queue_->postTask([this]{ work(); }, safety_); }
+//       ...
+//       vi::ScopedTaskSafety safety_{queue_->get()};
+//     };
+//
+// Destruction and reset() must happen on |queue| (or while no task posted with
+// the flag can be running), and before |queue| is destroyed. Pending tasks are
+// then never run afterwards; delayed ones are freed immediately.
+class ScopedTaskSafety {
+public:
+    explicit ScopedTaskSafety(TaskQueueBase* queue);
+    ~ScopedTaskSafety();
+
+    PendingTaskSafetyFlag* flag() const { return flag_; }
+
+    // Drops all tasks posted so far and starts over with a fresh flag.
+    void reset();
+
+private:
+    ScopedTaskSafety(const ScopedTaskSafety&) = delete;
+    ScopedTaskSafety& operator=(const ScopedTaskSafety&) = delete;
+
+    void release();
+
+private:
+    PendingTaskSafetyFlag* flag_;
+};
+
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "location.h"
+#include "pending_task_queue.h"
+#include "queued_task.h"
+#include "task_queue_base.h"
+#include "task_queue_factory.h"
+
+namespace vi {
+
+class SimulatedTimeController;
+
+// TaskQueueBase without a thread of its own. Its tasks run when the owning
+// SimulatedTimeController runs them, delayed ones once the virtual clock
+// reached their due time. Ordering follows TaskQueueSTD: priorities, FIFO
+// within a priority, delayed tasks interleaved with kNormal ones by posting
+// order and kIdle tasks only while no delayed task is due.
+//
+// Tasks may be posted from any thread. Create queues through the controller.
+class SimulatedTaskQueue final : public TaskQueueBase {
+public:
+    void deleteThis() override;
+
+    void postTask(std::unique_ptr<QueuedTask> task,
+                  const Location& location = Location::current()) override;
+
+    void postTask(std::unique_ptr<QueuedTask> task, Priority priority,
+                  const Location& location = Location::current()) override;
+
+    void postTask(std::unique_ptr<QueuedTask> task, PendingTaskSafetyFlag* safety,
+                  const Location& location = Location::current()) override;
+
+    void postCoalesced(uint64_t key, std::unique_ptr<QueuedTask> task,
+                       const Location& location = Location::current()) override;
+
+    void postDelayedTask(std::unique_ptr<QueuedTask> task, uint32_t milliseconds,
+                         const Location& location = Location::current()) override;
+
+    void postDelayedTask(std::unique_ptr<QueuedTask> task, uint32_t milliseconds,
+                         PendingTaskSafetyFlag* safety,
+                         const Location& location = Location::current()) override;
+
+    void releaseSafetyFlag(PendingTaskSafetyFlag* flag) override;
+
+    const std::string& name() const override;
+
+private:
+    friend class SimulatedTimeController;
+
+    SimulatedTaskQueue(SimulatedTimeController* controller, std::string_view name);
+    ~SimulatedTaskQueue() override;
+
+    void push(std::unique_ptr<QueuedTask> task, Priority priority,
+              PendingTaskSafetyFlag* safety, const Location& location);
+
+    // Runs or discards the next task runnable at |nowMs|. Returns false if
+    // there was none.
+    bool runNext(int64_t nowMs);
+
+    // Due time of the earliest delayed task, or -1.
+    int64_t nextDelayedAt();
+
+private:
+    SimulatedTimeController* const controller_;
+
+    std::mutex pending_mutex_;
+
+    PendingTaskQueue pending_;
+
+    std::string name_;
+};
+
+// Virtual clock driving SimulatedTaskQueues. Nothing runs on its own: the
+// tasks of all queues created by the controller run on the thread calling
+// runReady(), advanceTime() or runUntilIdle(), one task per queue in turn, and
+// delayed tasks become due when the virtual clock reaches their time. Hours of
+// timers then take as long as the work they do, in a reproducible order.
+//
+//     vi::SimulatedTimeController clock;
+//     vi::TaskQueue::setFactory(&clock);
+//     auto queue = vi::TaskQueue::create("timer");
+//     queue->postDelayedTask([]{ ... }, 60 * 1000);
+//     clock.advanceTime(60 * 1000);    // runs the task
+//     vi::TaskQueue::setFactory(nullptr);
+//
+// The controller must outlive its queues. Queues must only be deleted on the
+// driving thread, from outside a task or from a task of another queue.
+class SimulatedTimeController : public TaskQueueFactory {
+public:
+    static constexpr int64_t kDefaultIdleLimitMs = 24 * 60 * 60 * 1000LL;
+
+    explicit SimulatedTimeController(int64_t startMs = 0);
+    ~SimulatedTimeController() override;
+
+    std::unique_ptr<TaskQueueBase, TaskQueueDeleter> createTaskQueue(std::string_view name) override;
+
+    // Virtual time in milliseconds.
+    int64_t now() const { return now_ms_.load(std::memory_order_acquire); }
+
+    // Runs every task that is runnable now, including the ones they post,
+    // without moving the clock. A task reposting itself without delay keeps
+    // this from returning.
+    void runReady();
+
+    // Moves the clock forward by |ms|. Delayed tasks due on the way run at
+    // their due time, in due time order.
+    void advanceTime(int64_t ms);
+
+    // Runs tasks, jumping the clock from one due time to the next, until no
+    // task is left. Stops after |limitMs| of virtual time, which periodic
+    // timers would otherwise never allow. Returns true if it went idle.
+    bool runUntilIdle(int64_t limitMs = kDefaultIdleLimitMs);
+
+private:
+    friend class SimulatedTaskQueue;
+
+    void unregisterQueue(SimulatedTaskQueue* queue);
+
+    // Runs tasks up to |targetMs|; returns true if nothing is left.
+    bool runUntil(int64_t targetMs);
+
+    int64_t nextDelayedAt();
+
+private:
+    SimulatedTimeController(const SimulatedTimeController&) = delete;
+    SimulatedTimeController& operator=(const SimulatedTimeController&) = delete;
+
+private:
+    std::atomic<int64_t> now_ms_;
+
+    std::mutex mutex_;
+
+    // Queues in creation order, which is the order they take turns in.
+    std::vector<SimulatedTaskQueue*> queues_;
+
+    // Set while running tasks, to catch a task driving the clock.
+    bool running_ {false};
+};
+
+}
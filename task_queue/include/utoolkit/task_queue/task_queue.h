@@ -4,7 +4,11 @@
 
 #include <memory>
 #include <string_view>
+#include "location.h"
+#include "pending_task_safety_flag.h"
 #include "queued_task.h"
+#include "task_queue_base.h"
+#include "task_queue_factory.h"
 
 
 namespace vi {
@@ -51,9 +55,6 @@ namespace vi {
 // A note on destruction:
 //
 
-class TaskQueueBase;
-class TaskQueueDeleter;
-
 // When a TaskQueue is deleted, pending tasks will not be executed but they will
 // be deleted.  The deletion of tasks may happen asynchronously after the
 // TaskQueue itself has been deleted or it may happen synchronously while the
@@ -61,42 +62,96 @@ class TaskQueueDeleter;
 // so assumptions about lifetimes of pending tasks should not be made.
 class TaskQueue {
 public:
+    using Priority = TaskQueueBase::Priority;
+
     explicit TaskQueue(std::unique_ptr<TaskQueueBase, TaskQueueDeleter> taskQueue);
     ~TaskQueue();
 
+    // Creates a queue with the factory installed by setFactory(), or a
+    // TaskQueueSTD if there is none.
     static std::unique_ptr<TaskQueue> create(std::string_view name);
 
+    static std::unique_ptr<TaskQueue> create(std::string_view name, TaskQueueFactory* factory);
+
+    // Installs the factory used by create(), which includes the queues of
+    // TaskQueueManager; nullptr restores the default. |factory| is not owned
+    // and must stay valid while installed.
+    static void setFactory(TaskQueueFactory* factory);
+
     // Used for DCHECKing the current queue.
     bool isCurrent() const;
 
     // Returns non-owning pointer to the task queue implementation.
     TaskQueueBase* get() { return impl_; }
 
-    // TODO(tommi): For better debuggability, implement RTC_FROM_HERE.
+    // The posting site is captured implicitly through |location|; pass
+    // VI_FROM_HERE explicitly when forwarding a task on behalf of a caller.
 
     // Ownership of the task is passed to PostTask.
-    void postTask(std::unique_ptr<QueuedTask> task);
+    void postTask(std::unique_ptr<QueuedTask> task, const Location& location = Location::current());
+
+    // Ownership of the task is passed to PostTask. Tasks of higher |priority|
+    // run first, FIFO order is kept within a priority.
+    void postTask(std::unique_ptr<QueuedTask> task, Priority priority,
+                  const Location& location = Location::current());
+
+    // The task is dropped without running if |safety| is destroyed or reset
+    // before the task is dequeued. |safety| must be bound to this queue.
+    void postTask(std::unique_ptr<QueuedTask> task, const ScopedTaskSafety& safety,
+                  const Location& location = Location::current());
+
+    // Replaces a still pending task posted with the same |key| instead of
+    // enqueueing another one; see TaskQueueBase::postCoalesced().
+    void postCoalesced(uint64_t key, std::unique_ptr<QueuedTask> task,
+                       const Location& location = Location::current());
 
     // Schedules a task to execute a specified number of milliseconds from when
     // the call is made. The precision should be considered as "best effort"
     // and in some cases, such as on Windows when all high precision timers have
     // been used up, can be off by as much as 15 millseconds (although 8 would be
     // more likely). This can be mitigated by limiting the use of delayed tasks.
-    void postDelayedTask(std::unique_ptr<QueuedTask> task, uint32_t milliseconds);
+    void postDelayedTask(std::unique_ptr<QueuedTask> task, uint32_t milliseconds,
+                         const Location& location = Location::current());
+
+    void postDelayedTask(std::unique_ptr<QueuedTask> task, uint32_t milliseconds,
+                         const ScopedTaskSafety& safety,
+                         const Location& location = Location::current());
 
 
     // std::enable_if is used here to make sure that calls to PostTask() with
     // std::unique_ptr<SomeClassDerivedFromQueuedTask> would not end up being
     // caught by this template.
     template <class Closure, typename std::enable_if<!std::is_convertible<Closure, std::unique_ptr<QueuedTask>>::value>::type* = nullptr>
-    void postTask(Closure&& closure) {
-        postTask(ToQueuedTask(std::forward<Closure>(closure)));
+    void postTask(Closure&& closure, const Location& location = Location::current()) {
+        postTask(ToQueuedTask(std::forward<Closure>(closure)), location);
+    }
+
+    template <class Closure, typename std::enable_if<!std::is_convertible<Closure, std::unique_ptr<QueuedTask>>::value>::type* = nullptr>
+    void postTask(Closure&& closure, Priority priority, const Location& location = Location::current()) {
+        postTask(ToQueuedTask(std::forward<Closure>(closure)), priority, location);
+    }
+
+    template <class Closure, typename std::enable_if<!std::is_convertible<Closure, std::unique_ptr<QueuedTask>>::value>::type* = nullptr>
+    void postTask(Closure&& closure, const ScopedTaskSafety& safety, const Location& location = Location::current()) {
+        postTask(ToQueuedTask(std::forward<Closure>(closure)), safety, location);
+    }
+
+    template <class Closure, typename std::enable_if<!std::is_convertible<Closure, std::unique_ptr<QueuedTask>>::value>::type* = nullptr>
+    void postCoalesced(uint64_t key, Closure&& closure, const Location& location = Location::current()) {
+        postCoalesced(key, ToQueuedTask(std::forward<Closure>(closure)), location);
     }
 
     // See documentation above for performance expectations.
     template <class Closure, typename std::enable_if<!std::is_convertible<Closure, std::unique_ptr<QueuedTask>>::value>::type* = nullptr>
-    void postDelayedTask(Closure&& closure, uint32_t milliseconds) {
-        postDelayedTask(ToQueuedTask(std::forward<Closure>(closure)),  milliseconds);
+    void postDelayedTask(Closure&& closure, uint32_t milliseconds,
+                         const Location& location = Location::current()) {
+        postDelayedTask(ToQueuedTask(std::forward<Closure>(closure)),  milliseconds, location);
+    }
+
+    template <class Closure, typename std::enable_if<!std::is_convertible<Closure, std::unique_ptr<QueuedTask>>::value>::type* = nullptr>
+    void postDelayedTask(Closure&& closure, uint32_t milliseconds, const ScopedTaskSafety& safety,
+                         const Location& location = Location::current()) {
+        postDelayedTask(ToQueuedTask(std::forward<Closure>(closure)), milliseconds, safety, location);
     }
 
 
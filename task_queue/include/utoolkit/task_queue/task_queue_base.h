@@ -2,7 +2,10 @@
 
 #include <memory>
 #include <string>
+#include "location.h"
+#include "pending_task_safety_flag.h"
 #include "queued_task.h"
+#include "task_queue_stats.h"
 
 namespace vi {
 
@@ -12,6 +15,19 @@ namespace vi {
 // known task queue, use IsCurrent().
 class TaskQueueBase {
 public:
+    // Relative urgency of a posted task. Tasks of the same priority run in
+    // FIFO order and a task never waits behind one of lower priority. Delayed
+    // tasks run at kNormal once due. kIdle tasks run only when nothing else is
+    // runnable, i.e. no task is pending and no delayed task is due.
+    enum class Priority {
+        kHigh = 0,
+        kNormal = 1,
+        kLow = 2,
+        kIdle = 3,
+    };
+
+    static constexpr int kPriorityCount = 4;
+
     // Starts destruction of the task queue.
     // On return ensures no task are running and no new tasks are able to start
     // on the task queue.
@@ -31,13 +47,50 @@ public:
     // TaskQueue or it may happen asynchronously after TaskQueue is deleted.
     // This may vary from one implementation to the next so assumptions about
     // lifetimes of pending tasks should not be made.
-    virtual void postTask(std::unique_ptr<QueuedTask> task) = 0;
+    // |location| records the posting site for diagnostics.
+    virtual void postTask(std::unique_ptr<QueuedTask> task,
+                          const Location& location = Location::current()) = 0;
+
+    // Schedules a task at the given priority. Implementations without
+    // priority support run it like postTask().
+    virtual void postTask(std::unique_ptr<QueuedTask> task, Priority priority,
+                          const Location& location = Location::current()) {
+        (void)priority;
+        postTask(std::move(task), location);
+    }
+
+    // Schedules a task like postTask() unless a task posted with the same |key|
+    // is still pending. In that case the pending task is replaced by |task|,
+    // which then runs at the position of the one it replaced. Use a key per
+    // kind of idempotent work, e.g. an enum value or an object address.
+    // Implementations without coalescing support run it like postTask().
+    virtual void postCoalesced(uint64_t key, std::unique_ptr<QueuedTask> task,
+                               const Location& location = Location::current()) {
+        (void)key;
+        postTask(std::move(task), location);
+    }
 
     // Schedules a task to execute a specified number of milliseconds from when
     // the call is made. The precision should be considered as "best effort"
     // and in some cases, such as on Windows when all high precision timers have
     // been used up, can be off by as much as 15 millseconds.
-    virtual void postDelayedTask(std::unique_ptr<QueuedTask> task, uint32_t milliseconds) = 0;
+    virtual void postDelayedTask(std::unique_ptr<QueuedTask> task, uint32_t milliseconds,
+                                 const Location& location = Location::current()) = 0;
+
+    // Like postTask() and postDelayedTask(), but the task is dropped instead of
+    // run if |safety| is no longer alive when the task is dequeued. |safety|
+    // must be bound to this queue.
+    virtual void postTask(std::unique_ptr<QueuedTask> task, PendingTaskSafetyFlag* safety,
+                          const Location& location = Location::current()) = 0;
+
+    virtual void postDelayedTask(std::unique_ptr<QueuedTask> task, uint32_t milliseconds,
+                                 PendingTaskSafetyFlag* safety,
+                                 const Location& location = Location::current()) = 0;
+
+    // Clears |flag|, frees what can be freed of the tasks posted with it and
+    // drops the reference held by its ScopedTaskSafety. Used by
+    // ScopedTaskSafety; |flag| must be bound to this queue.
+    virtual void releaseSafetyFlag(PendingTaskSafetyFlag* flag) = 0;
 
     // Returns the task queue that is running the current thread.
     // Returns nullptr if this thread is not associated with any task queue.
@@ -46,6 +99,15 @@ public:
 
     virtual const std::string& name() const = 0;
 
+    // Returns a snapshot of the runtime counters of this queue. Safe to call
+    // from any thread. Implementations without instrumentation only fill in
+    // the name.
+    virtual TaskQueueStats stats() const {
+        TaskQueueStats result;
+        result.name = name();
+        return result;
+    }
+
 protected:
     class CurrentTaskQueueSetter {
     public:
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+#include "task_queue_base.h"
+
+namespace vi {
+
+// Creates the TaskQueueBase implementations behind TaskQueue::create(). The
+// default creates a TaskQueueSTD; install another one with
+// TaskQueue::setFactory(), e.g. a SimulatedTimeController in tests.
+class TaskQueueFactory {
+public:
+    virtual ~TaskQueueFactory() = default;
+
+    virtual std::unique_ptr<TaskQueueBase, TaskQueueDeleter> createTaskQueue(std::string_view name) = 0;
+};
+
+}
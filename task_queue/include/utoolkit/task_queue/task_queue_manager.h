@@ -1,31 +1,87 @@
 #pragma once
 
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
 #include <mutex>
+#include "event.h"
+#include "task_queue_stats.h"
 
 namespace vi {
 
 class TaskQueue;
 
+// Owns the named task queues of the process.
+//
+// Queues are only ever added (until the manager is destroyed), so lookups are
+// served from an immutable snapshot that is republished on every create().
+// Readers take no lock: they perform a single acquire load of the current
+// snapshot and search it. Superseded snapshots are retired, not freed, because
+// a reader may still be walking one; they are released with the manager. Their
+// number is bounded by the number of create() calls, which happen at startup.
+//
+// Hot paths can resolve a name once with queueId() and then use the integer
+// handle, which is stable for the lifetime of the manager:
+//
+//     static const auto workerId = TQMgr->queueId("worker");
+//     TQMgr->queue(workerId)->postTask(...);
+//
+// stats() returns the runtime counters of all queues and is meant to be dumped
+// periodically. startWatchdog() additionally reports tasks that have been
+// running for too long while they are still running, with their posting site.
 class TaskQueueManager {
 public:
+    using QueueId = uint32_t;
+
+    // Called on the watchdog thread with the stats of the stalled queue.
+    using SlowTaskHandler = std::function<void(const TaskQueueStats&)>;
+
+    static constexpr QueueId kInvalidQueueId = UINT32_MAX;
+
     static std::unique_ptr<TaskQueueManager>& instance();
 
     ~TaskQueueManager();
 
     void create(const std::vector<std::string>& nameList);
 
-    TaskQueue* queue(const std::string& name);
+    TaskQueue* queue(std::string_view name) const;
+
+    TaskQueue* queue(QueueId id) const;
+
+    // Returns kInvalidQueueId if no queue named |name| exists.
+    QueueId queueId(std::string_view name) const;
+
+    bool hasQueue(std::string_view name) const;
+
+    // Snapshot of all queues in creation order.
+    std::vector<TaskQueueStats> stats() const;
 
-    bool hasQueue(const std::string& name);
+    // Sets the slow task threshold (see TaskQueueMetrics) and starts a thread
+    // that reports every task running longer than |slowTaskMs| once, through
+    // |handler| or to stderr if no handler is given.
+    void startWatchdog(uint32_t slowTaskMs, SlowTaskHandler handler = nullptr);
+
+    void stopWatchdog();
 
 private:
+    // Immutable once published. Keys view the names owned by the queues.
+    struct Snapshot {
+        std::vector<TaskQueue*> queues;
+        std::unordered_map<std::string_view, QueueId> ids;
+    };
+
     void clear();
 
-    bool exist(const std::string& name);
+    const Snapshot* snapshot() const;
+
+    void watchdogLoop(uint32_t slowTaskMs, SlowTaskHandler handler);
 
 private:
     TaskQueueManager();
@@ -37,9 +93,21 @@ private:
     TaskQueueManager& operator=(const TaskQueueManager&) = delete;
 
 private:
+    // Serializes writers only.
     std::mutex m_mutex;
 
-    std::unordered_map<std::string, std::unique_ptr<TaskQueue>> m_queueMap;
+    // Indexed by QueueId.
+    std::vector<std::unique_ptr<TaskQueue>> m_queues;
+
+    std::atomic<const Snapshot*> m_snapshot {nullptr};
+
+    std::vector<std::unique_ptr<const Snapshot>> m_snapshots;
+
+    std::mutex m_watchdogMutex;
+
+    std::thread m_watchdog;
+
+    vi::Event m_watchdogStop;
 
 };
 
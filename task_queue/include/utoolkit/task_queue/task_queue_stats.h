@@ -0,0 +1,157 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <array>
+#include <atomic>
+#include <string>
+#include "location.h"
+
+// Runtime instrumentation of task queues. Enabled by default; build with
+// UT_TASK_QUEUE_STATS=0 (CMake option UTOOLKIT_TASK_QUEUE_STATS=OFF) to compile
+// all of it out, in which case snapshots only carry the queue name.
+#ifndef UT_TASK_QUEUE_STATS
+#define UT_TASK_QUEUE_STATS 1
+#endif
+
+namespace vi {
+
+// Point-in-time copy of a Histogram.
+struct HistogramSnapshot {
+    static constexpr int kBucketCount = 32;
+
+    uint64_t count {0};
+    uint64_t sum {0};
+    uint64_t max {0};
+
+    // Bucket 0 counts zero values, bucket i counts values in [2^(i-1), 2^i).
+    // The last bucket also counts everything above its lower bound.
+    std::array<uint64_t, kBucketCount> buckets {};
+
+    double mean() const { return count ? static_cast<double>(sum) / count : 0.0; }
+
+    // Returns the upper bound of the bucket holding the |p|-th percentile,
+    // |p| in [0, 100].
+    uint64_t percentile(double p) const;
+
+    static uint64_t bucketUpperBound(int index);
+};
+
+// Log2-bucketed histogram. record() is wait-free and may be called from any
+// thread; snapshots taken concurrently are not atomic as a whole.
+class Histogram {
+public:
+    void record(uint64_t value);
+
+    HistogramSnapshot snapshot() const;
+
+    static int bucketIndex(uint64_t value);
+
+private:
+    std::array<std::atomic<uint64_t>, HistogramSnapshot::kBucketCount> buckets_ {};
+    std::atomic<uint64_t> sum_ {0};
+    std::atomic<uint64_t> max_ {0};
+};
+
+// Snapshot of the runtime state of one task queue. Times are in microseconds.
+struct TaskQueueStats {
+    std::string name;
+
+    // All tasks ever posted, including delayed ones.
+    uint64_t posted_tasks {0};
+    // The subset of posted_tasks that was posted with a delay.
+    uint64_t delayed_tasks {0};
+    uint64_t executed_tasks {0};
+    // Tasks dropped without running because their safety flag was cleared.
+    uint64_t discarded_tasks {0};
+    // Tasks posted but neither executed nor discarded yet.
+    uint64_t pending_tasks {0};
+    // Posts that replaced a pending task instead of adding one; not part of
+    // posted_tasks.
+    uint64_t coalesced_tasks {0};
+
+    // Time from the moment a task became runnable (posted, or its delay
+    // expired) until it started running.
+    HistogramSnapshot queue_latency_us;
+    HistogramSnapshot run_time_us;
+
+    // Tasks that ran for at least the slow task threshold.
+    uint64_t slow_tasks {0};
+    Location last_slow_task;
+    uint64_t last_slow_task_us {0};
+
+    // The task running when the snapshot was taken; running_task_id is 0 when
+    // the queue is idle.
+    uint64_t running_task_id {0};
+    Location running_task;
+    uint64_t running_for_us {0};
+
+    // Returns a one line human readable summary.
+    std::string toString() const;
+};
+
+// Live counters of one task queue implementation. Posting side methods may be
+// called from any thread, the task side methods only from the queue's worker.
+class TaskQueueMetrics {
+public:
+    // Monotonic clock used for all measurements; 0 when stats are disabled.
+    static int64_t nowUs();
+
+    // Tasks running for at least |ms| milliseconds are counted as slow. 0
+    // disables slow task detection. Applies to all queues of the process.
+    static void setSlowTaskThreshold(uint32_t ms);
+    static uint32_t slowTaskThreshold();
+
+#if UT_TASK_QUEUE_STATS
+    void onPosted(bool delayed);
+    void onCoalesced();
+    void onDiscarded(uint64_t count);
+
+    // |readyAtUs| is when the task became runnable.
+    void onTaskStart(const Location& from, int64_t readyAtUs, int64_t startUs);
+    void onTaskFinish(const Location& from, int64_t startUs);
+
+    TaskQueueStats snapshot(const std::string& name) const;
+
+private:
+    void readRunning(TaskQueueStats& stats) const;
+
+private:
+    std::atomic<uint64_t> posted_ {0};
+    std::atomic<uint64_t> delayed_ {0};
+    std::atomic<uint64_t> executed_ {0};
+    std::atomic<uint64_t> coalesced_ {0};
+    std::atomic<uint64_t> discarded_ {0};
+    std::atomic<uint64_t> slow_ {0};
+
+    Histogram queue_latency_;
+    Histogram run_time_;
+
+    // Running and last slow task, written by the worker thread only and
+    // published through a sequence lock so that readers never block it.
+    std::atomic<uint64_t> seq_ {0};
+    std::atomic<uint64_t> running_id_ {0};
+    std::atomic<int64_t> running_since_us_ {0};
+    std::atomic<const char*> running_function_ {nullptr};
+    std::atomic<const char*> running_file_ {nullptr};
+    std::atomic<int> running_line_ {0};
+    std::atomic<const char*> slow_function_ {nullptr};
+    std::atomic<const char*> slow_file_ {nullptr};
+    std::atomic<int> slow_line_ {0};
+    std::atomic<uint64_t> slow_us_ {0};
+#else
+    void onPosted(bool) {}
+    void onCoalesced() {}
+    void onDiscarded(uint64_t) {}
+    void onTaskStart(const Location&, int64_t, int64_t) {}
+    void onTaskFinish(const Location&, int64_t) {}
+
+    TaskQueueStats snapshot(const std::string& name) const {
+        TaskQueueStats stats;
+        stats.name = name;
+        return stats;
+    }
+#endif
+};
+
+}
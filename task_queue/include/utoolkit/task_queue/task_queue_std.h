@@ -2,55 +2,72 @@
 
 #include <string.h>
 #include <algorithm>
-#include <map>
 #include <memory>
-#include <queue>
+#include <mutex>
 #include <utility>
 #include <thread>
 #include <string_view>
 #include "queued_task.h"
 #include "event.h"
+#include "location.h"
+#include "pending_task_queue.h"
 #include "task_queue_base.h"
+#include "task_queue_stats.h"
 
 namespace vi {
 
 class TaskQueueSTD final : public TaskQueueBase {
 public:
     TaskQueueSTD(std::string_view queueName);
-    ~TaskQueueSTD() override = default;
+    ~TaskQueueSTD() override;
 
     void deleteThis() override;
 
-    void postTask(std::unique_ptr<QueuedTask> task) override;
+    void postTask(std::unique_ptr<QueuedTask> task,
+                  const Location& location = Location::current()) override;
 
-    void postDelayedTask(std::unique_ptr<QueuedTask> task, uint32_t milliseconds) override;
+    void postTask(std::unique_ptr<QueuedTask> task, Priority priority,
+                  const Location& location = Location::current()) override;
 
-    const std::string& name() const override;
+    void postTask(std::unique_ptr<QueuedTask> task, PendingTaskSafetyFlag* safety,
+                  const Location& location = Location::current()) override;
 
-private:
-    using OrderId = uint64_t;
+    void postCoalesced(uint64_t key, std::unique_ptr<QueuedTask> task,
+                       const Location& location = Location::current()) override;
 
-    struct DelayedEntryTimeout {
-        int64_t next_fire_at_ms_{};
-        OrderId order_{};
+    void postDelayedTask(std::unique_ptr<QueuedTask> task, uint32_t milliseconds,
+                         const Location& location = Location::current()) override;
 
-        bool operator<(const DelayedEntryTimeout& o) const {
-            return std::tie(next_fire_at_ms_, order_) < std::tie(o.next_fire_at_ms_, o.order_);
-        }
-    };
+    void postDelayedTask(std::unique_ptr<QueuedTask> task, uint32_t milliseconds,
+                         PendingTaskSafetyFlag* safety,
+                         const Location& location = Location::current()) override;
+
+    void releaseSafetyFlag(PendingTaskSafetyFlag* flag) override;
+
+    const std::string& name() const override;
+
+    TaskQueueStats stats() const override;
 
+private:
     struct NextTask {
         bool final_task_{false};
-        std::unique_ptr<QueuedTask> run_task_;
-        int64_t sleep_time_ms_{};
+        PendingTaskQueue::NextTask task_;
     };
 
+    void postTaskImpl(std::unique_ptr<QueuedTask> task, Priority priority,
+                      PendingTaskSafetyFlag* safety, const Location& location);
+
+    void postDelayedTaskImpl(std::unique_ptr<QueuedTask> task, uint32_t milliseconds,
+                             PendingTaskSafetyFlag* safety, const Location& location);
+
     NextTask getNextTask();
 
     void processTasks();
 
     void notifyWake();
 
+    static void tracePost(const char* name, const Location& location, uint64_t traceId, int64_t startNs);
+
     static int64_t milliseconds();
 
 private:
@@ -72,24 +89,13 @@ private:
     // Indicates if the worker thread needs to shutdown now.
     bool thread_should_quit_ {false};
 
-    // Holds the next order to use for the next task to be
-    // put into one of the pending queues.
-    OrderId thread_posting_order_ {};
-
-    // The list of all pending tasks that need to be processed in the
-    // FIFO queue ordering on the worker thread.
-    std::queue<std::pair<OrderId, std::unique_ptr<QueuedTask>>> pending_queue_;
-
-    // The list of all pending tasks that need to be processed at a future
-    // time based upon a delay. On the off change the delayed task should
-    // happen at exactly the same time interval as another task then the
-    // task is processed based on FIFO ordering. std::priority_queue was
-    // considered but rejected due to its inability to extract the
-    // std::unique_ptr out of the queue without the presence of a hack.
-    std::map<DelayedEntryTimeout, std::unique_ptr<QueuedTask>> delayed_queue_;
+    // Posted tasks not started yet, guarded by pending_mutex_.
+    PendingTaskQueue pending_;
 
     std::string name_;
 
+    TaskQueueMetrics metrics_;
+
 };
 
 }
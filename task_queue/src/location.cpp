@@ -0,0 +1,9 @@
+#include "utoolkit/task_queue/location.h"
+
+namespace vi {
+
+std::string Location::toString() const {
+    return std::string(function()) + "@" + file() + ":" + std::to_string(line());
+}
+
+}
@@ -0,0 +1,172 @@
+#include "utoolkit/task_queue/pending_task_queue.h"
+
+namespace vi {
+
+PendingTaskQueue::~PendingTaskQueue() {
+    // Tasks that never ran still hold references to their safety flags.
+    for (auto& queue : pending_queues_) {
+        while (!queue.empty()) {
+            if (queue.front().task_.safety_) {
+                releaseSafetyFlagRef(queue.front().task_.safety_);
+            }
+            queue.pop();
+        }
+    }
+    for (auto& entry : delayed_queue_) {
+        if (entry.second.task_.safety_) {
+            releaseSafetyFlagRef(entry.second.task_.safety_);
+        }
+    }
+}
+
+void PendingTaskQueue::push(Task task, Priority priority) {
+    Entry entry;
+    entry.order_ = posting_order_++;
+    if (task.safety_) {
+        retainSafetyFlag(task.safety_);
+    }
+    entry.task_ = std::move(task);
+    pending_queues_[static_cast<int>(priority)].push(std::move(entry));
+}
+
+void PendingTaskQueue::pushDelayed(Task task, int64_t fire_at_ms) {
+    DelayedEntryTimeout delay;
+    delay.next_fire_at_ms_ = fire_at_ms;
+    delay.order_ = posting_order_++;
+
+    Entry entry;
+    entry.order_ = delay.order_;
+    if (task.safety_) {
+        retainSafetyFlag(task.safety_);
+    }
+    entry.task_ = std::move(task);
+    delayed_queue_[delay] = std::move(entry);
+}
+
+std::unique_ptr<QueuedTask> PendingTaskQueue::pushCoalesced(uint64_t key, Task task) {
+    auto it = coalescing_index_.find(key);
+    if (it != coalescing_index_.end()) {
+        // Keep the position, order, ready time and trace flow of the
+        // pending entry, only the work is replaced.
+        Entry* entry = it->second;
+        std::unique_ptr<QueuedTask> replaced = std::move(entry->task_.task_);
+        entry->task_.task_ = std::move(task.task_);
+        entry->task_.location_ = task.location_;
+        return replaced;
+    }
+
+    Entry entry;
+    entry.order_ = posting_order_++;
+    entry.task_ = std::move(task);
+    entry.task_.safety_ = nullptr;
+    entry.coalescable_ = true;
+    entry.coalesce_key_ = key;
+
+    auto& queue = pending_queues_[static_cast<int>(Priority::kNormal)];
+    queue.push(std::move(entry));
+    coalescing_index_.emplace(key, &queue.back());
+    return nullptr;
+}
+
+void PendingTaskQueue::take(Entry& entry, NextTask& result) {
+    result.run_task_ = std::move(entry.task_.task_);
+    result.location_ = entry.task_.location_;
+    result.ready_at_us_ = entry.task_.ready_at_us_;
+    result.trace_id_ = entry.task_.trace_id_;
+    if (entry.coalescable_) {
+        coalescing_index_.erase(entry.coalesce_key_);
+    }
+    if (entry.task_.safety_) {
+        result.discard_ = !entry.task_.safety_->alive();
+        releaseSafetyFlagRef(entry.task_.safety_);
+        entry.task_.safety_ = nullptr;
+    }
+}
+
+PendingTaskQueue::NextTask PendingTaskQueue::next(int64_t now_ms) {
+    NextTask result{};
+
+    auto& high_queue = pending_queues_[static_cast<int>(Priority::kHigh)];
+    auto& normal_queue = pending_queues_[static_cast<int>(Priority::kNormal)];
+
+    if (high_queue.size() > 0) {
+        take(high_queue.front(), result);
+        high_queue.pop();
+        return result;
+    }
+
+    if (delayed_queue_.size() > 0) {
+        auto delayed_entry = delayed_queue_.begin();
+        const auto& delay_info = delayed_entry->first;
+        auto& delay_run = delayed_entry->second;
+        if (now_ms >= delay_info.next_fire_at_ms_) {
+            if (normal_queue.size() > 0) {
+                auto& entry = normal_queue.front();
+                if (entry.order_ < delay_info.order_) {
+                    take(entry, result);
+                    normal_queue.pop();
+                    return result;
+                }
+            }
+
+            take(delay_run, result);
+            delayed_queue_.erase(delayed_entry);
+            return result;
+        }
+
+        result.sleep_time_ms_ = delay_info.next_fire_at_ms_ - now_ms;
+    }
+
+    // No delayed task is due here, so the idle lane is served last.
+    for (int priority = static_cast<int>(Priority::kNormal); priority < TaskQueueBase::kPriorityCount; ++priority) {
+        auto& queue = pending_queues_[priority];
+        if (queue.size() > 0) {
+            take(queue.front(), result);
+            queue.pop();
+            break;
+        }
+    }
+
+    return result;
+}
+
+int64_t PendingTaskQueue::nextDelayedAt() const {
+    return delayed_queue_.empty() ? -1 : delayed_queue_.begin()->first.next_fire_at_ms_;
+}
+
+bool PendingTaskQueue::empty() const {
+    for (const auto& queue : pending_queues_) {
+        if (!queue.empty()) {
+            return false;
+        }
+    }
+    return delayed_queue_.empty();
+}
+
+void PendingTaskQueue::releaseSafetyFlag(PendingTaskSafetyFlag* flag,
+                                         std::vector<std::unique_ptr<QueuedTask>>& dropped) {
+    flag->alive_.store(false, std::memory_order_release);
+
+    // Delayed tasks may be far from due, free them now rather than when they
+    // fire. Pending ones are dropped when reached, which is soon anyway.
+    for (auto it = delayed_queue_.begin(); it != delayed_queue_.end();) {
+        if (it->second.task_.safety_ == flag) {
+            dropped.push_back(std::move(it->second.task_.task_));
+            releaseSafetyFlagRef(flag);
+            it = delayed_queue_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // The owner's reference goes last, it keeps |flag| valid until here.
+    releaseSafetyFlagRef(flag);
+}
+
+void PendingTaskQueue::releaseSafetyFlagRef(PendingTaskSafetyFlag* flag) {
+    if (--flag->refs_ == 0) {
+        delete flag;
+    }
+}
+
+}
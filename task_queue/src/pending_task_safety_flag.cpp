@@ -0,0 +1,25 @@
+#include "utoolkit/task_queue/pending_task_safety_flag.h"
+#include "utoolkit/task_queue/task_queue_base.h"
+
+namespace vi {
+
+ScopedTaskSafety::ScopedTaskSafety(TaskQueueBase* queue)
+    : flag_(new PendingTaskSafetyFlag(queue)) {
+}
+
+ScopedTaskSafety::~ScopedTaskSafety() {
+    release();
+}
+
+void ScopedTaskSafety::reset() {
+    TaskQueueBase* queue = flag_->queue();
+    release();
+    flag_ = new PendingTaskSafetyFlag(queue);
+}
+
+void ScopedTaskSafety::release() {
+    flag_->queue()->releaseSafetyFlag(flag_);
+    flag_ = nullptr;
+}
+
+}
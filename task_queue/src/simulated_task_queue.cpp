@@ -0,0 +1,220 @@
+#include "utoolkit/task_queue/simulated_task_queue.h"
+#include <assert.h>
+#include <algorithm>
+
+namespace vi {
+
+SimulatedTaskQueue::SimulatedTaskQueue(SimulatedTimeController* controller, std::string_view name)
+    : controller_(controller)
+    , name_(name) {
+}
+
+SimulatedTaskQueue::~SimulatedTaskQueue() = default;
+
+void SimulatedTaskQueue::deleteThis() {
+    assert(isCurrent() == false);
+
+    // Nothing of this queue runs after this, the controller runs tasks on
+    // the calling thread.
+    controller_->unregisterQueue(this);
+    delete this;
+}
+
+void SimulatedTaskQueue::postTask(std::unique_ptr<QueuedTask> task, const Location& location) {
+    push(std::move(task), Priority::kNormal, nullptr, location);
+}
+
+void SimulatedTaskQueue::postTask(std::unique_ptr<QueuedTask> task, Priority priority, const Location& location) {
+    push(std::move(task), priority, nullptr, location);
+}
+
+void SimulatedTaskQueue::postTask(std::unique_ptr<QueuedTask> task, PendingTaskSafetyFlag* safety,
+                                  const Location& location) {
+    push(std::move(task), Priority::kNormal, safety, location);
+}
+
+void SimulatedTaskQueue::push(std::unique_ptr<QueuedTask> task, Priority priority,
+                              PendingTaskSafetyFlag* safety, const Location& location) {
+    assert(!safety || safety->queue() == this);
+
+    PendingTaskQueue::Task pending;
+    pending.task_ = std::move(task);
+    pending.location_ = location;
+    pending.safety_ = safety;
+
+    std::unique_lock<std::mutex> lock(pending_mutex_);
+    pending_.push(std::move(pending), priority);
+}
+
+void SimulatedTaskQueue::postCoalesced(uint64_t key, std::unique_ptr<QueuedTask> task, const Location& location) {
+    // Destroyed outside of the lock.
+    std::unique_ptr<QueuedTask> replaced;
+
+    PendingTaskQueue::Task pending;
+    pending.task_ = std::move(task);
+    pending.location_ = location;
+
+    std::unique_lock<std::mutex> lock(pending_mutex_);
+    replaced = pending_.pushCoalesced(key, std::move(pending));
+}
+
+void SimulatedTaskQueue::postDelayedTask(std::unique_ptr<QueuedTask> task, uint32_t ms, const Location& location) {
+    postDelayedTask(std::move(task), ms, nullptr, location);
+}
+
+void SimulatedTaskQueue::postDelayedTask(std::unique_ptr<QueuedTask> task, uint32_t ms,
+                                         PendingTaskSafetyFlag* safety, const Location& location) {
+    assert(!safety || safety->queue() == this);
+
+    PendingTaskQueue::Task pending;
+    pending.task_ = std::move(task);
+    pending.location_ = location;
+    pending.safety_ = safety;
+
+    std::unique_lock<std::mutex> lock(pending_mutex_);
+    pending_.pushDelayed(std::move(pending), controller_->now() + ms);
+}
+
+void SimulatedTaskQueue::releaseSafetyFlag(PendingTaskSafetyFlag* flag) {
+    assert(flag->queue() == this);
+
+    // Destroyed outside of the lock.
+    std::vector<std::unique_ptr<QueuedTask>> dropped;
+
+    std::unique_lock<std::mutex> lock(pending_mutex_);
+    pending_.releaseSafetyFlag(flag, dropped);
+}
+
+bool SimulatedTaskQueue::runNext(int64_t nowMs) {
+    PendingTaskQueue::NextTask task;
+    {
+        std::unique_lock<std::mutex> lock(pending_mutex_);
+        task = pending_.next(nowMs);
+    }
+
+    if (!task.run_task_) {
+        return false;
+    }
+
+    if (task.discard_) {
+        // The poster is gone, free the task without running it.
+        task.run_task_.reset();
+        return true;
+    }
+
+    CurrentTaskQueueSetter setCurrent(this);
+    QueuedTask* release_ptr = task.run_task_.release();
+    if (release_ptr->run()) {
+        delete release_ptr;
+    }
+    return true;
+}
+
+int64_t SimulatedTaskQueue::nextDelayedAt() {
+    std::unique_lock<std::mutex> lock(pending_mutex_);
+    return pending_.nextDelayedAt();
+}
+
+const std::string& SimulatedTaskQueue::name() const {
+    return name_;
+}
+
+SimulatedTimeController::SimulatedTimeController(int64_t startMs)
+    : now_ms_(startMs) {
+}
+
+SimulatedTimeController::~SimulatedTimeController() {
+    assert(queues_.empty());
+}
+
+std::unique_ptr<TaskQueueBase, TaskQueueDeleter> SimulatedTimeController::createTaskQueue(std::string_view name) {
+    auto queue = new SimulatedTaskQueue(this, name);
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        queues_.push_back(queue);
+    }
+    return std::unique_ptr<TaskQueueBase, TaskQueueDeleter>(queue);
+}
+
+void SimulatedTimeController::unregisterQueue(SimulatedTaskQueue* queue) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    queues_.erase(std::remove(queues_.begin(), queues_.end(), queue), queues_.end());
+}
+
+void SimulatedTimeController::runReady() {
+    assert(!running_);
+    running_ = true;
+
+    const int64_t now_ms = now();
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        // Re-read the list for every queue, tasks may create or delete queues.
+        for (size_t i = 0;; ++i) {
+            SimulatedTaskQueue* queue = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (i >= queues_.size()) {
+                    break;
+                }
+                queue = queues_[i];
+            }
+            if (queue->runNext(now_ms)) {
+                progress = true;
+            }
+        }
+    }
+
+    running_ = false;
+}
+
+void SimulatedTimeController::advanceTime(int64_t ms) {
+    const int64_t target = now() + std::max<int64_t>(ms, 0);
+    runUntil(target);
+    now_ms_.store(target, std::memory_order_release);
+}
+
+bool SimulatedTimeController::runUntilIdle(int64_t limitMs) {
+    const int64_t deadline = now() + std::max<int64_t>(limitMs, 0);
+    if (runUntil(deadline)) {
+        return true;
+    }
+    now_ms_.store(deadline, std::memory_order_release);
+    return false;
+}
+
+bool SimulatedTimeController::runUntil(int64_t targetMs) {
+    runReady();
+    while (true) {
+        // Nothing is runnable now, so the earliest delayed task is in the
+        // future and the clock can jump straight to it.
+        const int64_t next = nextDelayedAt();
+        if (next < 0) {
+            return true;
+        }
+        if (next > targetMs) {
+            return false;
+        }
+        now_ms_.store(next, std::memory_order_release);
+        runReady();
+    }
+}
+
+int64_t SimulatedTimeController::nextDelayedAt() {
+    std::vector<SimulatedTaskQueue*> queues;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        queues = queues_;
+    }
+
+    int64_t next = -1;
+    for (auto queue : queues) {
+        const int64_t at = queue->nextDelayedAt();
+        if (at >= 0 && (next < 0 || at < next)) {
+            next = at;
+        }
+    }
+    return next;
+}
+
+}
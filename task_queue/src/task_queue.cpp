@@ -1,9 +1,16 @@
 #include "utoolkit/task_queue/task_queue.h"
 #include "utoolkit/task_queue/task_queue_base.h"
 #include "utoolkit/task_queue/task_queue_std.h"
+#include <atomic>
 
 namespace vi {
 
+namespace {
+
+std::atomic<TaskQueueFactory*> g_factory {nullptr};
+
+}
+
 TaskQueue::TaskQueue(std::unique_ptr<TaskQueueBase, TaskQueueDeleter> taskQueue)
     : impl_(taskQueue.release()) {}
 
@@ -19,16 +26,44 @@ bool TaskQueue::isCurrent() const {
     return impl_->isCurrent();
 }
 
-void TaskQueue::postTask(std::unique_ptr<QueuedTask> task) {
-    return impl_->postTask(std::move(task));
+void TaskQueue::postTask(std::unique_ptr<QueuedTask> task, const Location& location) {
+    return impl_->postTask(std::move(task), location);
+}
+
+void TaskQueue::postTask(std::unique_ptr<QueuedTask> task, Priority priority, const Location& location) {
+    return impl_->postTask(std::move(task), priority, location);
+}
+
+void TaskQueue::postTask(std::unique_ptr<QueuedTask> task, const ScopedTaskSafety& safety, const Location& location) {
+    return impl_->postTask(std::move(task), safety.flag(), location);
 }
 
-void TaskQueue::postDelayedTask(std::unique_ptr<QueuedTask> task, uint32_t milliseconds) {
-    return impl_->postDelayedTask(std::move(task), milliseconds);
+void TaskQueue::postCoalesced(uint64_t key, std::unique_ptr<QueuedTask> task, const Location& location) {
+    return impl_->postCoalesced(key, std::move(task), location);
+}
+
+void TaskQueue::postDelayedTask(std::unique_ptr<QueuedTask> task, uint32_t milliseconds, const Location& location) {
+    return impl_->postDelayedTask(std::move(task), milliseconds, location);
+}
+
+void TaskQueue::postDelayedTask(std::unique_ptr<QueuedTask> task, uint32_t milliseconds,
+                                const ScopedTaskSafety& safety, const Location& location) {
+    return impl_->postDelayedTask(std::move(task), milliseconds, safety.flag(), location);
 }
 
 std::unique_ptr<TaskQueue> TaskQueue::create(std::string_view name) {
+    return create(name, g_factory.load(std::memory_order_acquire));
+}
+
+std::unique_ptr<TaskQueue> TaskQueue::create(std::string_view name, TaskQueueFactory* factory) {
+    if (factory) {
+        return std::make_unique<TaskQueue>(factory->createTaskQueue(name));
+    }
     return std::make_unique<TaskQueue>(std::unique_ptr<TaskQueueBase, TaskQueueDeleter>(new TaskQueueSTD(name)));
 }
 
+void TaskQueue::setFactory(TaskQueueFactory* factory) {
+    g_factory.store(factory, std::memory_order_release);
+}
+
 }
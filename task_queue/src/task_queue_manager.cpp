@@ -1,5 +1,9 @@
 #include "utoolkit/task_queue/task_queue_manager.h"
 #include "utoolkit/task_queue/task_queue.h"
+#include "utoolkit/task_queue/task_queue_base.h"
+#include <stdio.h>
+#include <algorithm>
+#include <unordered_map>
 
 namespace vi {
 
@@ -20,40 +24,149 @@ TaskQueueManager::TaskQueueManager()
 
 TaskQueueManager::~TaskQueueManager()
 {
+    stopWatchdog();
     clear();
 }
 
 void TaskQueueManager::create(const std::vector<std::string>& nameList)
 {
     std::unique_lock<std::mutex> lock(m_mutex);
+
+    const Snapshot* current = m_snapshot.load(std::memory_order_relaxed);
+    auto next = current ? std::make_unique<Snapshot>(*current) : std::make_unique<Snapshot>();
+
+    bool changed = false;
     for (const auto& name : nameList) {
-        if (!exist(name)) {
-            m_queueMap[name] = TaskQueue::create(name);
+        if (next->ids.find(name) != next->ids.end()) {
+            continue;
         }
+        auto id = static_cast<QueueId>(m_queues.size());
+        m_queues.push_back(TaskQueue::create(name));
+        TaskQueue* tq = m_queues.back().get();
+        next->queues.push_back(tq);
+        next->ids.emplace(tq->get()->name(), id);
+        changed = true;
     }
+
+    if (!changed) {
+        return;
+    }
+
+    m_snapshot.store(next.get(), std::memory_order_release);
+    m_snapshots.push_back(std::move(next));
 }
 
 void TaskQueueManager::clear()
 {
     std::unique_lock<std::mutex> lock(m_mutex);
-    m_queueMap.clear();
+    m_snapshot.store(nullptr, std::memory_order_release);
+    m_queues.clear();
+    m_snapshots.clear();
 }
 
-bool TaskQueueManager::exist(const std::string& name)
+const TaskQueueManager::Snapshot* TaskQueueManager::snapshot() const
 {
-    return (m_queueMap.find(name) != m_queueMap.end());
+    return m_snapshot.load(std::memory_order_acquire);
 }
 
-bool TaskQueueManager::hasQueue(const std::string& name)
+bool TaskQueueManager::hasQueue(std::string_view name) const
 {
-    std::unique_lock<std::mutex> lock(m_mutex);
-    return exist(name);
+    return queueId(name) != kInvalidQueueId;
 }
 
-TaskQueue* TaskQueueManager::queue(const std::string& name)
+TaskQueueManager::QueueId TaskQueueManager::queueId(std::string_view name) const
 {
-    std::unique_lock<std::mutex> lock(m_mutex);
-    return exist(name) ? m_queueMap[name].get() : nullptr;
+    const Snapshot* s = snapshot();
+    if (!s) {
+        return kInvalidQueueId;
+    }
+    auto it = s->ids.find(name);
+    return it != s->ids.end() ? it->second : kInvalidQueueId;
+}
+
+TaskQueue* TaskQueueManager::queue(std::string_view name) const
+{
+    const Snapshot* s = snapshot();
+    if (!s) {
+        return nullptr;
+    }
+    auto it = s->ids.find(name);
+    return it != s->ids.end() ? s->queues[it->second] : nullptr;
+}
+
+TaskQueue* TaskQueueManager::queue(QueueId id) const
+{
+    const Snapshot* s = snapshot();
+    return (s && id < s->queues.size()) ? s->queues[id] : nullptr;
+}
+
+std::vector<TaskQueueStats> TaskQueueManager::stats() const
+{
+    std::vector<TaskQueueStats> result;
+    const Snapshot* s = snapshot();
+    if (!s) {
+        return result;
+    }
+    result.reserve(s->queues.size());
+    for (TaskQueue* tq : s->queues) {
+        result.push_back(tq->get()->stats());
+    }
+    return result;
+}
+
+void TaskQueueManager::startWatchdog(uint32_t slowTaskMs, SlowTaskHandler handler)
+{
+    stopWatchdog();
+
+    if (!handler) {
+        handler = [](const TaskQueueStats& stats) {
+            fprintf(stderr, "[TaskQueue] slow task on '%s': running for %llu ms, posted from %s\n",
+                    stats.name.c_str(),
+                    static_cast<unsigned long long>(stats.running_for_us / 1000),
+                    stats.running_task.toString().c_str());
+        };
+    }
+
+    std::unique_lock<std::mutex> lock(m_watchdogMutex);
+    TaskQueueMetrics::setSlowTaskThreshold(slowTaskMs);
+    m_watchdogStop.reset();
+    m_watchdog = std::thread([this, slowTaskMs, handler]{
+        watchdogLoop(slowTaskMs, handler);
+    });
+}
+
+void TaskQueueManager::stopWatchdog()
+{
+    std::unique_lock<std::mutex> lock(m_watchdogMutex);
+    if (!m_watchdog.joinable()) {
+        return;
+    }
+    m_watchdogStop.set();
+    m_watchdog.join();
+    TaskQueueMetrics::setSlowTaskThreshold(0);
+}
+
+void TaskQueueManager::watchdogLoop(uint32_t slowTaskMs, SlowTaskHandler handler)
+{
+    const uint64_t thresholdUs = uint64_t(slowTaskMs) * 1000;
+    const int interval = std::max<int>(10, slowTaskMs / 2);
+
+    // Last reported task per queue, so that every stall is reported once.
+    std::unordered_map<std::string, uint64_t> reported;
+
+    while (!m_watchdogStop.wait(interval)) {
+        for (const auto& stats : this->stats()) {
+            if (stats.running_task_id == 0 || stats.running_for_us < thresholdUs) {
+                continue;
+            }
+            auto& last = reported[stats.name];
+            if (last == stats.running_task_id) {
+                continue;
+            }
+            last = stats.running_task_id;
+            handler(stats);
+        }
+    }
 }
 
 }
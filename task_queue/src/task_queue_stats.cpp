@@ -0,0 +1,240 @@
+#include "utoolkit/task_queue/task_queue_stats.h"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+namespace vi {
+
+namespace {
+
+std::atomic<uint32_t> _slowTaskThresholdMs {0};
+
+void updateMax(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (value > current &&
+           !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+}  // namespace
+
+uint64_t HistogramSnapshot::bucketUpperBound(int index) {
+    if (index <= 0) {
+        return 0;
+    }
+    if (index >= kBucketCount - 1) {
+        return UINT64_MAX;
+    }
+    return (uint64_t(1) << index) - 1;
+}
+
+uint64_t HistogramSnapshot::percentile(double p) const {
+    if (count == 0) {
+        return 0;
+    }
+    if (p < 0) {
+        p = 0;
+    }
+    if (p > 100) {
+        p = 100;
+    }
+    auto rank = static_cast<uint64_t>(p / 100.0 * count + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < kBucketCount; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::min(bucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
+
+int Histogram::bucketIndex(uint64_t value) {
+    int width = 0;
+#if defined(__GNUC__) || defined(__clang__)
+    width = value ? 64 - __builtin_clzll(value) : 0;
+#else
+    while (value) {
+        ++width;
+        value >>= 1;
+    }
+#endif
+    return width < HistogramSnapshot::kBucketCount ? width : HistogramSnapshot::kBucketCount - 1;
+}
+
+void Histogram::record(uint64_t value) {
+    buckets_[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    updateMax(max_, value);
+}
+
+HistogramSnapshot Histogram::snapshot() const {
+    HistogramSnapshot result;
+    for (int i = 0; i < HistogramSnapshot::kBucketCount; ++i) {
+        result.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        result.count += result.buckets[i];
+    }
+    result.sum = sum_.load(std::memory_order_relaxed);
+    result.max = max_.load(std::memory_order_relaxed);
+    return result;
+}
+
+std::string TaskQueueStats::toString() const {
+    std::ostringstream ss;
+    ss << "queue=" << name
+       << " posted=" << posted_tasks
+       << " delayed=" << delayed_tasks
+       << " executed=" << executed_tasks
+       << " discarded=" << discarded_tasks
+       << " pending=" << pending_tasks
+       << " coalesced=" << coalesced_tasks
+       << " latency_us(mean/p50/p99/max)=" << static_cast<uint64_t>(queue_latency_us.mean())
+       << "/" << queue_latency_us.percentile(50)
+       << "/" << queue_latency_us.percentile(99)
+       << "/" << queue_latency_us.max
+       << " run_us(mean/p50/p99/max)=" << static_cast<uint64_t>(run_time_us.mean())
+       << "/" << run_time_us.percentile(50)
+       << "/" << run_time_us.percentile(99)
+       << "/" << run_time_us.max
+       << " slow=" << slow_tasks;
+    if (slow_tasks > 0) {
+        ss << " last_slow=" << last_slow_task.toString() << "(" << last_slow_task_us << "us)";
+    }
+    if (running_task_id != 0) {
+        ss << " running=" << running_task.toString() << "(" << running_for_us << "us)";
+    }
+    return ss.str();
+}
+
+int64_t TaskQueueMetrics::nowUs() {
+#if UT_TASK_QUEUE_STATS
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+    return 0;
+#endif
+}
+
+void TaskQueueMetrics::setSlowTaskThreshold(uint32_t ms) {
+    _slowTaskThresholdMs.store(ms, std::memory_order_relaxed);
+}
+
+uint32_t TaskQueueMetrics::slowTaskThreshold() {
+    return _slowTaskThresholdMs.load(std::memory_order_relaxed);
+}
+
+#if UT_TASK_QUEUE_STATS
+
+void TaskQueueMetrics::onPosted(bool delayed) {
+    posted_.fetch_add(1, std::memory_order_relaxed);
+    if (delayed) {
+        delayed_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void TaskQueueMetrics::onCoalesced() {
+    coalesced_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TaskQueueMetrics::onDiscarded(uint64_t count) {
+    if (count > 0) {
+        discarded_.fetch_add(count, std::memory_order_relaxed);
+    }
+}
+
+void TaskQueueMetrics::onTaskStart(const Location& from, int64_t readyAtUs, int64_t startUs) {
+    queue_latency_.record(startUs > readyAtUs ? static_cast<uint64_t>(startUs - readyAtUs) : 0);
+
+    const uint64_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    running_id_.store(executed_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    running_since_us_.store(startUs, std::memory_order_relaxed);
+    running_function_.store(from.function(), std::memory_order_relaxed);
+    running_file_.store(from.file(), std::memory_order_relaxed);
+    running_line_.store(from.line(), std::memory_order_relaxed);
+    seq_.store(seq + 2, std::memory_order_release);
+}
+
+void TaskQueueMetrics::onTaskFinish(const Location& from, int64_t startUs) {
+    const int64_t endUs = nowUs();
+    const uint64_t runUs = endUs > startUs ? static_cast<uint64_t>(endUs - startUs) : 0;
+    run_time_.record(runUs);
+
+    const uint64_t thresholdUs = uint64_t(slowTaskThreshold()) * 1000;
+    const bool slow = thresholdUs > 0 && runUs >= thresholdUs;
+
+    const uint64_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    running_id_.store(0, std::memory_order_relaxed);
+    if (slow) {
+        slow_function_.store(from.function(), std::memory_order_relaxed);
+        slow_file_.store(from.file(), std::memory_order_relaxed);
+        slow_line_.store(from.line(), std::memory_order_relaxed);
+        slow_us_.store(runUs, std::memory_order_relaxed);
+    }
+    seq_.store(seq + 2, std::memory_order_release);
+
+    if (slow) {
+        slow_.fetch_add(1, std::memory_order_relaxed);
+    }
+    executed_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TaskQueueMetrics::readRunning(TaskQueueStats& stats) const {
+    // A handful of retries is plenty: the writer holds the lock for a few
+    // stores only. Give up rather than spin against a very busy queue.
+    for (int attempt = 0; attempt < 64; ++attempt) {
+        const uint64_t before = seq_.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        const uint64_t id = running_id_.load(std::memory_order_relaxed);
+        const int64_t since = running_since_us_.load(std::memory_order_relaxed);
+        const Location running(running_function_.load(std::memory_order_relaxed),
+                               running_file_.load(std::memory_order_relaxed),
+                               running_line_.load(std::memory_order_relaxed));
+        const Location slow(slow_function_.load(std::memory_order_relaxed),
+                            slow_file_.load(std::memory_order_relaxed),
+                            slow_line_.load(std::memory_order_relaxed));
+        const uint64_t slowUs = slow_us_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) != before) {
+            continue;
+        }
+
+        stats.running_task_id = id;
+        if (id != 0) {
+            const int64_t now = nowUs();
+            stats.running_task = running;
+            stats.running_for_us = now > since ? static_cast<uint64_t>(now - since) : 0;
+        }
+        stats.last_slow_task = slow;
+        stats.last_slow_task_us = slowUs;
+        return;
+    }
+}
+
+TaskQueueStats TaskQueueMetrics::snapshot(const std::string& name) const {
+    TaskQueueStats stats;
+    stats.name = name;
+    stats.executed_tasks = executed_.load(std::memory_order_relaxed);
+    stats.posted_tasks = posted_.load(std::memory_order_relaxed);
+    stats.delayed_tasks = delayed_.load(std::memory_order_relaxed);
+    stats.discarded_tasks = discarded_.load(std::memory_order_relaxed);
+    const uint64_t done = stats.executed_tasks + stats.discarded_tasks;
+    stats.pending_tasks = stats.posted_tasks > done ? stats.posted_tasks - done : 0;
+    stats.coalesced_tasks = coalesced_.load(std::memory_order_relaxed);
+    stats.slow_tasks = slow_.load(std::memory_order_relaxed);
+    stats.queue_latency_us = queue_latency_.snapshot();
+    stats.run_time_us = run_time_.snapshot();
+    readRunning(stats);
+    return stats;
+}
+
+#endif
+
+}
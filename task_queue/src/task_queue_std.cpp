@@ -1,5 +1,9 @@
 #include "utoolkit/task_queue/task_queue_std.h"
 #include <assert.h>
+#include <vector>
+#include <utoolkit/trace/tracer.h>
+
+using utoolkit::trace::Tracer;
 
 namespace vi {
 
@@ -11,6 +15,7 @@ TaskQueueSTD::TaskQueueSTD(std::string_view queueName)
 
     thread_ = std::thread([this]{
         CurrentTaskQueueSetter setCurrent(this);
+        Tracer::set_thread_name(name_);
         this->processTasks();
     });
 
@@ -18,6 +23,8 @@ TaskQueueSTD::TaskQueueSTD(std::string_view queueName)
     started_.wait(vi::Event::kForever);
 }
 
+TaskQueueSTD::~TaskQueueSTD() = default;
+
 void TaskQueueSTD::deleteThis() {
     //RTC_DCHECK(!isCurrent());
     assert(isCurrent() == false);
@@ -37,27 +44,117 @@ void TaskQueueSTD::deleteThis() {
     delete this;
 }
 
-void TaskQueueSTD::postTask(std::unique_ptr<QueuedTask> task) {
+void TaskQueueSTD::postTask(std::unique_ptr<QueuedTask> task, const Location& location) {
+    postTask(std::move(task), Priority::kNormal, location);
+}
+
+void TaskQueueSTD::postTask(std::unique_ptr<QueuedTask> task, Priority priority, const Location& location) {
+    postTaskImpl(std::move(task), priority, nullptr, location);
+}
+
+void TaskQueueSTD::postTask(std::unique_ptr<QueuedTask> task, PendingTaskSafetyFlag* safety, const Location& location) {
+    postTaskImpl(std::move(task), Priority::kNormal, safety, location);
+}
+
+void TaskQueueSTD::postTaskImpl(std::unique_ptr<QueuedTask> task, Priority priority,
+                                PendingTaskSafetyFlag* safety, const Location& location) {
+    assert(!safety || safety->queue() == this);
+
+    PendingTaskQueue::Task pending;
+    pending.task_ = std::move(task);
+    pending.location_ = location;
+    pending.ready_at_us_ = TaskQueueMetrics::nowUs();
+    pending.safety_ = safety;
+
+    const int64_t trace_start = UT_TRACE_ENABLED() ? Tracer::now_ns() : 0;
+    const uint64_t trace_id = trace_start ? Tracer::next_flow_id() : 0;
+    pending.trace_id_ = trace_id;
+
+    // Counted before the task becomes visible to the worker so that the
+    // executed count never overtakes the posted count.
+    metrics_.onPosted(/*delayed=*/false);
+
+    {
+        std::unique_lock<std::mutex> lock(pending_mutex_);
+        pending_.push(std::move(pending), priority);
+    }
+
+    if (trace_id) {
+        tracePost("PostTask", location, trace_id, trace_start);
+    }
+
+    notifyWake();
+}
+
+void TaskQueueSTD::postCoalesced(uint64_t key, std::unique_ptr<QueuedTask> task, const Location& location) {
+    // Destroyed outside of the lock.
+    std::unique_ptr<QueuedTask> replaced;
+
+    const int64_t trace_start = UT_TRACE_ENABLED() ? Tracer::now_ns() : 0;
+    const uint64_t trace_id = trace_start ? Tracer::next_flow_id() : 0;
+
+    PendingTaskQueue::Task pending;
+    pending.task_ = std::move(task);
+    pending.location_ = location;
+    pending.ready_at_us_ = TaskQueueMetrics::nowUs();
+    pending.trace_id_ = trace_id;
+
     {
         std::unique_lock<std::mutex> lock(pending_mutex_);
-        OrderId order = thread_posting_order_++;
+        replaced = pending_.pushCoalesced(key, std::move(pending));
+        // Still under the lock, so the worker cannot have run the new task.
+        if (!replaced) {
+            metrics_.onPosted(/*delayed=*/false);
+        }
+    }
+
+    if (replaced) {
+        metrics_.onCoalesced();
+        return;
+    }
 
-        pending_queue_.push(std::pair<OrderId, std::unique_ptr<QueuedTask>>(order, std::move(task)));
+    if (trace_id) {
+        tracePost("PostCoalesced", location, trace_id, trace_start);
     }
 
     notifyWake();
 }
 
-void TaskQueueSTD::postDelayedTask(std::unique_ptr<QueuedTask> task, uint32_t ms) {
+void TaskQueueSTD::postDelayedTask(std::unique_ptr<QueuedTask> task, uint32_t ms, const Location& location) {
+    postDelayedTaskImpl(std::move(task), ms, nullptr, location);
+}
+
+void TaskQueueSTD::postDelayedTask(std::unique_ptr<QueuedTask> task, uint32_t ms,
+                                   PendingTaskSafetyFlag* safety, const Location& location) {
+    postDelayedTaskImpl(std::move(task), ms, safety, location);
+}
+
+void TaskQueueSTD::postDelayedTaskImpl(std::unique_ptr<QueuedTask> task, uint32_t ms,
+                                       PendingTaskSafetyFlag* safety, const Location& location) {
+    assert(!safety || safety->queue() == this);
+
     auto fire_at = milliseconds() + ms;
 
-    DelayedEntryTimeout delay;
-    delay.next_fire_at_ms_ = fire_at;
+    PendingTaskQueue::Task pending;
+    pending.task_ = std::move(task);
+    pending.location_ = location;
+    // Queue latency of a delayed task is measured from when it is due.
+    pending.ready_at_us_ = TaskQueueMetrics::nowUs() + int64_t(ms) * 1000;
+    pending.safety_ = safety;
+
+    const int64_t trace_start = UT_TRACE_ENABLED() ? Tracer::now_ns() : 0;
+    const uint64_t trace_id = trace_start ? Tracer::next_flow_id() : 0;
+    pending.trace_id_ = trace_id;
+
+    metrics_.onPosted(/*delayed=*/true);
 
     {
         std::unique_lock<std::mutex> lock(pending_mutex_);
-        delay.order_ = ++thread_posting_order_;
-        delayed_queue_[delay] = std::move(task);
+        pending_.pushDelayed(std::move(pending), fire_at);
+    }
+
+    if (trace_id) {
+        tracePost("PostDelayedTask", location, trace_id, trace_start);
     }
 
     notifyWake();
@@ -75,36 +172,7 @@ TaskQueueSTD::NextTask TaskQueueSTD::getNextTask() {
         return result;
     }
 
-    if (delayed_queue_.size() > 0) {
-        auto delayed_entry = delayed_queue_.begin();
-        const auto& delay_info = delayed_entry->first;
-        auto& delay_run = delayed_entry->second;
-        if (tick >= delay_info.next_fire_at_ms_) {
-            if (pending_queue_.size() > 0) {
-                auto& entry = pending_queue_.front();
-                auto& entry_order = entry.first;
-                auto& entry_run = entry.second;
-                if (entry_order < delay_info.order_) {
-                    result.run_task_ = std::move(entry_run);
-                    pending_queue_.pop();
-                    return result;
-                }
-            }
-
-            result.run_task_ = std::move(delay_run);
-            delayed_queue_.erase(delayed_entry);
-            return result;
-        }
-
-        result.sleep_time_ms_ = delay_info.next_fire_at_ms_ - tick;
-    }
-
-    if (pending_queue_.size() > 0) {
-        auto& entry = pending_queue_.front();
-        result.run_task_ = std::move(entry.second);
-        pending_queue_.pop();
-    }
-
+    result.task_ = pending_.next(tick);
     return result;
 }
 
@@ -112,18 +180,39 @@ void TaskQueueSTD::processTasks() {
     started_.set();
 
     while (true) {
-        auto task = getNextTask();
+        auto next = getNextTask();
 
-        if (task.final_task_) {
+        if (next.final_task_) {
             break;
         }
 
+        auto& task = next.task_;
+
+        if (task.discard_) {
+            // The poster is gone, free the task without running it.
+            task.run_task_.reset();
+            metrics_.onDiscarded(1);
+            continue;
+        }
+
         if (task.run_task_) {
             // process entry immediately then try again
+            const int64_t start_us = TaskQueueMetrics::nowUs();
+            metrics_.onTaskStart(task.location_, task.ready_at_us_, start_us);
+            int64_t trace_start = 0;
+            if (task.trace_id_) {
+                trace_start = Tracer::now_ns();
+                Tracer::flow_end("task_queue", "task", task.trace_id_, trace_start);
+            }
             QueuedTask* release_ptr = task.run_task_.release();
             if (release_ptr->run()) {
                 delete release_ptr;
             }
+            if (task.trace_id_) {
+                Tracer::complete("task_queue", task.location_.function(), trace_start, Tracer::now_ns(),
+                                 task.location_.file(), task.location_.line());
+            }
+            metrics_.onTaskFinish(task.location_, start_us);
             // attempt to sleep again
             continue;
         }
@@ -139,6 +228,20 @@ void TaskQueueSTD::processTasks() {
     stopped_.set();
 }
 
+void TaskQueueSTD::releaseSafetyFlag(PendingTaskSafetyFlag* flag) {
+    assert(flag->queue() == this);
+
+    // Destroyed outside of the lock.
+    std::vector<std::unique_ptr<QueuedTask>> dropped;
+
+    {
+        std::unique_lock<std::mutex> lock(pending_mutex_);
+        pending_.releaseSafetyFlag(flag, dropped);
+    }
+
+    metrics_.onDiscarded(dropped.size());
+}
+
 void TaskQueueSTD::notifyWake() {
     // The queue holds pending tasks to complete. Either tasks are to be
     // executed immediately or tasks are to be run at some future delayed time.
@@ -167,6 +270,13 @@ void TaskQueueSTD::notifyWake() {
     flag_notify_.set();
 }
 
+void TaskQueueSTD::tracePost(const char* name, const Location& location, uint64_t traceId, int64_t startNs) {
+    // The flow starts inside the post slice so that viewers bind the arrow
+    // to the posting thread.
+    Tracer::complete("task_queue", name, startNs, Tracer::now_ns(), location.file(), location.line());
+    Tracer::flow_start("task_queue", "task", traceId, startNs);
+}
+
 int64_t TaskQueueSTD::milliseconds() {
     return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 }
@@ -175,4 +285,8 @@ const std::string& TaskQueueSTD::name() const {
     return name_;
 }
 
+TaskQueueStats TaskQueueSTD::stats() const {
+    return metrics_.snapshot(name_);
+}
+
 }
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include "utoolkit/task_queue/event.h"
+#include "utoolkit/task_queue/pending_task_safety_flag.h"
+#include "utoolkit/task_queue/task_queue.h"
+
+namespace {
+
+// Counts live instances to check that dropped closures are freed.
+struct Tracked {
+    explicit Tracked(std::atomic<int>* live) : live_(live) { ++*live_; }
+    Tracked(const Tracked& o) : live_(o.live_) { ++*live_; }
+    ~Tracked() { --*live_; }
+    std::atomic<int>* live_;
+};
+
+void flush(vi::TaskQueue* queue) {
+    vi::Event done;
+    queue->postTask([&done]{ done.set(); });
+    ASSERT_TRUE(done.wait(1000));
+}
+
+} // namespace
+
+TEST(PendingTaskSafetyFlagTest, RunsWhileAlive) {
+    auto queue = vi::TaskQueue::create("safety_alive");
+    vi::ScopedTaskSafety safety(queue->get());
+
+    std::atomic<int> runs {0};
+    queue->postTask([&runs]{ ++runs; }, safety);
+    flush(queue.get());
+    EXPECT_EQ(runs.load(), 1);
+}
+
+TEST(PendingTaskSafetyFlagTest, DropsPendingTasksAfterReset) {
+    auto queue = vi::TaskQueue::create("safety_reset");
+    vi::ScopedTaskSafety safety(queue->get());
+
+    vi::Event gate;
+    queue->postTask([&gate]{ gate.wait(vi::Event::kForever); });
+
+    std::atomic<int> runs {0};
+    std::atomic<int> live {0};
+    Tracked tracked(&live);
+    for (int i = 0; i < 10; ++i) {
+        queue->postTask([&runs, tracked]{ ++runs; }, safety);
+    }
+
+    // reset() has to happen on the queue, run it ahead of the dropped tasks.
+    vi::Event resetDone;
+    queue->postTask([&]{ safety.reset(); resetDone.set(); }, vi::TaskQueue::Priority::kHigh);
+    gate.set();
+    ASSERT_TRUE(resetDone.wait(1000));
+
+    queue->postTask([&runs]{ runs += 100; }, safety);
+    flush(queue.get());
+
+    EXPECT_EQ(runs.load(), 100);
+    EXPECT_EQ(live.load(), 1);
+#if UT_TASK_QUEUE_STATS
+    EXPECT_EQ(queue->get()->stats().discarded_tasks, 10u);
+#endif
+}
+
+TEST(PendingTaskSafetyFlagTest, FreesDelayedTasksImmediately) {
+    auto queue = vi::TaskQueue::create("safety_delayed");
+    std::atomic<int> live {0};
+    std::atomic<int> runs {0};
+
+    {
+        auto safety = std::make_unique<vi::ScopedTaskSafety>(queue->get());
+        Tracked tracked(&live);
+        queue->postDelayedTask([&runs, tracked]{ ++runs; }, 60 * 1000, *safety);
+        queue->postDelayedTask([&runs, tracked]{ ++runs; }, 30 * 1000, *safety);
+        EXPECT_EQ(live.load(), 3);
+
+        vi::Event destroyed;
+        queue->postTask([&]{ safety.reset(); destroyed.set(); });
+        ASSERT_TRUE(destroyed.wait(1000));
+    }
+
+    EXPECT_EQ(live.load(), 0);
+    EXPECT_EQ(runs.load(), 0);
+#if UT_TASK_QUEUE_STATS
+    EXPECT_EQ(queue->get()->stats().discarded_tasks, 2u);
+#endif
+}
+
+TEST(PendingTaskSafetyFlagTest, QueueDestroyedWithPendingTasks) {
+    auto queue = vi::TaskQueue::create("safety_shutdown");
+    std::atomic<int> live {0};
+    {
+        vi::ScopedTaskSafety safety(queue->get());
+        Tracked tracked(&live);
+        queue->postDelayedTask([tracked]{}, 60 * 1000, safety);
+        queue->postTask([tracked]{}, safety);
+    }
+    queue.reset();
+    EXPECT_EQ(live.load(), 0);
+}
@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "utoolkit/task_queue/pending_task_safety_flag.h"
+#include "utoolkit/task_queue/simulated_task_queue.h"
+#include "utoolkit/task_queue/task_queue.h"
+
+using Priority = vi::TaskQueue::Priority;
+
+class SimulatedTaskQueueTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        queue_ = vi::TaskQueue::create("simulated", &clock_);
+    }
+
+    std::function<void()> record(const std::string& tag) {
+        return [this, tag]{ order_.push_back(tag + "@" + std::to_string(clock_.now())); };
+    }
+
+    vi::SimulatedTimeController clock_;
+    std::unique_ptr<vi::TaskQueue> queue_;
+    std::vector<std::string> order_;
+};
+
+TEST_F(SimulatedTaskQueueTest, NothingRunsUntilDriven) {
+    queue_->postTask(record("a"));
+    EXPECT_TRUE(order_.empty());
+
+    clock_.runReady();
+    EXPECT_EQ(order_, std::vector<std::string>{"a@0"});
+}
+
+TEST_F(SimulatedTaskQueueTest, DelayedTasksRunAtTheirDueTime) {
+    queue_->postDelayedTask(record("late"), 3000);
+    queue_->postDelayedTask(record("early"), 1000);
+    queue_->postDelayedTask(record("early2"), 1000);
+
+    clock_.advanceTime(999);
+    EXPECT_TRUE(order_.empty());
+    EXPECT_EQ(clock_.now(), 999);
+
+    clock_.advanceTime(5000);
+    std::vector<std::string> expected = {"early@1000", "early2@1000", "late@3000"};
+    EXPECT_EQ(order_, expected);
+    EXPECT_EQ(clock_.now(), 5999);
+}
+
+TEST_F(SimulatedTaskQueueTest, DueDelayedTasksKeepPostingOrderWithNormalTasks) {
+    queue_->postTask(record("before"));
+    queue_->postDelayedTask(record("delayed"), 0);
+    queue_->postTask(record("after"));
+
+    clock_.runReady();
+    std::vector<std::string> expected = {"before@0", "delayed@0", "after@0"};
+    EXPECT_EQ(order_, expected);
+}
+
+TEST_F(SimulatedTaskQueueTest, IdleTasksWaitForDueDelayedTasks) {
+    queue_->postTask(record("idle"), Priority::kIdle);
+    queue_->postDelayedTask(record("delayed"), 0);
+    queue_->postTask(record("low"), Priority::kLow);
+    queue_->postTask(record("high"), Priority::kHigh);
+
+    clock_.runReady();
+    std::vector<std::string> expected = {"high@0", "delayed@0", "low@0", "idle@0"};
+    EXPECT_EQ(order_, expected);
+}
+
+TEST_F(SimulatedTaskQueueTest, RunUntilIdleFollowsTimerChains) {
+    int ticks = 0;
+    std::function<void()> tick = [&]{
+        if (++ticks < 3600) {
+            queue_->postDelayedTask(tick, 1000);
+        }
+    };
+    queue_->postDelayedTask(tick, 1000);
+
+    // An hour of one second timers.
+    EXPECT_TRUE(clock_.runUntilIdle());
+    EXPECT_EQ(ticks, 3600);
+    EXPECT_EQ(clock_.now(), 3600 * 1000);
+}
+
+TEST_F(SimulatedTaskQueueTest, RunUntilIdleStopsAtLimitForPeriodicTimers) {
+    int ticks = 0;
+    std::function<void()> tick = [&]{
+        ++ticks;
+        queue_->postDelayedTask(tick, 100);
+    };
+    queue_->postDelayedTask(tick, 100);
+
+    EXPECT_FALSE(clock_.runUntilIdle(1000));
+    EXPECT_EQ(ticks, 10);
+    EXPECT_EQ(clock_.now(), 1000);
+}
+
+TEST_F(SimulatedTaskQueueTest, QueuesTakeTurns) {
+    auto other = vi::TaskQueue::create("other", &clock_);
+    queue_->postTask(record("a1"));
+    queue_->postTask(record("a2"));
+    other->postTask(record("b1"));
+    other->postTask(record("b2"));
+
+    clock_.runReady();
+    std::vector<std::string> expected = {"a1@0", "b1@0", "a2@0", "b2@0"};
+    EXPECT_EQ(order_, expected);
+}
+
+TEST_F(SimulatedTaskQueueTest, TasksRunOnTheirQueue) {
+    bool current = false;
+    queue_->postTask([&]{ current = queue_->isCurrent(); });
+    clock_.runReady();
+    EXPECT_TRUE(current);
+    EXPECT_FALSE(queue_->isCurrent());
+}
+
+TEST_F(SimulatedTaskQueueTest, SafetyFlagDropsTasks) {
+    auto safety = std::make_unique<vi::ScopedTaskSafety>(queue_->get());
+    queue_->postTask(record("pending"), *safety);
+    queue_->postDelayedTask(record("delayed"), 1000, *safety);
+    queue_->postTask(record("unguarded"));
+    safety.reset();
+
+    clock_.runUntilIdle();
+    EXPECT_EQ(order_, std::vector<std::string>{"unguarded@0"});
+}
+
+TEST_F(SimulatedTaskQueueTest, CoalescedTasksReplacePendingOnes) {
+    queue_->postCoalesced(1, record("first"));
+    queue_->postTask(record("other"));
+    queue_->postCoalesced(1, record("second"));
+
+    clock_.runReady();
+    std::vector<std::string> expected = {"second@0", "other@0"};
+    EXPECT_EQ(order_, expected);
+}
+
+TEST(SimulatedTaskQueueFactoryTest, CreateUsesInstalledFactory) {
+    vi::SimulatedTimeController clock(1000);
+    vi::TaskQueue::setFactory(&clock);
+    auto queue = vi::TaskQueue::create("factory");
+    vi::TaskQueue::setFactory(nullptr);
+
+    int64_t ran_at = -1;
+    queue->postDelayedTask([&]{ ran_at = clock.now(); }, 60 * 60 * 1000);
+    clock.advanceTime(60 * 60 * 1000);
+    EXPECT_EQ(ran_at, 1000 + 60 * 60 * 1000);
+}
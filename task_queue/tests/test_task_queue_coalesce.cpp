@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "utoolkit/task_queue/event.h"
+#include "utoolkit/task_queue/task_queue.h"
+
+class TaskQueueCoalesceTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        queue_ = vi::TaskQueue::create("coalesce_test");
+        queue_->postTask([this]{ gate_.wait(vi::Event::kForever); });
+    }
+
+    std::function<void()> recorder(const std::string& tag) {
+        return [this, tag]{
+            std::lock_guard<std::mutex> lock(mutex_);
+            order_.push_back(tag);
+        };
+    }
+
+    std::vector<std::string> runAll() {
+        vi::Event done;
+        queue_->postTask([&done]{ done.set(); });
+        gate_.set();
+        EXPECT_TRUE(done.wait(1000));
+        std::lock_guard<std::mutex> lock(mutex_);
+        return order_;
+    }
+
+    std::unique_ptr<vi::TaskQueue> queue_;
+    vi::Event gate_;
+    std::mutex mutex_;
+    std::vector<std::string> order_;
+};
+
+TEST_F(TaskQueueCoalesceTest, LatestReplacesPendingAtOriginalPosition) {
+    queue_->postTask(recorder("a"));
+    queue_->postCoalesced(1, recorder("x1"));
+    queue_->postTask(recorder("b"));
+    queue_->postCoalesced(1, recorder("x2"));
+    queue_->postCoalesced(2, recorder("y"));
+    queue_->postCoalesced(1, recorder("x3"));
+
+    std::vector<std::string> expected = {"a", "x3", "b", "y"};
+    EXPECT_EQ(runAll(), expected);
+
+#if UT_TASK_QUEUE_STATS
+    // The last task may still be accounting for itself.
+    auto stats = queue_->get()->stats();
+    for (int i = 0; i < 100 && stats.pending_tasks != 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        stats = queue_->get()->stats();
+    }
+    EXPECT_EQ(stats.coalesced_tasks, 2u);
+    EXPECT_EQ(stats.pending_tasks, 0u);
+#endif
+}
+
+TEST_F(TaskQueueCoalesceTest, RunningTaskIsNotReplaced) {
+    vi::Event started;
+    vi::Event release;
+    queue_->postCoalesced(7, [&]{
+        started.set();
+        release.wait(vi::Event::kForever);
+        recorder("first")();
+    });
+    gate_.set();
+    ASSERT_TRUE(started.wait(1000));
+
+    // The first task already left the queue, so this one is enqueued.
+    queue_->postCoalesced(7, recorder("second"));
+    release.set();
+
+    vi::Event done;
+    queue_->postTask([&done]{ done.set(); });
+    ASSERT_TRUE(done.wait(1000));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> expected = {"first", "second"};
+    EXPECT_EQ(order_, expected);
+}
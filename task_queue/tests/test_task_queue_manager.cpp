@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "utoolkit/task_queue/event.h"
+#include "utoolkit/task_queue/task_queue.h"
+#include "utoolkit/task_queue/task_queue_manager.h"
+
+TEST(TaskQueueManagerTest, LookupByName) {
+    TQMgr->create({"tqm_lookup_a", "tqm_lookup_b"});
+
+    EXPECT_TRUE(TQMgr->hasQueue("tqm_lookup_a"));
+    EXPECT_TRUE(TQMgr->hasQueue(std::string("tqm_lookup_b")));
+    EXPECT_FALSE(TQMgr->hasQueue("tqm_lookup_missing"));
+
+    EXPECT_NE(TQ("tqm_lookup_a"), nullptr);
+    EXPECT_NE(TQ("tqm_lookup_a"), TQ("tqm_lookup_b"));
+    EXPECT_EQ(TQ("tqm_lookup_missing"), nullptr);
+}
+
+TEST(TaskQueueManagerTest, QueueIdIsStable) {
+    TQMgr->create({"tqm_id_a"});
+    const auto id = TQMgr->queueId("tqm_id_a");
+    ASSERT_NE(id, vi::TaskQueueManager::kInvalidQueueId);
+    vi::TaskQueue* tq = TQ(id);
+
+    // 重复创建与新增队列都不应改变已有句柄
+    TQMgr->create({"tqm_id_a", "tqm_id_b"});
+    EXPECT_EQ(TQMgr->queueId("tqm_id_a"), id);
+    EXPECT_EQ(TQ(id), tq);
+    EXPECT_EQ(TQ("tqm_id_a"), tq);
+
+    EXPECT_EQ(TQMgr->queueId("tqm_id_missing"), vi::TaskQueueManager::kInvalidQueueId);
+    EXPECT_EQ(TQ(vi::TaskQueueManager::kInvalidQueueId), nullptr);
+}
+
+TEST(TaskQueueManagerTest, ConcurrentLookupDuringCreate) {
+    TQMgr->create({"tqm_concurrent"});
+    vi::TaskQueue* expected = TQ("tqm_concurrent");
+
+    std::atomic<bool> stop {false};
+    std::atomic<int> mismatches {0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&]{
+            while (!stop.load()) {
+                if (TQ("tqm_concurrent") != expected) {
+                    ++mismatches;
+                }
+            }
+        });
+    }
+
+    for (int i = 0; i < 50; ++i) {
+        TQMgr->create({"tqm_concurrent_" + std::to_string(i)});
+    }
+    stop = true;
+    for (auto& t : readers) {
+        t.join();
+    }
+
+    EXPECT_EQ(mismatches.load(), 0);
+    EXPECT_TRUE(TQMgr->hasQueue("tqm_concurrent_49"));
+}
+
+TEST(TaskQueueManagerTest, PostThroughHandle) {
+    TQMgr->create({"tqm_post"});
+    const auto id = TQMgr->queueId("tqm_post");
+
+    vi::Event done;
+    TQ(id)->postTask([&done]{ done.set(); });
+    EXPECT_TRUE(done.wait(1000));
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "utoolkit/task_queue/event.h"
+#include "utoolkit/task_queue/task_queue.h"
+
+using Priority = vi::TaskQueue::Priority;
+
+class TaskQueuePriorityTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        queue_ = vi::TaskQueue::create("priority_test");
+        // Keep the worker busy until all tasks have been posted.
+        queue_->postTask([this]{ gate_.wait(vi::Event::kForever); });
+    }
+
+    void record(const std::string& tag, Priority priority) {
+        queue_->postTask([this, tag]{
+            std::lock_guard<std::mutex> lock(mutex_);
+            order_.push_back(tag);
+        }, priority);
+    }
+
+    std::vector<std::string> runAll() {
+        vi::Event done;
+        queue_->postTask([&done]{ done.set(); }, Priority::kIdle);
+        gate_.set();
+        EXPECT_TRUE(done.wait(1000));
+        std::lock_guard<std::mutex> lock(mutex_);
+        return order_;
+    }
+
+    std::unique_ptr<vi::TaskQueue> queue_;
+    vi::Event gate_;
+    std::mutex mutex_;
+    std::vector<std::string> order_;
+};
+
+TEST_F(TaskQueuePriorityTest, HigherPriorityRunsFirst) {
+    record("idle1", Priority::kIdle);
+    record("low1", Priority::kLow);
+    record("normal1", Priority::kNormal);
+    record("high1", Priority::kHigh);
+    record("normal2", Priority::kNormal);
+    record("high2", Priority::kHigh);
+    record("low2", Priority::kLow);
+    record("idle2", Priority::kIdle);
+
+    std::vector<std::string> expected = {
+        "high1", "high2", "normal1", "normal2", "low1", "low2", "idle1", "idle2"};
+    EXPECT_EQ(runAll(), expected);
+}
+
+TEST_F(TaskQueuePriorityTest, DefaultPriorityIsNormal) {
+    record("low", Priority::kLow);
+    queue_->postTask([this]{
+        std::lock_guard<std::mutex> lock(mutex_);
+        order_.push_back("default");
+    });
+    record("high", Priority::kHigh);
+
+    std::vector<std::string> expected = {"high", "default", "low"};
+    EXPECT_EQ(runAll(), expected);
+}
+
+TEST_F(TaskQueuePriorityTest, IdleWaitsForDueDelayedTasks) {
+    record("idle", Priority::kIdle);
+    queue_->postDelayedTask([this]{
+        std::lock_guard<std::mutex> lock(mutex_);
+        order_.push_back("delayed");
+    }, 1);
+    // Let the delayed task become due before the worker is released.
+    vi::Event().wait(10);
+
+    std::vector<std::string> expected = {"delayed", "idle"};
+    EXPECT_EQ(runAll(), expected);
+}
+
+TEST_F(TaskQueuePriorityTest, IdleRunsWhileTimerIsArmed) {
+    record("idle", Priority::kIdle);
+    queue_->postDelayedTask([]{}, 60 * 1000);
+
+    std::vector<std::string> expected = {"idle"};
+    EXPECT_EQ(runAll(), expected);
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include "utoolkit/task_queue/event.h"
+#include "utoolkit/task_queue/task_queue.h"
+#include "utoolkit/task_queue/task_queue_base.h"
+#include "utoolkit/task_queue/task_queue_manager.h"
+#include "utoolkit/task_queue/task_queue_stats.h"
+
+TEST(HistogramTest, BucketsAndPercentiles) {
+    vi::Histogram histogram;
+    for (int i = 0; i < 99; ++i) {
+        histogram.record(3);
+    }
+    histogram.record(1000);
+
+    auto s = histogram.snapshot();
+    EXPECT_EQ(s.count, 100u);
+    EXPECT_EQ(s.sum, 99u * 3 + 1000);
+    EXPECT_EQ(s.max, 1000u);
+    EXPECT_EQ(s.buckets[vi::Histogram::bucketIndex(3)], 99u);
+    EXPECT_EQ(s.percentile(50), 3u);
+    EXPECT_EQ(s.percentile(100), 1000u);
+
+    EXPECT_EQ(vi::Histogram::bucketIndex(0), 0);
+    EXPECT_EQ(vi::Histogram::bucketIndex(1), 1);
+    EXPECT_EQ(vi::Histogram::bucketIndex(UINT64_MAX), vi::HistogramSnapshot::kBucketCount - 1);
+}
+
+#if UT_TASK_QUEUE_STATS
+
+TEST(TaskQueueStatsTest, CountsTasks) {
+    auto tq = vi::TaskQueue::create("stats_counts");
+
+    vi::Event done;
+    for (int i = 0; i < 10; ++i) {
+        tq->postTask([]{});
+    }
+    tq->postDelayedTask([&done]{ done.set(); }, 5);
+    ASSERT_TRUE(done.wait(1000));
+
+    // The last task may still be accounting for itself.
+    vi::TaskQueueStats s;
+    for (int i = 0; i < 100; ++i) {
+        s = tq->get()->stats();
+        if (s.executed_tasks == 11) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    EXPECT_EQ(s.name, "stats_counts");
+    EXPECT_EQ(s.posted_tasks, 11u);
+    EXPECT_EQ(s.delayed_tasks, 1u);
+    EXPECT_EQ(s.executed_tasks, 11u);
+    EXPECT_EQ(s.pending_tasks, 0u);
+    EXPECT_EQ(s.queue_latency_us.count, 11u);
+    EXPECT_EQ(s.run_time_us.count, 11u);
+}
+
+TEST(TaskQueueStatsTest, WatchdogReportsPostingSite) {
+    TQMgr->create({"stats_watchdog"});
+
+    std::atomic<bool> reported {false};
+    vi::TaskQueueStats report;
+    vi::Event reportReady;
+    TQMgr->startWatchdog(20, [&](const vi::TaskQueueStats& s) {
+        if (s.name == "stats_watchdog" && !reported.exchange(true)) {
+            report = s;
+            reportReady.set();
+        }
+    });
+
+    // The queue outlives the test, and so may the task still waking up.
+    auto release = std::make_shared<vi::Event>();
+    const int line = __LINE__ + 1;
+    TQ("stats_watchdog")->postTask([release]{ release->wait(2000); });
+
+    EXPECT_TRUE(reportReady.wait(2000));
+    release->set();
+    TQMgr->stopWatchdog();
+
+    ASSERT_TRUE(reported.load());
+    EXPECT_NE(report.running_task_id, 0u);
+    EXPECT_GE(report.running_for_us, 20000u);
+    EXPECT_EQ(report.running_task.line(), line);
+    EXPECT_NE(strstr(report.running_task.file(), "test_task_queue_stats.cpp"), nullptr);
+}
+
+TEST(TaskQueueStatsTest, SlowTaskIsRecorded) {
+    auto tq = vi::TaskQueue::create("stats_slow");
+    vi::TaskQueueMetrics::setSlowTaskThreshold(5);
+
+    vi::Event done;
+    tq->postTask([]{ std::this_thread::sleep_for(std::chrono::milliseconds(10)); });
+    tq->postTask([&done]{ done.set(); });
+    ASSERT_TRUE(done.wait(1000));
+    vi::TaskQueueMetrics::setSlowTaskThreshold(0);
+
+    auto s = tq->get()->stats();
+    EXPECT_EQ(s.slow_tasks, 1u);
+    EXPECT_GE(s.last_slow_task_us, 5000u);
+    EXPECT_TRUE(s.last_slow_task.isValid());
+}
+
+TEST(TaskQueueStatsTest, ManagerSnapshot) {
+    TQMgr->create({"stats_snapshot"});
+    // Shared for the same reason as in WatchdogReportsPostingSite.
+    auto done = std::make_shared<vi::Event>();
+    TQ("stats_snapshot")->postTask([done]{ done->set(); });
+    ASSERT_TRUE(done->wait(1000));
+
+    bool found = false;
+    for (const auto& s : TQMgr->stats()) {
+        if (s.name == "stats_snapshot") {
+            found = true;
+            EXPECT_EQ(s.posted_tasks, 1u);
+            EXPECT_FALSE(s.toString().empty());
+        }
+    }
+    EXPECT_TRUE(found);
+}
+
+#endif
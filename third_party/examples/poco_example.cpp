@@ -1,4 +1,8 @@
 #include <iostream>
+#include <sstream>
+
+#ifdef UTOOLKIT_ENABLE_POCO
+
 #include <Poco/Version.h>
 #include <Poco/DateTime.h>
 #include <Poco/DateTimeFormatter.h>
@@ -8,9 +12,6 @@
 #include <Poco/StreamCopier.h>
 #include <Poco/Path.h>
 #include <Poco/File.h>
-#include <sstream>
-
-#ifdef UTOOLKIT_ENABLE_POCO
 
 void demonstrate_poco_version() {
     std::cout << "=== POCO Version Information ===" << std::endl;
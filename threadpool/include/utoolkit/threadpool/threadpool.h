@@ -8,6 +8,7 @@
 #include <functional>
 #include <future>
 #include <memory>
+#include <utoolkit/trace/tracer.h>
 
 namespace utoolkit {
 namespace threadpool {
@@ -51,6 +52,7 @@ auto ThreadPool::enqueue(F&& f, Args&&... args)
     );
     
     std::future<return_type> result = task->get_future();
+    const int64_t trace_start = UT_TRACE_ENABLED() ? trace::Tracer::now_ns() : 0;
     {
         std::unique_lock<std::mutex> lock(queue_mutex_);
         
@@ -58,7 +60,19 @@ auto ThreadPool::enqueue(F&& f, Args&&... args)
             throw std::runtime_error("ThreadPool is stopped");
         }
         
-        tasks_.emplace([task]() { (*task)(); });
+        if (trace_start == 0) {
+            tasks_.emplace([task]() { (*task)(); });
+        } else {
+            const uint64_t flow_id = trace::Tracer::next_flow_id();
+            tasks_.emplace([task, flow_id]() {
+                const int64_t start = trace::Tracer::now_ns();
+                trace::Tracer::flow_end("threadpool", "task", flow_id, start);
+                (*task)();
+                trace::Tracer::complete("threadpool", "Task", start, trace::Tracer::now_ns());
+            });
+            trace::Tracer::complete("threadpool", "Enqueue", trace_start, trace::Tracer::now_ns());
+            trace::Tracer::flow_start("threadpool", "task", flow_id, trace_start);
+        }
     }
     condition_.notify_one();
     return result;
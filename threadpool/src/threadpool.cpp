@@ -1,5 +1,6 @@
 #include <utoolkit/threadpool/threadpool.h>
 #include <stdexcept>
+#include <string>
 
 namespace utoolkit {
 namespace threadpool {
@@ -11,7 +12,10 @@ ThreadPool::ThreadPool(size_t num_threads) : stop_(false), thread_count_(num_thr
     }
     
     for (size_t i = 0; i < thread_count_; ++i) {
-        workers_.emplace_back([this] { worker_thread(); });
+        workers_.emplace_back([this, i] {
+            trace::Tracer::set_thread_name("ThreadPool worker " + std::to_string(i));
+            worker_thread();
+        });
     }
 }
 
@@ -0,0 +1,41 @@
+#include <utoolkit/trace/tracer.h>
+#include <utoolkit/threadpool/threadpool.h>
+#include "utoolkit/task_queue/event.h"
+#include "utoolkit/task_queue/task_queue.h"
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+using namespace utoolkit::trace;
+
+int main() {
+    std::cout << "=== Tracer Example ===" << std::endl;
+
+    Tracer::set_thread_name("main");
+    Tracer::start();
+
+    auto queue = vi::TaskQueue::create("pipeline");
+    utoolkit::threadpool::ThreadPool pool(2);
+
+    vi::Event done;
+    for (int i = 0; i < 5; ++i) {
+        UT_TRACE_SCOPE("example", "produce");
+        queue->postTask([&pool, i]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            pool.enqueue([i]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                return i;
+            });
+        });
+    }
+    queue->postDelayedTask([&done]() { done.set(); }, 20);
+    done.wait(vi::Event::kForever);
+    pool.shutdown();
+
+    Tracer::stop();
+    if (Tracer::write_json("example_trace.json")) {
+        std::cout << "Trace written to example_trace.json, open it in ui.perfetto.dev" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace utoolkit {
+namespace trace {
+
+// A single recorded event. All strings must have static storage duration.
+struct TraceEvent {
+    char phase;             // 'X' complete, 's' flow start, 'f' flow end, 'i' instant
+    const char* category;
+    const char* name;
+    const char* file;
+    int line;
+    int64_t ts_ns;
+    int64_t dur_ns;
+    uint64_t id;            // flow id for 's' and 'f'
+};
+
+// Opt-in timeline tracer that writes Chrome Trace Event JSON, viewable in
+// chrome://tracing or ui.perfetto.dev.
+//
+// Every thread records into its own fixed-size buffer without locking; a full
+// buffer drops further events and counts them. Buffers outlive their threads so
+// that their events can still be written; once they have been written or
+// cleared, the buffer of a finished thread is reused by the next thread that
+// records. Tracing is off by default and every instrumentation point is
+// guarded by enabled(), a single relaxed load, so the disabled cost is one
+// predictable branch.
+//
+// Typical use:
+//
+//     Tracer::start();
+//     ... run the workload ...
+//     Tracer::stop();
+//     Tracer::write_json("trace.json");
+class Tracer {
+public:
+    static constexpr size_t kDefaultEventsPerThread = 1 << 15;
+
+    // Starts recording. |events_per_thread| applies to buffers of threads that
+    // have not recorded anything yet.
+    static void start(size_t events_per_thread = kDefaultEventsPerThread);
+    static void stop();
+
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    // Names the calling thread in the trace.
+    static void set_thread_name(const std::string& name);
+
+    // Monotonic timestamp in nanoseconds.
+    static int64_t now_ns();
+
+    // Returns a process-unique id to link a flow start with its end.
+    static uint64_t next_flow_id();
+
+    // Recording functions. Callers are expected to check enabled() first.
+    static void complete(const char* category, const char* name, int64_t start_ns, int64_t end_ns,
+                         const char* file = nullptr, int line = 0);
+    static void instant(const char* category, const char* name, const char* file = nullptr, int line = 0);
+    static void flow_start(const char* category, const char* name, uint64_t id, int64_t ts_ns);
+    static void flow_end(const char* category, const char* name, uint64_t id, int64_t ts_ns);
+
+    // Writes all recorded events as Chrome Trace Event JSON. Intended to be
+    // called after stop(); events recorded concurrently may be missed.
+    static bool write_json(const std::string& filename);
+
+    // Discards all recorded events. Must not race with recording threads.
+    static void clear();
+
+    static uint64_t dropped_events();
+
+private:
+    static std::atomic<bool> enabled_;
+};
+
+// Records a complete event covering the enclosing scope.
+class ScopedTrace {
+public:
+    ScopedTrace(const char* category, const char* name, const char* file = nullptr, int line = 0)
+        : category_(category), name_(name), file_(file), line_(line),
+          start_ns_(Tracer::enabled() ? Tracer::now_ns() : 0) {}
+
+    ~ScopedTrace() {
+        if (start_ns_ != 0) {
+            Tracer::complete(category_, name_, start_ns_, Tracer::now_ns(), file_, line_);
+        }
+    }
+
+    ScopedTrace(const ScopedTrace&) = delete;
+    ScopedTrace& operator=(const ScopedTrace&) = delete;
+
+private:
+    const char* category_;
+    const char* name_;
+    const char* file_;
+    int line_;
+    int64_t start_ns_;
+};
+
+#define UT_TRACE_ENABLED() (utoolkit::trace::Tracer::enabled())
+#define UT_TRACE_CONCAT_INNER(a, b) a##b
+#define UT_TRACE_CONCAT(a, b) UT_TRACE_CONCAT_INNER(a, b)
+#define UT_TRACE_SCOPE(category, name) \
+    utoolkit::trace::ScopedTrace UT_TRACE_CONCAT(ut_trace_scope_, __LINE__)(category, name, __FILE__, __LINE__)
+
+} // namespace trace
+} // namespace utoolkit
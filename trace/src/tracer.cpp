@@ -0,0 +1,302 @@
+#include <utoolkit/trace/tracer.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace utoolkit {
+namespace trace {
+
+namespace {
+
+// Single producer buffer. Readers only look at events below size.
+struct ThreadBuffer {
+    ThreadBuffer(size_t capacity, uint64_t tid)
+        : events(new TraceEvent[capacity]), capacity(capacity), tid(tid) {}
+
+    std::unique_ptr<TraceEvent[]> events;
+    const size_t capacity;
+    uint64_t tid;
+    std::atomic<size_t> size {0};
+    std::atomic<uint64_t> dropped {0};
+    std::string thread_name;
+
+    // Guarded by the registry mutex. A buffer no thread owns any more can be
+    // reused once every event in it has been written or cleared.
+    bool in_use = true;
+    size_t written = 0;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    size_t events_per_thread = Tracer::kDefaultEventsPerThread;
+    uint64_t next_tid = 1;
+    // Dropped events of buffers that have been reused since.
+    uint64_t retired_dropped = 0;
+};
+
+Registry& registry() {
+    // Leaked on purpose: threads may record while static destructors run.
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+std::atomic<uint64_t> g_next_flow_id {1};
+
+// Gives the buffer of a thread back when the thread exits.
+struct BufferOwner {
+    ThreadBuffer* buffer = nullptr;
+
+    ~BufferOwner() {
+        if (buffer != nullptr) {
+            std::lock_guard<std::mutex> lock(registry().mutex);
+            buffer->in_use = false;
+        }
+    }
+};
+
+thread_local BufferOwner t_owner;
+thread_local std::string t_thread_name;
+
+// Takes a buffer of a finished thread whose events are no longer needed, or
+// a new one. Buffers of another size, from before start() changed it, are
+// freed instead. Called with the registry mutex held.
+ThreadBuffer* acquire_buffer(Registry& reg) {
+    ThreadBuffer* reused = nullptr;
+    for (auto it = reg.buffers.begin(); it != reg.buffers.end();) {
+        ThreadBuffer& buffer = **it;
+        if (buffer.in_use || buffer.written < buffer.size.load(std::memory_order_relaxed)) {
+            ++it;
+        } else if (reused == nullptr && buffer.capacity == reg.events_per_thread) {
+            reused = &buffer;
+            ++it;
+        } else {
+            reg.retired_dropped += buffer.dropped.load(std::memory_order_relaxed);
+            it = reg.buffers.erase(it);
+        }
+    }
+
+    if (reused == nullptr) {
+        reg.buffers.push_back(std::make_unique<ThreadBuffer>(reg.events_per_thread, reg.next_tid++));
+        return reg.buffers.back().get();
+    }
+    reg.retired_dropped += reused->dropped.load(std::memory_order_relaxed);
+    reused->dropped.store(0, std::memory_order_relaxed);
+    reused->size.store(0, std::memory_order_relaxed);
+    reused->written = 0;
+    reused->in_use = true;
+    // A new row in the trace, not the one of the finished thread.
+    reused->tid = reg.next_tid++;
+    return reused;
+}
+
+ThreadBuffer* thread_buffer() {
+    if (t_owner.buffer == nullptr) {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        t_owner.buffer = acquire_buffer(reg);
+        t_owner.buffer->thread_name = t_thread_name;
+    }
+    return t_owner.buffer;
+}
+
+void record(const TraceEvent& event) {
+    ThreadBuffer* buffer = thread_buffer();
+    size_t index = buffer->size.load(std::memory_order_relaxed);
+    if (index >= buffer->capacity) {
+        buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer->events[index] = event;
+    buffer->size.store(index + 1, std::memory_order_release);
+}
+
+void write_escaped(std::ostream& out, const char* str) {
+    out << '"';
+    for (const char* p = str ? str : ""; *p; ++p) {
+        char c = *p;
+        switch (c) {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out << buf;
+                } else {
+                    out << c;
+                }
+        }
+    }
+    out << '"';
+}
+
+// Chrome expects microseconds; keep nanosecond precision as decimals.
+void write_us(std::ostream& out, int64_t ns) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%lld.%03lld",
+                  static_cast<long long>(ns / 1000), static_cast<long long>(ns % 1000));
+    out << buf;
+}
+
+int process_id() {
+#ifdef _WIN32
+    return _getpid();
+#else
+    return static_cast<int>(getpid());
+#endif
+}
+
+} // namespace
+
+std::atomic<bool> Tracer::enabled_ {false};
+
+void Tracer::start(size_t events_per_thread) {
+    {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.events_per_thread = events_per_thread > 0 ? events_per_thread : kDefaultEventsPerThread;
+    }
+    enabled_.store(true, std::memory_order_release);
+}
+
+void Tracer::stop() {
+    enabled_.store(false, std::memory_order_release);
+}
+
+void Tracer::set_thread_name(const std::string& name) {
+    t_thread_name = name;
+    if (t_owner.buffer != nullptr) {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        t_owner.buffer->thread_name = name;
+    }
+}
+
+int64_t Tracer::now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t Tracer::next_flow_id() {
+    return g_next_flow_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Tracer::complete(const char* category, const char* name, int64_t start_ns, int64_t end_ns,
+                      const char* file, int line) {
+    record(TraceEvent{'X', category, name, file, line, start_ns, end_ns - start_ns, 0});
+}
+
+void Tracer::instant(const char* category, const char* name, const char* file, int line) {
+    record(TraceEvent{'i', category, name, file, line, now_ns(), 0, 0});
+}
+
+void Tracer::flow_start(const char* category, const char* name, uint64_t id, int64_t ts_ns) {
+    record(TraceEvent{'s', category, name, nullptr, 0, ts_ns, 0, id});
+}
+
+void Tracer::flow_end(const char* category, const char* name, uint64_t id, int64_t ts_ns) {
+    record(TraceEvent{'f', category, name, nullptr, 0, ts_ns, 0, id});
+}
+
+bool Tracer::write_json(const std::string& filename) {
+    std::ofstream out(filename, std::ios::trunc);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    const int pid = process_id();
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&]() {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    for (const auto& buffer : reg.buffers) {
+        if (!buffer->thread_name.empty()) {
+            separator();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+                << ",\"tid\":" << buffer->tid << ",\"args\":{\"name\":";
+            write_escaped(out, buffer->thread_name.c_str());
+            out << "}}";
+        }
+
+        const size_t size = buffer->size.load(std::memory_order_acquire);
+        buffer->written = size;
+        for (size_t i = 0; i < size; ++i) {
+            const TraceEvent& e = buffer->events[i];
+            separator();
+            out << "{\"name\":";
+            write_escaped(out, e.name);
+            out << ",\"cat\":";
+            write_escaped(out, e.category);
+            out << ",\"ph\":\"" << e.phase << "\",\"ts\":";
+            write_us(out, e.ts_ns);
+            out << ",\"pid\":" << pid << ",\"tid\":" << buffer->tid;
+            switch (e.phase) {
+                case 'X':
+                    out << ",\"dur\":";
+                    write_us(out, e.dur_ns);
+                    break;
+                case 'i':
+                    out << ",\"s\":\"t\"";
+                    break;
+                case 's':
+                    out << ",\"id\":" << e.id;
+                    break;
+                case 'f':
+                    out << ",\"id\":" << e.id << ",\"bp\":\"e\"";
+                    break;
+                default:
+                    break;
+            }
+            if (e.file != nullptr) {
+                out << ",\"args\":{\"file\":";
+                write_escaped(out, e.file);
+                out << ",\"line\":" << e.line << "}";
+            }
+            out << "}";
+        }
+    }
+
+    out << "\n]}\n";
+    return out.good();
+}
+
+void Tracer::clear() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (auto& buffer : reg.buffers) {
+        buffer->size.store(0, std::memory_order_relaxed);
+        buffer->dropped.store(0, std::memory_order_relaxed);
+        buffer->written = 0;
+    }
+    reg.retired_dropped = 0;
+}
+
+uint64_t Tracer::dropped_events() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    uint64_t total = reg.retired_dropped;
+    for (const auto& buffer : reg.buffers) {
+        total += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+} // namespace trace
+} // namespace utoolkit
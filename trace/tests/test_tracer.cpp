@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include <utoolkit/trace/tracer.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace utoolkit::trace;
+
+namespace {
+
+std::string read_all(const std::string& filename) {
+    std::ifstream in(filename);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+size_t count(const std::string& text, const std::string& needle) {
+    size_t n = 0;
+    for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) {
+        ++n;
+    }
+    return n;
+}
+
+} // namespace
+
+class TracerTest : public ::testing::Test {
+protected:
+    void SetUp() override { Tracer::clear(); }
+    void TearDown() override {
+        Tracer::stop();
+        Tracer::clear();
+    }
+};
+
+TEST_F(TracerTest, DisabledRecordsNothing) {
+    EXPECT_FALSE(Tracer::enabled());
+    {
+        UT_TRACE_SCOPE("test", "ignored");
+    }
+    ASSERT_TRUE(Tracer::write_json("tracer_disabled.json"));
+    EXPECT_EQ(count(read_all("tracer_disabled.json"), "\"ignored\""), 0u);
+}
+
+TEST_F(TracerTest, WritesCompleteAndFlowEvents) {
+    Tracer::set_thread_name("tracer \"main\"");
+    Tracer::start();
+
+    const uint64_t id = Tracer::next_flow_id();
+    {
+        UT_TRACE_SCOPE("test", "post");
+        Tracer::flow_start("test", "flow", id, Tracer::now_ns());
+    }
+    std::thread worker([id] {
+        Tracer::set_thread_name("worker");
+        const int64_t start = Tracer::now_ns();
+        Tracer::flow_end("test", "flow", id, start);
+        Tracer::complete("test", "run", start, Tracer::now_ns(), "file.cpp", 42);
+    });
+    worker.join();
+    Tracer::stop();
+
+    ASSERT_TRUE(Tracer::write_json("tracer_flow.json"));
+    const std::string json = read_all("tracer_flow.json");
+    EXPECT_EQ(json.front(), '{');
+    EXPECT_EQ(count(json, "\"ph\":\"X\""), 2u);
+    EXPECT_EQ(count(json, "\"ph\":\"s\""), 1u);
+    EXPECT_EQ(count(json, "\"ph\":\"f\""), 1u);
+    EXPECT_EQ(count(json, "\"id\":" + std::to_string(id)), 2u);
+    EXPECT_NE(json.find("\"line\":42"), std::string::npos);
+    EXPECT_NE(json.find("tracer \\\"main\\\""), std::string::npos);
+    EXPECT_NE(json.find("\"worker\""), std::string::npos);
+}
+
+TEST_F(TracerTest, ReusesBuffersOfFinishedThreads) {
+    Tracer::start();
+    for (int i = 0; i < 10; ++i) {
+        std::thread worker([] {
+            Tracer::set_thread_name("short-lived");
+            Tracer::instant("test", "tick");
+        });
+        worker.join();
+        ASSERT_TRUE(Tracer::write_json("tracer_reuse.json"));
+    }
+    Tracer::stop();
+
+    // Every thread after the first takes a buffer already written out
+    // instead of adding one; another left over from an earlier test may be
+    // taken first.
+    const std::string json = read_all("tracer_reuse.json");
+    EXPECT_GE(count(json, "\"tick\""), 1u);
+    EXPECT_LE(count(json, "\"tick\""), 2u);
+    EXPECT_LE(count(json, "\"short-lived\""), 2u);
+}
+
+TEST_F(TracerTest, KeepsUnwrittenEventsOfFinishedThreads) {
+    Tracer::start();
+    std::thread first([] { Tracer::instant("test", "first"); });
+    first.join();
+    std::thread second([] { Tracer::instant("test", "second"); });
+    second.join();
+    Tracer::stop();
+
+    ASSERT_TRUE(Tracer::write_json("tracer_keep.json"));
+    const std::string json = read_all("tracer_keep.json");
+    EXPECT_EQ(count(json, "\"first\""), 1u);
+    EXPECT_EQ(count(json, "\"second\""), 1u);
+}
+
+TEST_F(TracerTest, FullBufferDropsEvents) {
+    std::thread worker([] {
+        Tracer::start(4);
+        for (int i = 0; i < 10; ++i) {
+            Tracer::instant("test", "tick");
+        }
+    });
+    worker.join();
+    Tracer::stop();
+
+    EXPECT_EQ(Tracer::dropped_events(), 6u);
+}
@@ -0,0 +1,408 @@
+#include <utoolkit/utils/string_builder.h>
+#include <utoolkit/utils/string_utils.h>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#ifdef HAVE_BENCHMARK
+#include <benchmark/benchmark.h>
+#endif
+
+using namespace utoolkit::utils;
+
+#ifdef HAVE_BENCHMARK
+namespace {
+
+// 16个字段的CSV行，Arg为每个字段的长度
+std::string make_line(size_t field_length, const std::string& delimiter) {
+    std::string line;
+    for (int i = 0; i < 16; ++i) {
+        if (i != 0) {
+            line += delimiter;
+        }
+        line += std::string(field_length, static_cast<char>('a' + i));
+    }
+    return line;
+}
+
+}
+
+// 基准：现有split(char)，stringstream + getline，每个字段一个std::string
+static void BM_SplitChar(benchmark::State& state) {
+    const std::string line = make_line(static_cast<size_t>(state.range(0)), ",");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(StringUtils::split(line, ','));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * line.size()));
+}
+
+// 基准：现有split(string)，find + substr
+static void BM_SplitString(benchmark::State& state) {
+    const std::string line = make_line(static_cast<size_t>(state.range(0)), "::");
+    const std::string delimiter = "::";
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(StringUtils::split(line, delimiter));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * line.size()));
+}
+
+// 基准：惰性split_view逐个访问字段，不分配内存
+static void BM_SplitView(benchmark::State& state) {
+    const std::string line = make_line(static_cast<size_t>(state.range(0)), ",");
+    for (auto _ : state) {
+        size_t total = 0;
+        for (std::string_view field : StringUtils::split_view(line, ',')) {
+            total += field.size();
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * line.size()));
+}
+
+// 基准：split_into复用调用方的vector
+// Arg 1：字段长度；Arg 2：0为单字符分隔符，1为"::"
+static void BM_SplitInto(benchmark::State& state) {
+    const bool by_string = state.range(1) != 0;
+    const std::string line = make_line(static_cast<size_t>(state.range(0)), by_string ? "::" : ",");
+    std::vector<std::string_view> fields;
+    for (auto _ : state) {
+        if (by_string) {
+            StringUtils::split_into(fields, line, "::");
+        } else {
+            StringUtils::split_into(fields, line, ',');
+        }
+        benchmark::DoNotOptimize(fields.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * line.size()));
+}
+
+namespace {
+
+// |length|字节的随机小写文本，模式串只出现在末尾
+std::string make_text(size_t length, const std::string& needle) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::string text(length - needle.size(), ' ');
+    for (char& c : text) {
+        c = static_cast<char>(letter(rng));
+    }
+    return text + needle;
+}
+
+const std::string kNeedle = "needle_in_text";
+
+}
+
+// 基准：子串查找，Arg 0为文本长度
+// Arg 1：0为std::string::find，1起依次为find_implementations()中的实现（avx2/sse2/scalar）
+static void BM_Find(benchmark::State& state) {
+    const std::string text = make_text(static_cast<size_t>(state.range(0)), kNeedle);
+    const auto implementations = utoolkit::utils::detail::find_implementations();
+    const int64_t choice = state.range(1);
+    if (choice > static_cast<int64_t>(implementations.size())) {
+        state.SkipWithError("implementation not supported");
+        return;
+    }
+    if (choice > 0) {
+        state.SetLabel(implementations[static_cast<size_t>(choice - 1)].name);
+    }
+    for (auto _ : state) {
+        size_t found;
+        if (choice == 0) {
+            found = text.find(kNeedle);
+        } else {
+            found = implementations[static_cast<size_t>(choice - 1)].find(text.data(), text.size(), kNeedle.data(),
+                                                                           kNeedle.size());
+        }
+        benchmark::DoNotOptimize(found);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+
+// 原replace_all：每次匹配都在结果上原地replace，移动整个尾部
+static std::string replace_all_in_place(const std::string& str, const std::string& from, const std::string& to) {
+    std::string result = str;
+    size_t start_pos = 0;
+    while ((start_pos = result.find(from, start_pos)) != std::string::npos) {
+        result.replace(start_pos, from.length(), to);
+        start_pos += to.length();
+    }
+    return result;
+}
+
+// 基准：替换64KB文本中每行的分隔符，每80字节一处"\r\n"替换为"\n"
+// Arg 0：原地替换；Arg 1：StringUtils::replace_all（先计数，一次分配）
+static void BM_ReplaceAll(benchmark::State& state) {
+    std::string text;
+    while (text.size() < 64 * 1024) {
+        text += std::string(78, 'x') + "\r\n";
+    }
+    for (auto _ : state) {
+        if (state.range(0) == 0) {
+            benchmark::DoNotOptimize(replace_all_in_place(text, "\r\n", "\n"));
+        } else {
+            benchmark::DoNotOptimize(StringUtils::replace_all(text, "\r\n", "\n"));
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+
+// 原is_integer/is_float：std::stoi/std::stod + try/catch，非法输入走异常
+static bool is_integer_with_exceptions(const std::string& str) {
+    try {
+        size_t pos;
+        std::stoi(str, &pos);
+        return pos == str.length();
+    } catch (...) {
+        return false;
+    }
+}
+
+static bool is_float_with_exceptions(const std::string& str) {
+    try {
+        size_t pos;
+        std::stod(str, &pos);
+        return pos == str.length();
+    } catch (...) {
+        return false;
+    }
+}
+
+// 基准：校验整数，Arg 0：0为合法输入，1为非法输入（首字符非法，stoi抛异常）；Arg 1：0为stoi+异常，1为parse<int>
+static void BM_ParseInt(benchmark::State& state) {
+    const std::string input = state.range(0) == 0 ? "1234567" : "x1234567";
+    const bool with_exceptions = state.range(1) == 0;
+    for (auto _ : state) {
+        if (with_exceptions) {
+            benchmark::DoNotOptimize(is_integer_with_exceptions(input));
+        } else {
+            benchmark::DoNotOptimize(StringUtils::parse<int>(input));
+        }
+    }
+}
+
+// 基准：校验浮点数，参数含义同BM_ParseInt，1为parse<double>
+static void BM_ParseDouble(benchmark::State& state) {
+    const std::string input = state.range(0) == 0 ? "-12345.6789e-3" : "x12345.6789e-3";
+    const bool with_exceptions = state.range(1) == 0;
+    for (auto _ : state) {
+        if (with_exceptions) {
+            benchmark::DoNotOptimize(is_float_with_exceptions(input));
+        } else {
+            benchmark::DoNotOptimize(StringUtils::parse<double>(input));
+        }
+    }
+}
+
+// 基准：长数字串（19位），Arg 0为std::from_chars，Arg 1为parse<uint64_t>（每8位一次SWAR转换）
+static void BM_ParseLongDigits(benchmark::State& state) {
+    const std::string input = "1234567890123456789";
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(input.data());
+        if (state.range(0) == 0) {
+            uint64_t value = 0;
+            std::from_chars(input.data(), input.data() + input.size(), value);
+            benchmark::DoNotOptimize(value);
+        } else {
+            benchmark::DoNotOptimize(StringUtils::parse<uint64_t>(input));
+        }
+    }
+}
+
+// 原from_double：stringstream + setprecision，再去掉末尾的0
+static std::string from_double_with_stream(double value, int precision) {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(precision) << value;
+    std::string result = ss.str();
+    result.erase(result.find_last_not_of('0') + 1, std::string::npos);
+    if (result.back() == '.') {
+        result.pop_back();
+    }
+    return result;
+}
+
+// 基准：序列化一行指标（4个整数 + 4个浮点数，逗号分隔）
+// Arg 0：std::to_string + stringstream拼接（原实现）；Arg 1：append_int/append_double写入复用的字符串
+static void BM_FormatNumbers(benchmark::State& state) {
+    const int64_t ints[] = {42, -1234567, 9876543210LL, 7};
+    const double doubles[] = {3.25, 0.001, 12345.678, -2.5};
+    std::string line;
+    for (auto _ : state) {
+        line.clear();
+        if (state.range(0) == 0) {
+            for (int64_t value : ints) {
+                line += std::to_string(value);
+                line += ',';
+            }
+            for (double value : doubles) {
+                line += from_double_with_stream(value, 3);
+                line += ',';
+            }
+        } else {
+            for (int64_t value : ints) {
+                StringUtils::append_int(line, value);
+                line += ',';
+            }
+            for (double value : doubles) {
+                StringUtils::append_double(line, value, 3);
+                line += ',';
+            }
+        }
+        benchmark::DoNotOptimize(line.data());
+    }
+}
+
+// 基准：最短往返表示的浮点数，Arg 0：std::to_string（固定6位小数）；Arg 1：append_double
+static void BM_FormatShortestDouble(benchmark::State& state) {
+    const double value = 12345.678;
+    std::string line;
+    for (auto _ : state) {
+        line.clear();
+        if (state.range(0) == 0) {
+            line += std::to_string(value);
+        } else {
+            StringUtils::append_double(line, value);
+        }
+        benchmark::DoNotOptimize(line.data());
+    }
+}
+
+// 原join：逐个追加，不预留空间
+static std::string join_without_reserve(const std::vector<std::string>& parts, const std::string& delimiter) {
+    std::string result;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        if (i != 0) {
+            result += delimiter;
+        }
+        result += parts[i];
+    }
+    return result;
+}
+
+// 基准：拼接64个32字节的字段，Arg 0：原join；Arg 1：先算总长度的join
+static void BM_Join(benchmark::State& state) {
+    const std::vector<std::string> parts(64, std::string(32, 'j'));
+    const std::string delimiter = ", ";
+    for (auto _ : state) {
+        if (state.range(0) == 0) {
+            benchmark::DoNotOptimize(join_without_reserve(parts, delimiter));
+        } else {
+            benchmark::DoNotOptimize(StringUtils::join(parts, delimiter));
+        }
+    }
+}
+
+// 基准：构造一条约200字节的响应
+// Arg 0：std::string临时拼接；Arg 1：复用的StringBuilder（不分配内存）
+static void BM_BuildResponse(benchmark::State& state) {
+    const std::vector<std::string> tags = {"alpha", "beta", "gamma", "delta"};
+    const std::string user = "someone@example.com";
+    StringBuilder builder;
+    for (auto _ : state) {
+        if (state.range(0) == 0) {
+            std::string out = "{\"user\":\"" + user + "\",\"id\":" + std::to_string(123456) +
+                              ",\"score\":" + std::to_string(0.75) + ",\"tags\":\"" +
+                              join_without_reserve(tags, ",") + "\",\"status\":" + StringUtils::pad_left("7", 3, '0') +
+                              "}";
+            benchmark::DoNotOptimize(out.data());
+        } else {
+            builder.reset();
+            builder.append("{\"user\":\"").append(user).append("\",\"id\":").append_int(123456);
+            builder.append(",\"score\":").append_double(0.75).append(",\"tags\":\"").append_join(tags, ",");
+            builder.append("\",\"status\":").append(2, '0').append('7').append('}');
+            benchmark::DoNotOptimize(builder.data());
+        }
+    }
+}
+
+// 原to_lower：复制后逐字节调用依赖locale的::tolower
+static std::string to_lower_with_locale(const std::string& str) {
+    std::string result = str;
+    std::transform(result.begin(), result.end(), result.begin(), ::tolower);
+    return result;
+}
+
+// 基准：转小写，Arg 0为长度
+// Arg 1：0为原to_lower；1起依次为case_implementations()中的实现（avx2/sse2/swar）
+static void BM_ToLower(benchmark::State& state) {
+    std::string text = make_text(static_cast<size_t>(state.range(0)), "");
+    std::transform(text.begin(), text.end(), text.begin(), [](char c) { return c < 'n' ? c - 'a' + 'A' : c; });
+    const auto implementations = utoolkit::utils::detail::case_implementations();
+    const int64_t choice = state.range(1);
+    if (choice > static_cast<int64_t>(implementations.size())) {
+        state.SkipWithError("implementation not supported");
+        return;
+    }
+    if (choice > 0) {
+        state.SetLabel(implementations[static_cast<size_t>(choice - 1)].name);
+    }
+    std::string buffer = text;
+    for (auto _ : state) {
+        if (choice == 0) {
+            benchmark::DoNotOptimize(to_lower_with_locale(text));
+        } else {
+            implementations[static_cast<size_t>(choice - 1)].to_lower(text.data(), buffer.data(), text.size());
+            benchmark::DoNotOptimize(buffer.data());
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+
+// 基准：按名字不区分大小写查找HTTP头，每次迭代查找8个
+// Arg 0：to_lower后在小写键的map中查找；Arg 1：CaseInsensitiveHash/CaseInsensitiveEqual的map，不分配内存
+static void BM_HeaderLookup(benchmark::State& state) {
+    const std::vector<std::string> names = {"Host", "User-Agent", "Accept", "Accept-Encoding", "Content-Type",
+                                            "Content-Length", "X-Forwarded-For", "X-Request-ID"};
+    const std::vector<std::string> requested = {"host", "USER-AGENT", "Accept", "accept-encoding", "Content-type",
+                                                "CONTENT-LENGTH", "x-forwarded-for", "X-Request-Id"};
+    std::unordered_map<std::string, int> lowered;
+    std::unordered_map<std::string, int, CaseInsensitiveHash, CaseInsensitiveEqual> insensitive;
+    for (size_t i = 0; i < names.size(); ++i) {
+        lowered[StringUtils::to_lower(names[i])] = static_cast<int>(i);
+        insensitive[names[i]] = static_cast<int>(i);
+    }
+    for (auto _ : state) {
+        int sum = 0;
+        for (const auto& name : requested) {
+            if (state.range(0) == 0) {
+                sum += lowered.find(to_lower_with_locale(name))->second;
+            } else {
+                sum += insensitive.find(name)->second;
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+
+BENCHMARK(BM_SplitChar)->Arg(8)->Arg(64);
+BENCHMARK(BM_SplitString)->Arg(8)->Arg(64);
+BENCHMARK(BM_SplitView)->Arg(8)->Arg(64);
+BENCHMARK(BM_SplitInto)->ArgsProduct({{8, 64}, {0, 1}});
+BENCHMARK(BM_Find)->ArgsProduct({{1024, 64 * 1024}, {0, 1, 2, 3}});
+BENCHMARK(BM_ReplaceAll)->Arg(0)->Arg(1);
+BENCHMARK(BM_ParseInt)->ArgsProduct({{0, 1}, {0, 1}});
+BENCHMARK(BM_ParseDouble)->ArgsProduct({{0, 1}, {0, 1}});
+BENCHMARK(BM_ParseLongDigits)->Arg(0)->Arg(1);
+BENCHMARK(BM_FormatNumbers)->Arg(0)->Arg(1);
+BENCHMARK(BM_FormatShortestDouble)->Arg(0)->Arg(1);
+BENCHMARK(BM_Join)->Arg(0)->Arg(1);
+BENCHMARK(BM_BuildResponse)->Arg(0)->Arg(1);
+BENCHMARK(BM_ToLower)->ArgsProduct({{16, 1024}, {0, 1, 2, 3}});
+BENCHMARK(BM_HeaderLookup)->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
+#else
+int main() {
+    std::cout << "Google Benchmark library not available" << std::endl;
+    return 0;
+}
+#endif
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <utoolkit/utils/string_utils.h>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace utoolkit {
+namespace utils {
+
+// Builds a string in a buffer that starts inside the object and grows
+// geometrically on the heap, e.g. one per request handler or thread:
+//
+//   StringBuilder out;
+//   out.append("id=").append_int(id).append(", tags=").append_join(tags, ",");
+//   send(out.view());
+//   out.reset();   // keeps the buffer for the next request
+//
+// Short results never allocate; longer ones allocate once the builder has
+// grown to their size.
+class StringBuilder {
+public:
+    static constexpr size_t kInlineCapacity = 256;
+
+    StringBuilder() = default;
+    ~StringBuilder() { release(); }
+
+    StringBuilder(StringBuilder&& other) noexcept { take(other); }
+    StringBuilder& operator=(StringBuilder&& other) noexcept {
+        if (this != &other) {
+            release();
+            take(other);
+        }
+        return *this;
+    }
+
+    StringBuilder(const StringBuilder&) = delete;
+    StringBuilder& operator=(const StringBuilder&) = delete;
+
+    // |text| may be a view of this builder, e.g. append(view()).
+    StringBuilder& append(std::string_view text) {
+        if (text.size() > capacity_ - size_) {
+            grow(text.size(), text);
+            return *this;
+        }
+        if (!text.empty()) {
+            std::memcpy(data_ + size_, text.data(), text.size());
+            size_ += text.size();
+        }
+        return *this;
+    }
+
+    StringBuilder& append(char c) {
+        if (size_ == capacity_) {
+            grow(1);
+        }
+        data_[size_++] = c;
+        return *this;
+    }
+
+    StringBuilder& append(size_t count, char c) {
+        if (count > capacity_ - size_) {
+            grow(count);
+        }
+        std::memset(data_ + size_, c, count);
+        size_ += count;
+        return *this;
+    }
+
+    template <typename T>
+    StringBuilder& append_int(T value) {
+        if (StringUtils::kMaxIntChars > capacity_ - size_) {
+            grow(StringUtils::kMaxIntChars);
+        }
+        size_ = static_cast<size_t>(StringUtils::write_int(data_ + size_, value) - data_);
+        return *this;
+    }
+
+    // The shortest text that parses back to |value|.
+    StringBuilder& append_double(double value) {
+        if (StringUtils::kMaxDoubleChars > capacity_ - size_) {
+            grow(StringUtils::kMaxDoubleChars);
+        }
+        size_ = static_cast<size_t>(StringUtils::write_double(data_ + size_, value) - data_);
+        return *this;
+    }
+
+    // Fixed notation with at most |precision| decimals, trailing zeros
+    // removed, like StringUtils::from_double().
+    StringBuilder& append_double(double value, int precision);
+
+    // |parts| is any range of what converts to std::string_view, e.g. a
+    // vector of std::string, not views of this builder. The length of the
+    // result is computed first, so it grows at most once.
+    template <typename Range>
+    StringBuilder& append_join(const Range& parts, std::string_view delimiter) {
+        size_t length = 0;
+        size_t count = 0;
+        for (const auto& part : parts) {
+            length += std::string_view(part).size();
+            ++count;
+        }
+        if (count == 0) {
+            return *this;
+        }
+        length += (count - 1) * delimiter.size();
+        reserve(size_ + length);
+
+        bool first = true;
+        for (const auto& part : parts) {
+            if (!first) {
+                append(delimiter);
+            }
+            append(std::string_view(part));
+            first = false;
+        }
+        return *this;
+    }
+
+    // Makes room for |capacity| characters in total.
+    void reserve(size_t capacity) {
+        if (capacity > capacity_) {
+            grow(capacity - size_);
+        }
+    }
+
+    // Empties the builder but keeps its buffer.
+    void reset() { size_ = 0; }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return size_ == 0; }
+
+    // Valid until the builder changes.
+    std::string_view view() const { return std::string_view(data_, size_); }
+    std::string str() const { return std::string(data_, size_); }
+
+private:
+    bool is_inline() const { return data_ == inline_; }
+
+    // Makes room for |extra| more characters: at least doubles the buffer.
+    // Then appends |text|, which may be in the old buffer.
+    void grow(size_t extra, std::string_view text = {});
+    void release();
+    void take(StringBuilder& other);
+
+    char inline_[kInlineCapacity];
+    char* data_ = inline_;
+    size_t size_ = 0;
+    size_t capacity_ = kInlineCapacity;
+};
+
+} // namespace utils
+} // namespace utoolkit
@@ -1,12 +1,215 @@
 #pragma once
 
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
 #include <vector>
 #include <iomanip>
 
 namespace utoolkit {
 namespace utils {
 
+namespace detail {
+
+// First |c| in [first, last), or |last|. memchr is vectorized by the C
+// library.
+inline const char* find_char(const char* first, const char* last, char c) {
+    if (first == last) {
+        return last;
+    }
+    const void* found = std::memchr(first, static_cast<unsigned char>(c), static_cast<size_t>(last - first));
+    return found != nullptr ? static_cast<const char*>(found) : last;
+}
+
+// First |needle|, which is not empty, in [first, last), or |last|.
+inline const char* find_string(const char* first, const char* last, std::string_view needle) {
+    const size_t size = needle.size();
+    if (size == 1) {
+        return find_char(first, last, needle[0]);
+    }
+    while (static_cast<size_t>(last - first) >= size) {
+        const char* const stop = last - size + 1;
+        first = find_char(first, stop, needle[0]);
+        if (first == stop) {
+            break;
+        }
+        if (std::memcmp(first + 1, needle.data() + 1, size - 1) == 0) {
+            return first;
+        }
+        ++first;
+    }
+    return last;
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define UT_STRING_UTILS_SWAR_DIGITS 1
+
+// Eight ASCII digits at once in a 64-bit word, most significant first in
+// memory.
+inline uint64_t load_eight(const char* p) {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+inline bool is_eight_digits(uint64_t word) {
+    return ((word & 0xF0F0F0F0F0F0F0F0) | (((word + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+           0x3333333333333333;
+}
+
+inline uint64_t eight_digits_value(uint64_t word) {
+    word -= 0x3030303030303030;
+    word = word * 10 + (word >> 8);
+    word = (((word & 0x000000FF000000FF) * (100 + (1000000ULL << 32))) +
+            (((word >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32)))) >> 32;
+    return word;
+}
+#endif
+
+// The value of the decimal digits [first, last), at most 19 so that it
+// fits; false if there is anything else.
+inline bool parse_digits(const char* first, const char* last, uint64_t& value) {
+    value = 0;
+#ifdef UT_STRING_UTILS_SWAR_DIGITS
+    while (last - first >= 8) {
+        const uint64_t word = load_eight(first);
+        if (!is_eight_digits(word)) {
+            return false;
+        }
+        value = value * 100000000 + eight_digits_value(word);
+        first += 8;
+    }
+#endif
+    for (; first != last; ++first) {
+        const unsigned digit = static_cast<unsigned char>(*first) - static_cast<unsigned>('0');
+        if (digit > 9) {
+            return false;
+        }
+        value = value * 10 + digit;
+    }
+    return true;
+}
+
+// A substring search behind StringUtils::find(), for tests and benchmarks.
+// |size| of the needle is at least 2 and at most |length|.
+struct FindImplementation {
+    const char* name;
+    size_t (*find)(const char* str, size_t length, const char* needle, size_t size);
+};
+
+// Those the CPU supports, the one StringUtils::find() picks first.
+std::vector<FindImplementation> find_implementations();
+
+// ASCII case mapping and comparison behind StringUtils::to_lower(),
+// iequals() and friends, for tests and benchmarks. |in| and |out| are
+// |length| bytes and may be the same.
+struct CaseImplementation {
+    const char* name;
+    void (*to_lower)(const char* in, char* out, size_t length);
+    void (*to_upper)(const char* in, char* out, size_t length);
+    bool (*iequals)(const char* a, const char* b, size_t length);
+};
+
+// Those the CPU supports, the one StringUtils picks first.
+std::vector<CaseImplementation> case_implementations();
+
+} // namespace detail
+
+// The fields of a string between delimiters, found one at a time while
+// iterating and returned as views into the string, which must outlive them.
+// Every field is returned, also empty ones: "a,,b," has four and "" has one.
+// An empty string delimiter leaves the string whole.
+class SplitView {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view*;
+        using reference = const std::string_view&;
+
+        iterator() = default;
+
+        reference operator*() const { return field_; }
+        pointer operator->() const { return &field_; }
+
+        iterator& operator++() {
+            const char* const field_end = field_.data() + field_.size();
+            if (field_end == end_) {
+                done_ = true;
+            } else {
+                find_field(field_end + (by_char_ ? 1 : delimiter_.size()));
+            }
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const iterator& other) const {
+            return done_ == other.done_ && (done_ || field_.data() == other.field_.data());
+        }
+        bool operator!=(const iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class SplitView;
+
+        explicit iterator(const SplitView& view)
+            : end_(view.str_.data() + view.str_.size()),
+              delimiter_(view.delimiter_),
+              char_(view.char_),
+              by_char_(view.by_char_),
+              done_(false) {
+            find_field(view.str_.data());
+        }
+
+        void find_field(const char* first) {
+            const char* last = end_;
+            if (by_char_) {
+                last = detail::find_char(first, end_, char_);
+            } else if (!delimiter_.empty()) {
+                last = detail::find_string(first, end_, delimiter_);
+            }
+            field_ = std::string_view(first, static_cast<size_t>(last - first));
+        }
+
+        std::string_view field_;
+        const char* end_ = nullptr;
+        std::string_view delimiter_;
+        char char_ = 0;
+        bool by_char_ = false;
+        bool done_ = true;
+    };
+
+    using const_iterator = iterator;
+
+    SplitView(std::string_view str, char delimiter) : str_(str), char_(delimiter), by_char_(true) {}
+    // |delimiter| is not copied either.
+    SplitView(std::string_view str, std::string_view delimiter) : str_(str), delimiter_(delimiter) {}
+
+    iterator begin() const { return iterator(*this); }
+    iterator end() const { return iterator(); }
+
+private:
+    std::string_view str_;
+    std::string_view delimiter_;
+    char char_ = 0;
+    bool by_char_ = false;
+};
+
 class StringUtils {
 public:
     static std::string trim(const std::string& str);
@@ -14,12 +217,65 @@ public:
     static std::string trim_right(const std::string& str);
     static std::vector<std::string> split(const std::string& str, char delimiter);
     static std::vector<std::string> split(const std::string& str, const std::string& delimiter);
+
+    // Without allocating per field; see SplitView for how fields are found.
+    static SplitView split_view(std::string_view str, char delimiter) { return SplitView(str, delimiter); }
+    static SplitView split_view(std::string_view str, std::string_view delimiter) {
+        return SplitView(str, delimiter);
+    }
+    // Replaces the contents of |out| with the fields of |str|, reusing its
+    // capacity, and returns their number.
+    static size_t split_into(std::vector<std::string_view>& out, std::string_view str, char delimiter);
+    static size_t split_into(std::vector<std::string_view>& out, std::string_view str, std::string_view delimiter);
     static std::string join(const std::vector<std::string>& parts, const std::string& delimiter);
+    // Any range of what converts to std::string_view; allocates once.
+    template <typename Range>
+    static std::string join(const Range& parts, std::string_view delimiter) {
+        size_t length = 0;
+        size_t count = 0;
+        for (const auto& part : parts) {
+            length += std::string_view(part).size();
+            ++count;
+        }
+        std::string result;
+        if (count == 0) {
+            return result;
+        }
+        result.resize(length + (count - 1) * delimiter.size());
+        char* out = &result[0];
+        bool first = true;
+        for (const auto& part : parts) {
+            if (!first) {
+                out = std::copy(delimiter.begin(), delimiter.end(), out);
+            }
+            const std::string_view text(part);
+            out = std::copy(text.begin(), text.end(), out);
+            first = false;
+        }
+        return result;
+    }
     static bool starts_with(const std::string& str, const std::string& prefix);
     static bool ends_with(const std::string& str, const std::string& suffix);
+    // Case mapping and case-insensitive comparison are ASCII only, whatever
+    // the locale: other bytes, including all of UTF-8 beyond ASCII, are left
+    // alone. They use SSE2 or AVX2 as the CPU allows and work on eight bytes
+    // at a time otherwise, and on strings shorter than 16 bytes.
     static std::string to_lower(const std::string& str);
     static std::string to_upper(const std::string& str);
+    static void to_lower_in_place(std::string& str);
+    static void to_upper_in_place(std::string& str);
+    // Write |str| mapped to |out|, which has room for str.size() bytes and
+    // may be str.data(); return the end of what they wrote.
+    static char* to_lower(std::string_view str, char* out);
+    static char* to_upper(std::string_view str, char* out);
+    static bool iequals(std::string_view a, std::string_view b);
+    static bool istarts_with(std::string_view str, std::string_view prefix);
+    // Equal for strings that iequals() finds equal, without mapping them to
+    // a temporary string.
+    static size_t ihash(std::string_view str);
     static bool contains(const std::string& str, const std::string& substring);
+    // Like std::string::find(), with SSE2 or AVX2 as the CPU allows.
+    static size_t find(std::string_view str, std::string_view substring, size_t pos = 0);
     static std::string replace(const std::string& str, const std::string& from, const std::string& to);
     static std::string replace_all(const std::string& str, const std::string& from, const std::string& to);
     
@@ -32,14 +288,103 @@ public:
     static std::string from_double(double value, int precision = 2);
     static std::string from_long(long value);
     static std::string from_bool(bool value);
+
+    // Without a temporary string: appending reuses the capacity of |out|,
+    // write_*() fill a caller's buffer of at least kMax*Chars and return the
+    // end of what they wrote.
+    static constexpr size_t kMaxIntChars = 20;     // "-9223372036854775808"
+    static constexpr size_t kMaxDoubleChars = 24;  // "-2.2250738585072014e-308"
+
+    template <typename T>
+    static char* write_int(char* buffer, T value) {
+        static_assert(std::is_integral_v<T> && !std::is_same_v<T, bool>, "write_int() takes integers");
+        return std::to_chars(buffer, buffer + kMaxIntChars, value).ptr;
+    }
+
+    // The shortest text that parses back to |value|, e.g. "0.1" or "1e+21".
+    static char* write_double(char* buffer, double value) {
+        return std::to_chars(buffer, buffer + kMaxDoubleChars, value).ptr;
+    }
+
+    template <typename T>
+    static void append_int(std::string& out, T value) {
+        char buffer[kMaxIntChars];
+        out.append(buffer, static_cast<size_t>(write_int(buffer, value) - buffer));
+    }
+
+    static void append_double(std::string& out, double value) {
+        char buffer[kMaxDoubleChars];
+        out.append(buffer, static_cast<size_t>(write_double(buffer, value) - buffer));
+    }
+
+    // Fixed notation with at most |precision| decimals, trailing zeros
+    // removed, as from_double() returns it.
+    static void append_double(std::string& out, double value, int precision);
     static bool is_integer(const std::string& str);
     static bool is_float(const std::string& str);
     static bool is_numeric(const std::string& str);
+
+    // The number |str| spells, or nothing; never throws. The whole string
+    // must be the number: no whitespace, no '+', decimal only. Floating point
+    // accepts what std::from_chars does, e.g. "1e-3", "inf" and "nan", and
+    // does not depend on the locale.
+    template <typename T>
+    static std::optional<T> parse(std::string_view str) {
+        static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "parse() takes numbers");
+        if constexpr (std::is_integral_v<T>) {
+            // Up to 19 digits cannot overflow 64 bits, which leaves only the
+            // range of T to check.
+            const char* first = str.data();
+            const char* last = first + str.size();
+            bool negative = false;
+            if constexpr (std::is_signed_v<T>) {
+                if (first != last && *first == '-') {
+                    negative = true;
+                    ++first;
+                }
+            }
+            const auto digits = static_cast<size_t>(last - first);
+            if (digits != 0 && digits <= 19) {
+                uint64_t magnitude;
+                if (!detail::parse_digits(first, last, magnitude)) {
+                    return std::nullopt;
+                }
+                const auto max = static_cast<uint64_t>(std::numeric_limits<T>::max());
+                if (magnitude > max + (negative ? 1 : 0)) {
+                    return std::nullopt;
+                }
+                if (negative) {
+                    return magnitude == 0 ? T(0) : static_cast<T>(-static_cast<int64_t>(magnitude - 1) - 1);
+                }
+                return static_cast<T>(magnitude);
+            }
+        }
+        T value {};
+        const char* last = str.data() + str.size();
+        const auto result = std::from_chars(str.data(), last, value);
+        if (result.ec != std::errc() || result.ptr != last) {
+            return std::nullopt;
+        }
+        return value;
+    }
     static std::string format(const std::string& format_str, ...);
     static std::string repeat(const std::string& str, size_t count);
     static std::string pad_left(const std::string& str, size_t width, char pad_char = ' ');
     static std::string pad_right(const std::string& str, size_t width, char pad_char = ' ');
 };
 
+// For unordered containers keyed case-insensitively, e.g. by HTTP header
+// names. Both are transparent, so lookups can take a std::string_view where
+// the container supports it.
+struct CaseInsensitiveHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view str) const { return StringUtils::ihash(str); }
+};
+
+struct CaseInsensitiveEqual {
+    using is_transparent = void;
+    bool operator()(std::string_view a, std::string_view b) const { return StringUtils::iequals(a, b); }
+};
+
 } // namespace utils
-} // namespace utoolkit
\ No newline at end of file
+} // namespace utoolkit
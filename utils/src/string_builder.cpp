@@ -0,0 +1,67 @@
+#include <utoolkit/utils/string_builder.h>
+#include <algorithm>
+
+namespace utoolkit {
+namespace utils {
+
+StringBuilder& StringBuilder::append_double(double value, int precision) {
+    precision = std::max(precision, 0);
+    // Enough for most values; the largest doubles have 309 integer digits.
+    reserve(size_ + 64);
+    auto result = std::to_chars(data_ + size_, data_ + capacity_, value, std::chars_format::fixed, precision);
+    if (result.ec != std::errc()) {
+        reserve(size_ + 320 + static_cast<size_t>(precision));
+        result = std::to_chars(data_ + size_, data_ + capacity_, value, std::chars_format::fixed, precision);
+    }
+
+    const std::string_view text(data_ + size_, static_cast<size_t>(result.ptr - (data_ + size_)));
+    size_t length = text.size();
+    if (text.find('.') != std::string_view::npos) {
+        length = text.find_last_not_of('0') + 1;
+        if (text[length - 1] == '.') {
+            --length;
+        }
+    }
+    size_ += length;
+    return *this;
+}
+
+void StringBuilder::grow(size_t extra, std::string_view text) {
+    const size_t capacity = std::max(size_ + extra, capacity_ * 2);
+    char* data = new char[capacity];
+    std::memcpy(data, data_, size_);
+    if (!text.empty()) {
+        // Before release(), which may free what |text| refers to.
+        std::memcpy(data + size_, text.data(), text.size());
+    }
+    release();
+    data_ = data;
+    capacity_ = capacity;
+    size_ += text.size();
+}
+
+void StringBuilder::release() {
+    if (!is_inline()) {
+        delete[] data_;
+    }
+    data_ = inline_;
+    capacity_ = kInlineCapacity;
+}
+
+void StringBuilder::take(StringBuilder& other) {
+    size_ = other.size_;
+    if (other.is_inline()) {
+        data_ = inline_;
+        capacity_ = kInlineCapacity;
+        std::memcpy(inline_, other.inline_, other.size_);
+    } else {
+        data_ = other.data_;
+        capacity_ = other.capacity_;
+        other.data_ = other.inline_;
+        other.capacity_ = kInlineCapacity;
+    }
+    other.size_ = 0;
+}
+
+} // namespace utils
+} // namespace utoolkit
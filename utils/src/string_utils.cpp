@@ -1,12 +1,348 @@
 #include <utoolkit/utils/string_utils.h>
 #include <algorithm>
 #include <cstdarg>
+#include <cstdint>
 #include <cstdio>
+#include <functional>
 #include <sstream>
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#define UT_STRING_UTILS_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
 namespace utoolkit {
 namespace utils {
 
+namespace {
+
+size_t find_scalar(const char* str, size_t length, const char* needle, size_t size) {
+    const char* found = detail::find_string(str, str + length, std::string_view(needle, size));
+    return found == str + length ? std::string::npos : static_cast<size_t>(found - str);
+}
+
+#ifdef UT_STRING_UTILS_X86_SIMD
+
+// Blocks of 16 or 32 positions are filtered by comparing the first and the
+// last byte of the needle at once; only candidates that match both are
+// compared in full. The rest, shorter than a block, is searched by
+// find_scalar().
+
+size_t find_sse2(const char* str, size_t length, const char* needle, size_t size) {
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[size - 1]);
+    size_t i = 0;
+    for (; i + size - 1 + 16 <= length; i += 16) {
+        const __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+        const __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i + size - 1));
+        auto mask = static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last))));
+        while (mask != 0) {
+            const unsigned bit = static_cast<unsigned>(__builtin_ctz(mask));
+            if (std::memcmp(str + i + bit + 1, needle + 1, size - 2) == 0) {
+                return i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+    const size_t found = find_scalar(str + i, length - i, needle, size);
+    return found == std::string::npos ? found : i + found;
+}
+
+__attribute__((target("avx2")))
+size_t find_avx2(const char* str, size_t length, const char* needle, size_t size) {
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[size - 1]);
+    size_t i = 0;
+    for (; i + size - 1 + 32 <= length; i += 32) {
+        const __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + i));
+        const __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + i + size - 1));
+        auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last))));
+        while (mask != 0) {
+            const unsigned bit = static_cast<unsigned>(__builtin_ctz(mask));
+            if (std::memcmp(str + i + bit + 1, needle + 1, size - 2) == 0) {
+                return i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+    const size_t found = find_sse2(str + i, length - i, needle, size);
+    return found == std::string::npos ? found : i + found;
+}
+
+#endif
+
+// ASCII case mapping without a table or a branch per byte: only 'A'..'Z'
+// (or 'a'..'z') differ from their other case, in the 0x20 bit.
+inline char lower_ascii(char c) {
+    return static_cast<unsigned char>(c - 'A') < 26 ? static_cast<char>(c | 0x20) : c;
+}
+
+inline char upper_ascii(char c) {
+    return static_cast<unsigned char>(c - 'a') < 26 ? static_cast<char>(c & ~0x20) : c;
+}
+
+// The same for the eight bytes of a word. Adding to the low seven bits of a
+// byte cannot carry into the next one, so the top bit of each byte tells
+// whether it is at least |first| and whether it is past |last|; bytes with
+// the top bit set to begin with are not ASCII and never letters.
+constexpr uint64_t kEachByte = 0x0101010101010101;
+
+inline uint64_t case_mask_word(uint64_t word, char first, char last) {
+    const uint64_t low = word & (kEachByte * 0x7F);
+    const uint64_t from_first = low + kEachByte * static_cast<uint64_t>(0x80 - first);
+    const uint64_t past_last = low + kEachByte * static_cast<uint64_t>(0x80 - last - 1);
+    return (from_first & ~past_last & ~word & (kEachByte * 0x80)) >> 2;
+}
+
+inline uint64_t lower_word(uint64_t word) {
+    return word | case_mask_word(word, 'A', 'Z');
+}
+
+inline uint64_t upper_word(uint64_t word) {
+    return word ^ case_mask_word(word, 'a', 'z');
+}
+
+inline uint64_t load_word(const char* p) {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+inline void store_word(char* p, uint64_t word) {
+    std::memcpy(p, &word, sizeof(word));
+}
+
+// Strings of at least a block, here a word, end with a block that overlaps
+// the one before instead of a tail a byte at a time: mapping twice changes
+// nothing, so this is safe also when |in| is |out|.
+template <uint64_t (*Map)(uint64_t), char (*MapByte)(char)>
+void map_case_swar(const char* in, char* out, size_t length) {
+    if (length < 8) {
+        for (size_t i = 0; i < length; ++i) {
+            out[i] = MapByte(in[i]);
+        }
+        return;
+    }
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        store_word(out + i, Map(load_word(in + i)));
+    }
+    if (i != length) {
+        store_word(out + length - 8, Map(load_word(in + length - 8)));
+    }
+}
+
+bool iequals_swar(const char* a, const char* b, size_t length) {
+    if (length < 8) {
+        for (size_t i = 0; i < length; ++i) {
+            if (lower_ascii(a[i]) != lower_ascii(b[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        if (lower_word(load_word(a + i)) != lower_word(load_word(b + i))) {
+            return false;
+        }
+    }
+    return i == length || lower_word(load_word(a + length - 8)) == lower_word(load_word(b + length - 8));
+}
+
+constexpr auto to_lower_swar = map_case_swar<lower_word, lower_ascii>;
+constexpr auto to_upper_swar = map_case_swar<upper_word, upper_ascii>;
+
+#ifdef UT_STRING_UTILS_X86_SIMD
+
+// A block is mapped by shifting the range of letters to the bottom of the
+// signed bytes, where a single signed comparison finds them, and flipping
+// the 0x20 bit of those. The last block overlaps as in map_case_swar();
+// shorter strings are left to the word at a time versions.
+
+inline __m128i case_mask_sse2(__m128i block, char first) {
+    const __m128i shifted = _mm_add_epi8(block, _mm_set1_epi8(static_cast<char>(0x80 - first)));
+    return _mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(-128 + 26)));
+}
+
+inline __m128i lower_sse2(__m128i block) {
+    return _mm_or_si128(block, _mm_and_si128(case_mask_sse2(block, 'A'), _mm_set1_epi8(0x20)));
+}
+
+inline __m128i upper_sse2(__m128i block) {
+    return _mm_xor_si128(block, _mm_and_si128(case_mask_sse2(block, 'a'), _mm_set1_epi8(0x20)));
+}
+
+template <__m128i (*Map)(__m128i), void (*Shorter)(const char*, char*, size_t)>
+void map_case_sse2(const char* in, char* out, size_t length) {
+    if (length < 16) {
+        Shorter(in, out, length);
+        return;
+    }
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), Map(block));
+    }
+    if (i != length) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + length - 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + length - 16), Map(block));
+    }
+}
+
+inline bool iequals_block_sse2(const char* a, const char* b) {
+    const __m128i block_a = lower_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a)));
+    const __m128i block_b = lower_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b)));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(block_a, block_b)) == 0xFFFF;
+}
+
+bool iequals_sse2(const char* a, const char* b, size_t length) {
+    if (length < 16) {
+        return iequals_swar(a, b, length);
+    }
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        if (!iequals_block_sse2(a + i, b + i)) {
+            return false;
+        }
+    }
+    return i == length || iequals_block_sse2(a + length - 16, b + length - 16);
+}
+
+__attribute__((target("avx2")))
+inline __m256i case_mask_avx2(__m256i block, char first) {
+    const __m256i shifted = _mm256_add_epi8(block, _mm256_set1_epi8(static_cast<char>(0x80 - first)));
+    return _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(-128 + 26)), shifted);
+}
+
+__attribute__((target("avx2")))
+inline __m256i lower_avx2(__m256i block) {
+    return _mm256_or_si256(block, _mm256_and_si256(case_mask_avx2(block, 'A'), _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2")))
+inline __m256i upper_avx2(__m256i block) {
+    return _mm256_xor_si256(block, _mm256_and_si256(case_mask_avx2(block, 'a'), _mm256_set1_epi8(0x20)));
+}
+
+template <__m256i (*Map)(__m256i), void (*Shorter)(const char*, char*, size_t)>
+__attribute__((target("avx2")))
+void map_case_avx2(const char* in, char* out, size_t length) {
+    if (length < 32) {
+        Shorter(in, out, length);
+        return;
+    }
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), Map(block));
+    }
+    if (i != length) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + length - 32));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + length - 32), Map(block));
+    }
+}
+
+__attribute__((target("avx2")))
+inline bool iequals_block_avx2(const char* a, const char* b) {
+    const __m256i block_a = lower_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a)));
+    const __m256i block_b = lower_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b)));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block_a, block_b))) == 0xFFFFFFFF;
+}
+
+__attribute__((target("avx2")))
+bool iequals_avx2(const char* a, const char* b, size_t length) {
+    if (length < 32) {
+        return iequals_sse2(a, b, length);
+    }
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        if (!iequals_block_avx2(a + i, b + i)) {
+            return false;
+        }
+    }
+    return i == length || iequals_block_avx2(a + length - 32, b + length - 32);
+}
+
+#endif
+
+const detail::CaseImplementation& case_implementation() {
+    static const detail::CaseImplementation implementation = detail::case_implementations().front();
+    return implementation;
+}
+
+// Strings shorter than an SSE2 block, like most header names and keys, go
+// straight to the word at a time versions, without the indirect call.
+constexpr size_t kShortCase = 16;
+
+void to_lower_ascii(const char* in, char* out, size_t length) {
+    if (length < kShortCase) {
+        to_lower_swar(in, out, length);
+    } else {
+        case_implementation().to_lower(in, out, length);
+    }
+}
+
+void to_upper_ascii(const char* in, char* out, size_t length) {
+    if (length < kShortCase) {
+        to_upper_swar(in, out, length);
+    } else {
+        case_implementation().to_upper(in, out, length);
+    }
+}
+
+bool iequals_ascii(const char* a, const char* b, size_t length) {
+    return length < kShortCase ? iequals_swar(a, b, length) : case_implementation().iequals(a, b, length);
+}
+
+// What std::stoi() and std::stod() skip before the number: whitespace and
+// a '+', which parse() does not take.
+bool strip_number_prefix(std::string_view str, std::string_view& number) {
+    const size_t start = str.find_first_not_of(" \t\n\r\f\v");
+    number = start == std::string_view::npos ? std::string_view() : str.substr(start);
+    if (!number.empty() && number[0] == '+') {
+        number.remove_prefix(1);
+        return number.empty() || number[0] != '-';
+    }
+    return true;
+}
+
+} // namespace
+
+namespace detail {
+
+std::vector<FindImplementation> find_implementations() {
+    std::vector<FindImplementation> result;
+#ifdef UT_STRING_UTILS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        result.push_back({"avx2", find_avx2});
+    }
+    result.push_back({"sse2", find_sse2});
+#endif
+    result.push_back({"scalar", find_scalar});
+    return result;
+}
+
+std::vector<CaseImplementation> case_implementations() {
+    std::vector<CaseImplementation> result;
+#ifdef UT_STRING_UTILS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        result.push_back({"avx2", map_case_avx2<lower_avx2, map_case_sse2<lower_sse2, to_lower_swar>>,
+                          map_case_avx2<upper_avx2, map_case_sse2<upper_sse2, to_upper_swar>>, iequals_avx2});
+    }
+    result.push_back({"sse2", map_case_sse2<lower_sse2, to_lower_swar>, map_case_sse2<upper_sse2, to_upper_swar>,
+                      iequals_sse2});
+#endif
+    result.push_back({"swar", to_lower_swar, to_upper_swar, iequals_swar});
+    return result;
+}
+
+} // namespace detail
+
 std::string StringUtils::trim(const std::string& str) {
     return trim_left(trim_right(str));
 }
@@ -23,16 +359,72 @@ std::string StringUtils::trim_right(const std::string& str) {
 
 std::string StringUtils::to_lower(const std::string& str) {
     std::string result = str;
-    std::transform(result.begin(), result.end(), result.begin(), ::tolower);
+    to_lower_in_place(result);
     return result;
 }
 
 std::string StringUtils::to_upper(const std::string& str) {
     std::string result = str;
-    std::transform(result.begin(), result.end(), result.begin(), ::toupper);
+    to_upper_in_place(result);
     return result;
 }
 
+void StringUtils::to_lower_in_place(std::string& str) {
+    to_lower_ascii(str.data(), str.data(), str.size());
+}
+
+void StringUtils::to_upper_in_place(std::string& str) {
+    to_upper_ascii(str.data(), str.data(), str.size());
+}
+
+char* StringUtils::to_lower(std::string_view str, char* out) {
+    to_lower_ascii(str.data(), out, str.size());
+    return out + str.size();
+}
+
+char* StringUtils::to_upper(std::string_view str, char* out) {
+    to_upper_ascii(str.data(), out, str.size());
+    return out + str.size();
+}
+
+bool StringUtils::iequals(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && iequals_ascii(a.data(), b.data(), a.size());
+}
+
+bool StringUtils::istarts_with(std::string_view str, std::string_view prefix) {
+    return str.size() >= prefix.size() && iequals_ascii(str.data(), prefix.data(), prefix.size());
+}
+
+size_t StringUtils::ihash(std::string_view str) {
+    // Mixes in the lowercase string a word at a time as it is read, without
+    // mapping it to a buffer first; the last word overlaps the one before as
+    // in map_case_swar(), and the length tells those apart.
+    const auto mix = [](uint64_t hash, uint64_t word) {
+        hash = (hash ^ word) * 0xBF58476D1CE4E5B9;
+        return hash ^ (hash >> 31);
+    };
+    const char* data = str.data();
+    const size_t length = str.size();
+    uint64_t hash = 0x9E3779B97F4A7C15 ^ length;
+    if (length < 8) {
+        uint64_t word = 0;
+        if (length != 0) {
+            std::memcpy(&word, data, length);
+        }
+        hash = mix(hash, lower_word(word));
+    } else {
+        size_t i = 0;
+        for (; i + 8 <= length; i += 8) {
+            hash = mix(hash, lower_word(load_word(data + i)));
+        }
+        if (i != length) {
+            hash = mix(hash, lower_word(load_word(data + length - 8)));
+        }
+    }
+    hash = (hash ^ (hash >> 32)) * 0x94D049BB133111EB;
+    return static_cast<size_t>(hash ^ (hash >> 29));
+}
+
 bool StringUtils::starts_with(const std::string& str, const std::string& prefix) {
     return str.size() >= prefix.size() && 
            str.compare(0, prefix.size(), prefix) == 0;
@@ -70,19 +462,28 @@ std::vector<std::string> StringUtils::split(const std::string& str, const std::s
     return result;
 }
 
-std::string StringUtils::join(const std::vector<std::string>& parts, const std::string& delimiter) {
-    std::string result;
-    for (size_t i = 0; i < parts.size(); ++i) {
-        if (i != 0) {
-            result += delimiter;
-        }
-        result += parts[i];
+size_t StringUtils::split_into(std::vector<std::string_view>& out, std::string_view str, char delimiter) {
+    out.clear();
+    for (std::string_view field : SplitView(str, delimiter)) {
+        out.push_back(field);
     }
-    return result;
+    return out.size();
+}
+
+size_t StringUtils::split_into(std::vector<std::string_view>& out, std::string_view str, std::string_view delimiter) {
+    out.clear();
+    for (std::string_view field : SplitView(str, delimiter)) {
+        out.push_back(field);
+    }
+    return out.size();
+}
+
+std::string StringUtils::join(const std::vector<std::string>& parts, const std::string& delimiter) {
+    return join<std::vector<std::string>>(parts, std::string_view(delimiter));
 }
 
 std::string StringUtils::replace(const std::string& str, const std::string& from, const std::string& to) {
-    size_t start_pos = str.find(from);
+    size_t start_pos = find(str, from);
     if (start_pos == std::string::npos) {
         return str;
     }
@@ -96,20 +497,60 @@ std::string StringUtils::replace_all(const std::string& str, const std::string&
     if (from.empty()) {
         return str;
     }
-    
-    std::string result = str;
-    size_t start_pos = 0;
-    
-    while ((start_pos = result.find(from, start_pos)) != std::string::npos) {
-        result.replace(start_pos, from.length(), to);
-        start_pos += to.length();
+    size_t match = find(str, from);
+    if (match == std::string::npos) {
+        return str;
     }
-    
+
+    if (from.size() == to.size()) {
+        std::string result = str;
+        for (; match != std::string::npos; match = find(str, from, match + from.size())) {
+            std::memcpy(&result[match], to.data(), to.size());
+        }
+        return result;
+    }
+
+    // Counting the matches first costs a second search, which is cheaper
+    // than growing the result or shifting its tail on every match.
+    size_t count = 0;
+    for (size_t pos = match; pos != std::string::npos; pos = find(str, from, pos + from.size())) {
+        ++count;
+    }
+    std::string result;
+    result.reserve(str.size() - count * from.size() + count * to.size());
+    size_t copied = 0;
+    for (; match != std::string::npos; match = find(str, from, match + from.size())) {
+        result.append(str, copied, match - copied);
+        result += to;
+        copied = match + from.size();
+    }
+    result.append(str, copied, std::string::npos);
     return result;
 }
 
 bool StringUtils::contains(const std::string& str, const std::string& substr) {
-    return str.find(substr) != std::string::npos;
+    return find(str, substr) != std::string::npos;
+}
+
+size_t StringUtils::find(std::string_view str, std::string_view substring, size_t pos) {
+    static const auto implementation = detail::find_implementations().front().find;
+
+    if (pos > str.size()) {
+        return std::string::npos;
+    }
+    if (substring.empty()) {
+        return pos;
+    }
+    if (substring.size() > str.size() - pos) {
+        return std::string::npos;
+    }
+    if (substring.size() == 1) {
+        const char* end = str.data() + str.size();
+        const char* found = detail::find_char(str.data() + pos, end, substring[0]);
+        return found == end ? std::string::npos : static_cast<size_t>(found - str.data());
+    }
+    const size_t found = implementation(str.data() + pos, str.size() - pos, substring.data(), substring.size());
+    return found == std::string::npos ? found : pos + found;
 }
 
 std::string StringUtils::substring(const std::string& str, size_t pos, size_t len) {
@@ -141,18 +582,33 @@ std::string StringUtils::from_int(int value) {
 }
 
 std::string StringUtils::from_double(double value, int precision) {
-    std::stringstream ss;
-    ss << std::fixed << std::setprecision(precision) << value;
-    
-    std::string result = ss.str();
-    result.erase(result.find_last_not_of('0') + 1, std::string::npos);
-    if (result.back() == '.') {
-        result.pop_back();
-    }
-    
+    std::string result;
+    append_double(result, value, precision);
     return result;
 }
 
+void StringUtils::append_double(std::string& out, double value, int precision) {
+    precision = std::max(precision, 0);
+    const size_t start = out.size();
+    // Enough for most values; the largest doubles have 309 integer digits.
+    char buffer[64];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, precision);
+    if (result.ec == std::errc()) {
+        out.append(buffer, static_cast<size_t>(result.ptr - buffer));
+    } else {
+        out.resize(start + 320 + static_cast<size_t>(precision));
+        result = std::to_chars(&out[start], &out[0] + out.size(), value, std::chars_format::fixed, precision);
+        out.resize(static_cast<size_t>(result.ptr - out.data()));
+    }
+
+    if (out.find('.', start) != std::string::npos) {
+        out.erase(out.find_last_not_of('0') + 1);
+        if (out.back() == '.') {
+            out.pop_back();
+        }
+    }
+}
+
 std::string StringUtils::from_long(long value) {
     return std::to_string(value);
 }
@@ -162,23 +618,13 @@ std::string StringUtils::from_bool(bool value) {
 }
 
 bool StringUtils::is_integer(const std::string& str) {
-    try {
-        size_t pos;
-        std::stoi(str, &pos);
-        return pos == str.length();
-    } catch (...) {
-        return false;
-    }
+    std::string_view number;
+    return strip_number_prefix(str, number) && parse<int>(number).has_value();
 }
 
 bool StringUtils::is_float(const std::string& str) {
-    try {
-        size_t pos;
-        std::stod(str, &pos);
-        return pos == str.length();
-    } catch (...) {
-        return false;
-    }
+    std::string_view number;
+    return strip_number_prefix(str, number) && parse<double>(number).has_value();
 }
 
 bool StringUtils::is_numeric(const std::string& str) {
@@ -220,14 +666,22 @@ std::string StringUtils::pad_left(const std::string& str, size_t width, char pad
     if (str.length() >= width) {
         return str;
     }
-    return repeat(std::string(1, pad_char), width - str.length()) + str;
+    std::string result;
+    result.reserve(width);
+    result.append(width - str.length(), pad_char);
+    result += str;
+    return result;
 }
 
 std::string StringUtils::pad_right(const std::string& str, size_t width, char pad_char) {
     if (str.length() >= width) {
         return str;
     }
-    return str + repeat(std::string(1, pad_char), width - str.length());
+    std::string result;
+    result.reserve(width);
+    result += str;
+    result.append(width - str.length(), pad_char);
+    return result;
 }
 
 } // namespace utils
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <utoolkit/utils/string_builder.h>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace utoolkit::utils;
+
+TEST(StringBuilderTest, AppendsTypedValues) {
+    StringBuilder out;
+    out.append("id=").append_int(42).append(',').append_int(int64_t(-7)).append(' ');
+    out.append_double(0.25).append(' ').append_double(3.14159, 2).append(' ').append_double(100.0, 0);
+    out.append(3, '.');
+    EXPECT_EQ(out.view(), "id=42,-7 0.25 3.14 100...");
+    EXPECT_EQ(out.str(), std::string(out.view()));
+}
+
+TEST(StringBuilderTest, StaysInlineUntilFull) {
+    StringBuilder out;
+    const char* inline_data = out.data();
+    out.append(std::string(StringBuilder::kInlineCapacity, 'a'));
+    EXPECT_EQ(out.data(), inline_data);
+
+    out.append('b');
+    EXPECT_NE(out.data(), inline_data);
+    EXPECT_GE(out.capacity(), 2 * StringBuilder::kInlineCapacity);
+    EXPECT_EQ(out.view(), std::string(StringBuilder::kInlineCapacity, 'a') + "b");
+}
+
+TEST(StringBuilderTest, AppendsItsOwnView) {
+    StringBuilder out;
+    std::string expected = "0123456789abcdef";
+    out.append(expected);
+    // Doubles from inline to the heap and then from heap to heap.
+    while (out.size() <= 4 * StringBuilder::kInlineCapacity) {
+        out.append(out.view());
+        expected += expected;
+        ASSERT_EQ(out.view(), expected);
+    }
+    out.append(out.view().substr(3, 5));
+    EXPECT_EQ(out.view(), expected + expected.substr(3, 5));
+}
+
+TEST(StringBuilderTest, ResetKeepsCapacity) {
+    StringBuilder out;
+    out.append(std::string(10000, 'x'));
+    const char* data = out.data();
+    const size_t capacity = out.capacity();
+
+    out.reset();
+    EXPECT_TRUE(out.empty());
+    out.append(std::string(9000, 'y'));
+    EXPECT_EQ(out.data(), data);
+    EXPECT_EQ(out.capacity(), capacity);
+}
+
+TEST(StringBuilderTest, MovesInlineAndHeapBuffers) {
+    StringBuilder small;
+    small.append("short");
+    StringBuilder moved_small(std::move(small));
+    EXPECT_EQ(moved_small.view(), "short");
+
+    StringBuilder large;
+    large.append(std::string(1000, 'z'));
+    const char* data = large.data();
+    StringBuilder moved_large;
+    moved_large = std::move(large);
+    EXPECT_EQ(moved_large.data(), data);
+    EXPECT_EQ(moved_large.size(), 1000u);
+}
+
+TEST(StringBuilderTest, JoinGrowsOnce) {
+    std::vector<std::string> parts(100, std::string(50, 'p'));
+    StringBuilder out;
+    out.append("[").append_join(parts, ", ");
+    EXPECT_EQ(out.size(), 1 + 100 * 50 + 99 * 2);
+    EXPECT_EQ(out.capacity(), out.size());
+
+    std::list<std::string_view> views = {"a", "b", "c"};
+    out.reset();
+    out.append_join(views, "-");
+    EXPECT_EQ(out.view(), "a-b-c");
+
+    const char* literals[] = {"x", "y"};
+    EXPECT_EQ(StringUtils::join(literals, "+"), "x+y");
+    EXPECT_EQ(StringUtils::join(std::vector<std::string_view>{}, ","), "");
+}
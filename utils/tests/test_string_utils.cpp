@@ -1,5 +1,15 @@
 #include <gtest/gtest.h>
 #include <utoolkit/utils/string_utils.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 using namespace utoolkit::utils;
 
@@ -33,6 +43,46 @@ TEST_F(StringUtilsTest, CaseConversion) {
     EXPECT_EQ(StringUtils::to_upper("hello world"), "HELLO WORLD");
 }
 
+TEST_F(StringUtilsTest, CaseConversionIsAsciiOnly) {
+    // The neighbours of the letters and UTF-8 stay as they are.
+    EXPECT_EQ(StringUtils::to_lower("@AZ[`az{ \xC3\x84"), "@az[`az{ \xC3\x84");
+    EXPECT_EQ(StringUtils::to_upper("@AZ[`az{ \xC3\xA4"), "@AZ[`AZ{ \xC3\xA4");
+}
+
+TEST_F(StringUtilsTest, CaseConversionInPlaceAndIntoBuffer) {
+    std::string str = "Content-Type: Text/HTML; Charset=UTF-8";
+    StringUtils::to_lower_in_place(str);
+    EXPECT_EQ(str, "content-type: text/html; charset=utf-8");
+    StringUtils::to_upper_in_place(str);
+    EXPECT_EQ(str, "CONTENT-TYPE: TEXT/HTML; CHARSET=UTF-8");
+
+    char buffer[16];
+    char* end = StringUtils::to_lower(std::string_view("X-Request-ID"), buffer);
+    EXPECT_EQ(std::string_view(buffer, static_cast<size_t>(end - buffer)), "x-request-id");
+    end = StringUtils::to_upper(std::string_view(), buffer);
+    EXPECT_EQ(end, buffer);
+}
+
+TEST_F(StringUtilsTest, CaseInsensitiveComparison) {
+    EXPECT_TRUE(StringUtils::iequals("Content-Length", "content-LENGTH"));
+    EXPECT_FALSE(StringUtils::iequals("Content-Length", "Content-Lengt"));
+    EXPECT_FALSE(StringUtils::iequals("@", "`"));
+    EXPECT_TRUE(StringUtils::iequals("", ""));
+    EXPECT_TRUE(StringUtils::istarts_with("Accept-Encoding", "ACCEPT"));
+    EXPECT_FALSE(StringUtils::istarts_with("Accept", "Accept-Encoding"));
+    EXPECT_TRUE(StringUtils::istarts_with("Accept", ""));
+
+    EXPECT_EQ(StringUtils::ihash("Content-Length"), StringUtils::ihash("CONTENT-length"));
+    const std::string longer(1000, 'X');
+    EXPECT_EQ(StringUtils::ihash(longer), StringUtils::ihash(StringUtils::to_lower(longer)));
+
+    std::unordered_map<std::string, int, CaseInsensitiveHash, CaseInsensitiveEqual> headers;
+    headers["Content-Length"] = 42;
+    EXPECT_EQ(headers.count("content-length"), 1u);
+    EXPECT_EQ(headers["CONTENT-LENGTH"], 42);
+    EXPECT_EQ(headers.size(), 1u);
+}
+
 TEST_F(StringUtilsTest, StartsWith) {
     EXPECT_TRUE(StringUtils::starts_with("hello world", "hello"));
     EXPECT_FALSE(StringUtils::starts_with("hello world", "world"));
@@ -60,6 +110,46 @@ TEST_F(StringUtilsTest, Split) {
     EXPECT_EQ(result[1], "world");
 }
 
+TEST_F(StringUtilsTest, SplitViewKeepsEmptyFields) {
+    auto fields = [](SplitView view) { return std::vector<std::string_view>(view.begin(), view.end()); };
+    using Fields = std::vector<std::string_view>;
+
+    EXPECT_EQ(fields(StringUtils::split_view("a,b,c", ',')), (Fields{"a", "b", "c"}));
+    EXPECT_EQ(fields(StringUtils::split_view(",a,,b,", ',')), (Fields{"", "a", "", "b", ""}));
+    EXPECT_EQ(fields(StringUtils::split_view("", ',')), (Fields{""}));
+    EXPECT_EQ(fields(StringUtils::split_view("abc", ',')), (Fields{"abc"}));
+
+    EXPECT_EQ(fields(StringUtils::split_view("a::b:c::", "::")), (Fields{"a", "b:c", ""}));
+    EXPECT_EQ(fields(StringUtils::split_view("a:::b", "::")), (Fields{"a", ":b"}));
+    EXPECT_EQ(fields(StringUtils::split_view("a b", "")), (Fields{"a b"}));
+    EXPECT_EQ(fields(StringUtils::split_view("x", "xyz")), (Fields{"x"}));
+}
+
+TEST_F(StringUtilsTest, SplitViewRefersToInput) {
+    const std::string line = "key=value";
+    auto view = StringUtils::split_view(line, '=');
+    auto it = view.begin();
+    EXPECT_EQ(it->data(), line.data());
+    ++it;
+    EXPECT_EQ(it->data(), line.data() + 4);
+    EXPECT_EQ(std::distance(view.begin(), view.end()), 2);
+}
+
+TEST_F(StringUtilsTest, SplitIntoReusesStorage) {
+    std::vector<std::string_view> fields;
+    EXPECT_EQ(StringUtils::split_into(fields, "1,2,3,4,5,6,7,8", ','), 8u);
+    const auto* storage = fields.data();
+
+    const std::string line = "x\t\ty";
+    EXPECT_EQ(StringUtils::split_into(fields, line, '\t'), 3u);
+    EXPECT_EQ(fields.data(), storage);
+    EXPECT_EQ(fields, (std::vector<std::string_view>{"x", "", "y"}));
+    EXPECT_EQ(fields[2].data(), line.data() + 3);
+
+    EXPECT_EQ(StringUtils::split_into(fields, "a\r\nb", "\r\n"), 2u);
+    EXPECT_EQ(fields, (std::vector<std::string_view>{"a", "b"}));
+}
+
 TEST_F(StringUtilsTest, Join) {
     std::vector<std::string> parts = {"a", "b", "c"};
     EXPECT_EQ(StringUtils::join(parts, ","), "a,b,c");
@@ -79,6 +169,126 @@ TEST_F(StringUtilsTest, ReplaceAll) {
     EXPECT_EQ(StringUtils::replace_all("hello world", "foo", "bar"), "hello world");
 }
 
+TEST_F(StringUtilsTest, ReplaceAllChangesLength) {
+    EXPECT_EQ(StringUtils::replace_all("a.b.c", ".", "::"), "a::b::c");
+    EXPECT_EQ(StringUtils::replace_all("a::b::c::", "::", ""), "abc");
+    EXPECT_EQ(StringUtils::replace_all("aaaa", "aa", "b"), "bb");
+    EXPECT_EQ(StringUtils::replace_all("aaa", "a", "aa"), "aaaaaa");
+    EXPECT_EQ(StringUtils::replace_all("abc", "", "x"), "abc");
+}
+
+TEST_F(StringUtilsTest, Find) {
+    EXPECT_EQ(StringUtils::find("hello world", "world"), 6u);
+    EXPECT_EQ(StringUtils::find("hello world", "o", 5), 7u);
+    EXPECT_EQ(StringUtils::find("hello", ""), 0u);
+    EXPECT_EQ(StringUtils::find("hello", "", 5), 5u);
+    EXPECT_EQ(StringUtils::find("hello", "", 6), std::string::npos);
+    EXPECT_EQ(StringUtils::find("hello", "hello!"), std::string::npos);
+    EXPECT_EQ(StringUtils::find("", "a"), std::string::npos);
+}
+
+namespace {
+
+// Short strings over a small alphabet, so that partial matches are common.
+std::string random_text(std::mt19937& rng, size_t max_length) {
+    std::uniform_int_distribution<size_t> length(0, max_length);
+    std::uniform_int_distribution<int> letter('a', 'c');
+    std::string text(length(rng), ' ');
+    for (char& c : text) {
+        c = static_cast<char>(letter(rng));
+    }
+    return text;
+}
+
+std::string replace_all_reference(std::string str, const std::string& from, const std::string& to) {
+    for (size_t pos = str.find(from); pos != std::string::npos; pos = str.find(from, pos + to.size())) {
+        str.replace(pos, from.size(), to);
+    }
+    return str;
+}
+
+} // namespace
+
+TEST_F(StringUtilsTest, FindMatchesStdFindOnRandomInput) {
+    std::mt19937 rng(12345);
+    const auto implementations = detail::find_implementations();
+    for (int round = 0; round < 20000; ++round) {
+        const std::string str = random_text(rng, 200);
+        const std::string needle = random_text(rng, 6);
+        const size_t pos = str.empty() ? 0 : rng() % (str.size() + 2);
+        ASSERT_EQ(StringUtils::find(str, needle, pos), str.find(needle, pos)) << str << " / " << needle;
+
+        if (needle.size() >= 2 && needle.size() <= str.size()) {
+            for (const auto& implementation : implementations) {
+                ASSERT_EQ(implementation.find(str.data(), str.size(), needle.data(), needle.size()), str.find(needle))
+                    << implementation.name << ": " << str << " / " << needle;
+            }
+        }
+    }
+}
+
+TEST_F(StringUtilsTest, CaseMatchesReferenceOnRandomInput) {
+    const auto lower = [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; };
+    const auto upper = [](char c) { return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c; };
+
+    std::mt19937 rng(2468);
+    const auto implementations = detail::case_implementations();
+    for (int round = 0; round < 5000; ++round) {
+        // Any byte, so that the edges of the letters and the bytes above
+        // 0x7F are covered.
+        std::string str(rng() % 100, '\0');
+        for (char& c : str) {
+            c = static_cast<char>(rng());
+        }
+        std::string expected_lower = str;
+        std::string expected_upper = str;
+        std::transform(str.begin(), str.end(), expected_lower.begin(), lower);
+        std::transform(str.begin(), str.end(), expected_upper.begin(), upper);
+
+        std::string other = str;
+        std::transform(other.begin(), other.end(), other.begin(), [&](char c) { return rng() % 2 ? lower(c) : upper(c); });
+        const bool changed = !str.empty() && rng() % 2 == 0;
+        if (changed) {
+            // A byte with no other case, so that the strings differ.
+            other[rng() % other.size()] ^= static_cast<char>(0x40);
+        }
+        const bool equal = std::equal(str.begin(), str.end(), other.begin(), other.end(),
+                                      [&](char a, char b) { return lower(a) == lower(b); });
+
+        for (const auto& implementation : implementations) {
+            std::string out(str.size(), '\0');
+            implementation.to_lower(str.data(), out.data(), str.size());
+            ASSERT_EQ(out, expected_lower) << implementation.name;
+            implementation.to_upper(str.data(), out.data(), str.size());
+            ASSERT_EQ(out, expected_upper) << implementation.name;
+
+            out = str;
+            implementation.to_lower(out.data(), out.data(), out.size());
+            ASSERT_EQ(out, expected_lower) << implementation.name << " in place";
+
+            ASSERT_EQ(implementation.iequals(str.data(), other.data(), str.size()), equal) << implementation.name;
+        }
+        ASSERT_EQ(equal, !changed);
+        if (equal) {
+            ASSERT_EQ(StringUtils::ihash(str), StringUtils::ihash(other));
+        }
+    }
+}
+
+TEST_F(StringUtilsTest, ReplaceAllMatchesReferenceOnRandomInput) {
+    std::mt19937 rng(54321);
+    for (int round = 0; round < 20000; ++round) {
+        const std::string str = random_text(rng, 100);
+        const std::string from = random_text(rng, 3);
+        const std::string to = random_text(rng, 4);
+        if (from.empty()) {
+            continue;
+        }
+        ASSERT_EQ(StringUtils::replace_all(str, from, to), replace_all_reference(str, from, to))
+            << str << " / " << from << " / " << to;
+    }
+}
+
 TEST_F(StringUtilsTest, Contains) {
     EXPECT_TRUE(StringUtils::contains("hello world", "world"));
     EXPECT_FALSE(StringUtils::contains("hello world", "foo"));
@@ -108,6 +318,55 @@ TEST_F(StringUtilsTest, FromTypeConversion) {
     EXPECT_EQ(StringUtils::from_bool(false), "false");
 }
 
+TEST_F(StringUtilsTest, FromDoubleKeepsIntegerZeros) {
+    EXPECT_EQ(StringUtils::from_double(100.0, 0), "100");
+    EXPECT_EQ(StringUtils::from_double(100.0), "100");
+    EXPECT_EQ(StringUtils::from_double(2.5, 3), "2.5");
+    EXPECT_EQ(StringUtils::from_double(-0.001), "-0");
+    EXPECT_EQ(StringUtils::from_double(1e300, 1).size(), 301u);
+}
+
+TEST_F(StringUtilsTest, AppendInt) {
+    std::string out = "n=";
+    StringUtils::append_int(out, 42);
+    out += ',';
+    StringUtils::append_int(out, std::numeric_limits<int64_t>::min());
+    out += ',';
+    StringUtils::append_int(out, std::numeric_limits<uint64_t>::max());
+    out += ',';
+    StringUtils::append_int(out, int8_t(-7));
+    EXPECT_EQ(out, "n=42,-9223372036854775808,18446744073709551615,-7");
+
+    char buffer[StringUtils::kMaxIntChars];
+    char* end = StringUtils::write_int(buffer, -120);
+    EXPECT_EQ(std::string(buffer, end), "-120");
+}
+
+TEST_F(StringUtilsTest, AppendDoubleRoundTrips) {
+    std::string out;
+    StringUtils::append_double(out, 0.1);
+    out += ' ';
+    StringUtils::append_double(out, 1e21);
+    out += ' ';
+    StringUtils::append_double(out, -2.5);
+    out += ' ';
+    StringUtils::append_double(out, 3.14159, 2);
+    EXPECT_EQ(out, "0.1 1e+21 -2.5 3.14");
+
+    std::mt19937_64 rng(99);
+    char buffer[StringUtils::kMaxDoubleChars];
+    for (int round = 0; round < 10000; ++round) {
+        const uint64_t bits = rng();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        if (!std::isfinite(value)) {
+            continue;
+        }
+        char* end = StringUtils::write_double(buffer, value);
+        ASSERT_EQ(StringUtils::parse<double>(std::string_view(buffer, static_cast<size_t>(end - buffer))), value);
+    }
+}
+
 TEST_F(StringUtilsTest, TypeChecking) {
     EXPECT_TRUE(StringUtils::is_integer("42"));
     EXPECT_FALSE(StringUtils::is_integer("42.5"));
@@ -122,6 +381,85 @@ TEST_F(StringUtilsTest, TypeChecking) {
     EXPECT_FALSE(StringUtils::is_numeric("abc"));
 }
 
+TEST_F(StringUtilsTest, TypeCheckingSkipsLeadingSpaceAndPlus) {
+    EXPECT_TRUE(StringUtils::is_integer("  42"));
+    EXPECT_TRUE(StringUtils::is_integer("+42"));
+    EXPECT_FALSE(StringUtils::is_integer("+-42"));
+    EXPECT_FALSE(StringUtils::is_integer("42 "));
+    EXPECT_FALSE(StringUtils::is_integer("99999999999"));
+    EXPECT_FALSE(StringUtils::is_integer(""));
+    EXPECT_TRUE(StringUtils::is_float(" -1.5e3"));
+    EXPECT_FALSE(StringUtils::is_float("1e999"));
+    EXPECT_FALSE(StringUtils::is_float("1.5x"));
+}
+
+TEST_F(StringUtilsTest, ParseIntegers) {
+    EXPECT_EQ(StringUtils::parse<int>("42"), 42);
+    EXPECT_EQ(StringUtils::parse<int>("-42"), -42);
+    EXPECT_EQ(StringUtils::parse<int>("-0"), 0);
+    EXPECT_EQ(StringUtils::parse<int>("007"), 7);
+    EXPECT_FALSE(StringUtils::parse<int>(""));
+    EXPECT_FALSE(StringUtils::parse<int>("-"));
+    EXPECT_FALSE(StringUtils::parse<int>("+1"));
+    EXPECT_FALSE(StringUtils::parse<int>(" 1"));
+    EXPECT_FALSE(StringUtils::parse<int>("1 "));
+    EXPECT_FALSE(StringUtils::parse<int>("1.0"));
+    EXPECT_FALSE(StringUtils::parse<unsigned>("-1"));
+
+    EXPECT_EQ(StringUtils::parse<int8_t>("-128"), int8_t(-128));
+    EXPECT_EQ(StringUtils::parse<int8_t>("127"), int8_t(127));
+    EXPECT_FALSE(StringUtils::parse<int8_t>("128"));
+    EXPECT_FALSE(StringUtils::parse<int8_t>("-129"));
+    EXPECT_EQ(StringUtils::parse<uint16_t>("65535"), uint16_t(65535));
+    EXPECT_FALSE(StringUtils::parse<uint16_t>("65536"));
+
+    // Runs of eight digits are converted at once; a bad byte anywhere in
+    // them must still be caught.
+    EXPECT_EQ(StringUtils::parse<int64_t>("1234567890123456789"), 1234567890123456789LL);
+    EXPECT_FALSE(StringUtils::parse<int64_t>("12345a7890123456789"));
+    EXPECT_FALSE(StringUtils::parse<int64_t>("1234567/"));
+    EXPECT_FALSE(StringUtils::parse<int64_t>("1234567:"));
+    EXPECT_EQ(StringUtils::parse<int64_t>("-9223372036854775808"), std::numeric_limits<int64_t>::min());
+    EXPECT_FALSE(StringUtils::parse<int64_t>("9223372036854775808"));
+    EXPECT_EQ(StringUtils::parse<uint64_t>("18446744073709551615"), std::numeric_limits<uint64_t>::max());
+    EXPECT_FALSE(StringUtils::parse<uint64_t>("18446744073709551616"));
+    EXPECT_EQ(StringUtils::parse<uint64_t>("000000000000000000000042"), 42u);
+}
+
+TEST_F(StringUtilsTest, ParseIntegersMatchesFromCharsOnRandomInput) {
+    std::mt19937_64 rng(777);
+    std::uniform_int_distribution<int> length(0, 22);
+    std::uniform_int_distribution<int> byte(0, 12);
+    for (int round = 0; round < 50000; ++round) {
+        std::string text(static_cast<size_t>(length(rng)), '0');
+        for (char& c : text) {
+            const int b = byte(rng);
+            c = b < 10 ? static_cast<char>('0' + b) : (b == 10 ? '-' : (b == 11 ? 'x' : '/'));
+        }
+        int64_t expected = 0;
+        const auto result = std::from_chars(text.data(), text.data() + text.size(), expected);
+        const bool valid = result.ec == std::errc() && result.ptr == text.data() + text.size();
+        const auto parsed = StringUtils::parse<int64_t>(text);
+        ASSERT_EQ(parsed.has_value(), valid) << text;
+        if (valid) {
+            ASSERT_EQ(*parsed, expected) << text;
+        }
+    }
+}
+
+TEST_F(StringUtilsTest, ParseFloatingPoint) {
+    EXPECT_EQ(StringUtils::parse<double>("3.14"), 3.14);
+    EXPECT_EQ(StringUtils::parse<double>("-1e-3"), -1e-3);
+    EXPECT_EQ(StringUtils::parse<float>("0.5"), 0.5f);
+    EXPECT_EQ(StringUtils::parse<double>("42"), 42.0);
+    EXPECT_TRUE(std::isinf(*StringUtils::parse<double>("inf")));
+    EXPECT_TRUE(std::isnan(*StringUtils::parse<double>("nan")));
+    EXPECT_FALSE(StringUtils::parse<double>(""));
+    EXPECT_FALSE(StringUtils::parse<double>("1,5"));
+    EXPECT_FALSE(StringUtils::parse<double>("1e999"));
+    EXPECT_FALSE(StringUtils::parse<double>("abc"));
+}
+
 TEST_F(StringUtilsTest, Format) {
     std::string formatted = StringUtils::format("Hello %s, number %d", "world", 42);
     EXPECT_EQ(formatted, "Hello world, number 42");